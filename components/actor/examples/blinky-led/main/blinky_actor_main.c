@@ -35,6 +35,7 @@
 #include <stdbool.h>
 
 #include "actor.h"
+#include "actor_sizing.h"
 #include "time_event.h"
 
 #include <freertos/FreeRTOS.h>
@@ -54,13 +55,16 @@
 
 #define BLINK_GPIO GPIO_NUM_2
 
+/** Time the example runs before printing the measured actor sizes */
+#define SIZING_RUN_MS 5000
+
 /*******************************************************************************
  * Type Definitions
  ******************************************************************************/
 
 /** Actor object that inherits from the base actor object */
 typedef struct blinky_actor_s {
-    actor_t *super;          ///< Base class
+    actor_object_t super;   ///< Base class, embedded so the handler reaches the state directly
     bool current_state;     ///< Current state of the led
 } blinky_actor_t;
 
@@ -95,15 +99,31 @@ static time_event_t blink_time_event;
  * Function Definitions
  ******************************************************************************/
 
+#if CONFIG_ACTOR_SIZING
+/**
+ * @brief Print the generated sizing header to the console
+ */
+static void blinky_sizing_write(void *ctx, char const *text, size_t len)
+{
+    fwrite(text, 1, len, stdout);
+}
+#endif
+
+#if CONFIG_FREERTOS_USE_TICK_HOOK
 /**
  *
  * @brief Hook for FreeRTOS tick functionality
  *
  * This calls time_event_tick which will service each registered time event.
+ * The tickless back end needs no tick, but the shared sdkconfig.defaults
+ * enables the hook, so it is still defined and left empty.
  */
 void vApplicationTickHook(void) {
+#if CONFIG_ACTOR_TIME_EVENT_TICK
     time_event_tick();
+#endif
 }
+#endif
 
 /**
  * @brief Main application entry point used by the ESP IDF
@@ -112,16 +132,27 @@ void vApplicationTickHook(void) {
 void app_main(void)
 {
     ESP_LOGI(TAG, "Starting main...");
-    actor_ctor(NULL, &blinky_actor.super, blinky_message_handler);
-    actor_start(blinky_actor.super, 1, 10, 2048);
+    time_event_init();
+
+    actor_t *blinky = (actor_t *)&blinky_actor.super;
+    actor_ctor(NULL, &blinky, blinky_message_handler);
+    actor_start(blinky, 1, 10, 2048);
 
-    time_event_ctor(&blink_time_event, BLINK_SIG, blinky_actor.super);
+    time_event_ctor(&blink_time_event, BLINK_SIG, blinky);
     time_event_arm(&blink_time_event, 100, 100);
+
+#if CONFIG_ACTOR_SIZING
+    // Sizes to paste into a header and apply with actor_sizing_apply
+    vTaskDelay(pdMS_TO_TICKS(SIZING_RUN_MS));
+    actor_sizing_emit(blinky_sizing_write, NULL);
+#endif
 }
 
 // Described above
 void blinky_message_handler(actor_t * const me, actor_msg_t const * const msg)
 {
+    blinky_actor_t * const blinky = (blinky_actor_t *)me;
+
     switch (msg->sig)
     {
         case INIT_SIG:
@@ -129,15 +160,15 @@ void blinky_message_handler(actor_t * const me, actor_msg_t const * const msg)
             ESP_LOGI(TAG, "Calling the init event...");
             gpio_set_direction(BLINK_GPIO, GPIO_MODE_OUTPUT);
             gpio_set_level(BLINK_GPIO, OFF);
-            blinky_actor.current_state = false;
+            blinky->current_state = false;
             break;
         }
         case BLINK_SIG:
         {
             ESP_LOGI(TAG, "Calling the blink event...");
-            uint8_t new_state = blinky_actor.current_state ? OFF : ON;
+            uint8_t new_state = blinky->current_state ? OFF : ON;
             gpio_set_level(BLINK_GPIO, new_state);
-            blinky_actor.current_state = !blinky_actor.current_state;
+            blinky->current_state = !blinky->current_state;
             break;
         }
         default:
@@ -0,0 +1,121 @@
+/**
+ * @file bench.h
+ * @brief Shared helpers for the host benchmark suite
+ *
+ * Every result is written to stdout as one JSON object per line:
+ *
+ *     {"suite":"latency","name":"round_trip","param":1,"metric":"p99","value":12.5,"unit":"us"}
+ *
+ * `suite`, `name` and `param` identify a measurement across runs; compare.py
+ * uses them to diff two result files.
+ */
+
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** FreeRTOS priority of the task running the benchmarks */
+#define BENCH_RUNNER_PRIO 1
+
+/** FreeRTOS priority of actors created by the benchmarks */
+#define BENCH_ACTOR_PRIO 2
+
+/** FreeRTOS priority of the time event drain task; above every actor */
+#define BENCH_DRAIN_PRIO 3
+
+/** Stack size of every task created by the benchmarks */
+#define BENCH_STACK_SIZE 4096
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Entry point of a benchmark suite; runs in the runner task */
+typedef void (*BenchSuiteHandler)(void);
+
+/** Called from the FreeRTOS tick hook while installed */
+typedef void (*BenchTickHandler)(void);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * @brief Write one result line
+ *
+ * @param suite Suite the result belongs to
+ * @param name Benchmark within the suite
+ * @param param Size parameter of the benchmark (actors, timers, bytes...)
+ * @param metric Statistic reported
+ * @param value Measured value
+ * @param unit Unit of the value
+ */
+void bench_report(char const *suite, char const *name, uint32_t param, char const *metric,
+                  double value, char const *unit);
+
+/**
+ * @brief Report mean, p50, p99 and max of a set of samples
+ *
+ * Sorts the samples in place.
+ *
+ * @param suite Suite the result belongs to
+ * @param name Benchmark within the suite
+ * @param param Size parameter of the benchmark
+ * @param samples Samples in nanoseconds
+ * @param count Number of samples
+ */
+void bench_report_samples(char const *suite, char const *name, uint32_t param,
+                          uint64_t *samples, uint32_t count);
+
+/**
+ * @brief Install the function run from the tick hook
+ *
+ * @param handler Function to run on every tick; NULL to run nothing
+ */
+void bench_set_tick_handler(BenchTickHandler handler);
+
+/**
+ * @brief Handle of the runner task, for actors that signal completion
+ */
+TaskHandle_t bench_runner(void);
+
+/**
+ * @brief Register the event pools of 64, 256 and 512 byte blocks, once
+ *
+ * Pools must be registered in ascending size and cannot be removed, so the
+ * suites needing pooled events share these.  Each pool has 8 blocks.
+ */
+void bench_event_pools(void);
+
+void bench_latency(void);
+void bench_request(void);
+void bench_pubsub(void);
+void bench_affinity(void);
+void bench_lifecycle(void);
+void bench_throughput(void);
+void bench_overhead(void);
+void bench_mailbox(void);
+void bench_flow(void);
+void bench_tick(void);
+void bench_timer(void);
+void bench_power(void);
+void bench_event(void);
+void bench_hsm(void);
+void bench_channel(void);
+void bench_remote(void);
+void bench_replay(void);
+void bench_sizing(void);
+void bench_layout(void);
+void bench_memory(void);
@@ -0,0 +1,191 @@
+/**
+ * @file bench_affinity.c
+ * @brief Same-core versus cross-core posts and traffic-based placement
+ *
+ * The runner posts to a first actor, which forwards to a second one that
+ * notifies the runner back.  The pair runs once on the same core and once on
+ * different cores.  With statistics enabled, two chatty pairs are then split
+ * across the cores and actor_stats_suggest_placement is asked to place them.
+ *
+ * The host only has logical cores: every task still shares one simulated
+ * CPU, so the two latencies only diverge on a real multi-core target.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_stats.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "affinity"
+
+/** Round trips measured per placement */
+#define SAMPLES 10000
+
+/** Round trips run before measuring */
+#define WARMUP 100
+
+/** Messages sent through each pair before asking for a placement */
+#define TRAFFIC 1000
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_affinity_signals {
+    PING_SIG = USER_SIG,
+    PONG_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_msg_t const l_ping = { .sig = PING_SIG };
+
+static actor_msg_t const l_pong = { .sig = PONG_SIG };
+
+static uint64_t l_samples[SAMPLES];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of the first actor of a pair; forwards to its child
+ */
+static void bench_affinity_forward(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == PING_SIG)
+    {
+        actor_post(actor_get_first_child(me), &l_pong);
+    }
+}
+
+/**
+ * @brief Dispatch handler of the second actor of a pair; notifies the runner
+ */
+static void bench_affinity_answer(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == PONG_SIG)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Create and start a pair of actors
+ *
+ * @param first_core Core of the actor receiving the runner's posts
+ * @param second_core Core of the actor it forwards to
+ * @return First actor of the pair
+ */
+static actor_t *bench_affinity_pair(BaseType_t first_core, BaseType_t second_core)
+{
+    actor_t *first = NULL;
+    actor_t *second = NULL;
+
+    actor_ctor(NULL, &first, bench_affinity_forward);
+    actor_ctor(first, &second, bench_affinity_answer);
+    actor_set_affinity(first, first_core);
+    actor_set_affinity(second, second_core);
+    actor_start(second, BENCH_ACTOR_PRIO, 4, BENCH_STACK_SIZE);
+    actor_start(first, BENCH_ACTOR_PRIO, 4, BENCH_STACK_SIZE);
+
+    return first;
+}
+
+/**
+ * @brief Measure round trips through a pair
+ *
+ * @param first First actor of the pair
+ * @param name Benchmark name to report under
+ */
+static void bench_affinity_run(actor_t * const first, char const *name)
+{
+    for (uint32_t i = 0; i < WARMUP; i++)
+    {
+        actor_post(first, &l_ping);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    for (uint32_t i = 0; i < SAMPLES; i++)
+    {
+        uint64_t const start = bench_now_ns();
+        actor_post(first, &l_ping);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        l_samples[i] = bench_now_ns() - start;
+    }
+
+    bench_report_samples(SUITE, name, 1, l_samples, SAMPLES);
+}
+
+#if CONFIG_ACTOR_STATS
+/**
+ * @brief Count the pairs whose actors are on different cores
+ *
+ * @param cores Core of each actor; pairs are adjacent entries
+ * @param count Number of actors
+ */
+static uint32_t bench_affinity_split(BaseType_t const cores[], uint16_t count)
+{
+    uint32_t split = 0;
+
+    for (uint16_t i = 0; i + 1 < count; i += 2)
+    {
+        split += (cores[i] != cores[i + 1]);
+    }
+
+    return split;
+}
+
+/**
+ * @brief Split two pairs across the cores and ask for a placement
+ */
+static void bench_affinity_placement(void)
+{
+    actor_t *actors[4];
+    BaseType_t cores[4];
+
+    for (uint16_t i = 0; i < 4; i += 2)
+    {
+        actors[i] = bench_affinity_pair(0, 1);
+        actors[i + 1] = actor_get_first_child(actors[i]);
+    }
+
+    for (uint32_t n = 0; n < TRAFFIC; n++)
+    {
+        for (uint16_t i = 0; i < 4; i += 2)
+        {
+            actor_post(actors[i], &l_ping);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        cores[i] = actor_get_core(actors[i]);
+    }
+    bench_report(SUITE, "split_pairs_before", 2, "count", bench_affinity_split(cores, 4), "pairs");
+
+    actor_stats_suggest_placement(actors, cores, 4);
+    bench_report(SUITE, "split_pairs_suggested", 2, "count", bench_affinity_split(cores, 4), "pairs");
+}
+#endif
+
+// Described in .h
+void bench_affinity(void)
+{
+    bench_affinity_run(bench_affinity_pair(0, 0), "hop_same_core");
+    bench_affinity_run(bench_affinity_pair(0, portNUM_PROCESSORS - 1), "hop_cross_core");
+
+#if CONFIG_ACTOR_STATS
+    bench_affinity_placement();
+#endif
+}
@@ -0,0 +1,194 @@
+/**
+ * @file bench_channel.c
+ * @brief Streaming throughput of a byte channel for chunks of 16 B to 4 kB
+ *
+ * The runner plays a DMA producer: it acquires a span of the channel, fills
+ * one chunk in place and commits it.  A higher priority actor reads the
+ * committed bytes in place and releases them.  For chunks that fit the event
+ * pools the same stream is also sent as one pooled event per chunk, the way
+ * it would be done without channels.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_channel.h"
+#include "event_pool.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <string.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "channel"
+
+/** Bytes streamed per measurement */
+#define STREAM_BYTES (16u * 1024u * 1024u)
+
+/** Size of the channel's ring */
+#define RING_SIZE 16384
+
+/** Largest chunk */
+#define MAX_CHUNK 4096
+
+/** Largest chunk sent as a pooled event; the 512 B pool holds it */
+#define MAX_EVENT_CHUNK 256
+
+/** Queue length of the consumer; below the pool size so events never run out */
+#define CONSUMER_QUEUE 4
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_channel_signals {
+    DATA_SIG = USER_SIG,
+    CHUNK_SIG,
+};
+
+/** Chunk sent as a pooled event */
+typedef struct {
+    actor_msg_t super;
+    uint16_t len;
+    uint8_t data[];
+} bench_channel_chunk_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static uint8_t l_ring[RING_SIZE];
+
+static actor_channel_t l_channel;
+
+static actor_t *l_consumer = NULL;
+
+/** Chunk the producer copies in, standing in for the DMA source */
+static uint8_t l_source[MAX_CHUNK];
+
+/** Bytes consumed in the current measurement */
+static uint32_t l_consumed = 0;
+
+/** Bytes read by the consumer, so the reads are not optimised out */
+static uint32_t volatile l_checksum;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Account for consumed bytes; notifies the runner at the end of the stream
+ */
+static void bench_channel_consumed(size_t len)
+{
+    l_consumed += len;
+    if (l_consumed == STREAM_BYTES)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Dispatch handler of the consumer; drains the channel or takes a chunk
+ */
+static void bench_channel_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == DATA_SIG)
+    {
+        actor_channel_t * const channel = (actor_channel_t *)msg;
+        actor_channel_span_t span;
+        size_t len = 0;
+        while ((len = actor_channel_peek(channel, &span)) != 0)
+        {
+            l_checksum += span.data[0][0];
+            actor_channel_release(channel, len);
+            bench_channel_consumed(len);
+        }
+    }
+    else if (msg->sig == CHUNK_SIG)
+    {
+        bench_channel_chunk_t const * const chunk = (bench_channel_chunk_t const *)msg;
+        l_checksum += chunk->data[0];
+        bench_channel_consumed(chunk->len);
+    }
+}
+
+/**
+ * @brief Stream through the channel in chunks of `chunk` bytes
+ */
+static void bench_channel_stream(size_t chunk)
+{
+    actor_channel_ctor(&l_channel, l_ring, sizeof(l_ring), l_consumer, DATA_SIG);
+
+    l_consumed = 0;
+    uint64_t const start = bench_now_ns();
+    for (uint32_t sent = 0; sent < STREAM_BYTES; sent += chunk)
+    {
+        uint8_t *span = NULL;
+        while (actor_channel_acquire(&l_channel, &span) < chunk)
+        {
+            taskYIELD();
+        }
+        memcpy(span, l_source, chunk);
+        actor_channel_commit(&l_channel, chunk);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    double const seconds = (bench_now_ns() - start) / 1e9;
+
+    bench_report(SUITE, "channel", chunk, "throughput", STREAM_BYTES / seconds / 1e6, "MB/s");
+    bench_report(SUITE, "channel", chunk, "chunks_per_notification",
+                 (double)(STREAM_BYTES / chunk) / l_channel.notifications, "chunks");
+    bench_report(SUITE, "channel", chunk, "stalls", l_channel.stalls, "count");
+}
+
+/**
+ * @brief Stream the same bytes as one pooled event per chunk
+ */
+static void bench_channel_events(size_t chunk)
+{
+    l_consumed = 0;
+    uint64_t const start = bench_now_ns();
+    for (uint32_t sent = 0; sent < STREAM_BYTES; sent += chunk)
+    {
+        bench_channel_chunk_t *event = NULL;
+        while ((event = (bench_channel_chunk_t *)event_new(sizeof(*event) + chunk, CHUNK_SIG)) == NULL)
+        {
+            taskYIELD();
+        }
+        event->len = (uint16_t)chunk;
+        memcpy(event->data, l_source, chunk);
+        actor_post(l_consumer, &event->super);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    double const seconds = (bench_now_ns() - start) / 1e9;
+
+    bench_report(SUITE, "event", chunk, "throughput", STREAM_BYTES / seconds / 1e6, "MB/s");
+}
+
+// Described in .h
+void bench_channel(void)
+{
+    static size_t const chunks[] = { 16, 64, 256, 1024, 4096 };
+
+    bench_event_pools();
+    memset(l_source, 0x5a, sizeof(l_source));
+
+    actor_ctor(NULL, &l_consumer, bench_channel_dispatch);
+    actor_set_overflow(l_consumer, ACTOR_OVERFLOW_BLOCK, portMAX_DELAY, NULL);
+    actor_start(l_consumer, BENCH_ACTOR_PRIO, CONSUMER_QUEUE, BENCH_STACK_SIZE);
+
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        bench_channel_stream(chunks[i]);
+        if (chunks[i] <= MAX_EVENT_CHUNK)
+        {
+            bench_channel_events(chunks[i]);
+        }
+    }
+
+    actor_stop(l_consumer);
+}
@@ -0,0 +1,247 @@
+/**
+ * @file bench_event.c
+ * @brief Pooled zero-copy events versus copying the payload through a queue
+ *
+ * Both paths fill a payload, post it to a higher priority actor with a queue
+ * of POOL_BLOCKS and let its handler read the payload, so each figure is the
+ * end-to-end cost of one message and the paths differ only in how the
+ * payload travels.  The pooled path allocates from an event pool and fills
+ * the event in place.  The copy path copies the payload into one of
+ * POOL_BLOCKS static messages and the handler copies it out again, as a
+ * by-value queue would.  Each path reports time per message, messages per
+ * second, the heap its actor took and the static bytes holding payloads.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "event_pool.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "event"
+
+/** Messages sent per measurement */
+#define MESSAGES 20000
+
+/** Blocks in each event pool; also the queue length and copy slots of both paths */
+#define POOL_BLOCKS 8
+
+/** Declare an event type of `size_` bytes in total */
+#define BENCH_EVENT(size_) \
+    typedef struct { actor_msg_t super; uint8_t payload[(size_) - sizeof(actor_msg_t)]; } bench_event_##size_##_t
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_event_signals {
+    DATA_SIG = USER_SIG,
+};
+
+BENCH_EVENT(64);
+BENCH_EVENT(256);
+BENCH_EVENT(512);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+EVENT_POOL_STORAGE(l_pool_64, bench_event_64_t, POOL_BLOCKS);
+EVENT_POOL_STORAGE(l_pool_256, bench_event_256_t, POOL_BLOCKS);
+EVENT_POOL_STORAGE(l_pool_512, bench_event_512_t, POOL_BLOCKS);
+
+/** Static messages the copy path copies payloads into */
+static bench_event_512_t l_slots[POOL_BLOCKS];
+
+/** Slots filled by the sender */
+static uint32_t l_slot_head = 0;
+
+/** Slots copied out by the receiver */
+static uint32_t l_slot_tail = 0;
+
+/** Payload bytes of the copy measurement in progress */
+static uint16_t l_copy_len = 0;
+
+/** Payload bytes read by the receivers, so the reads are not optimised out */
+static uint32_t volatile l_checksum;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler reading the payload of pooled events in place
+ */
+static void bench_event_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == DATA_SIG)
+    {
+        l_checksum += ((bench_event_64_t const *)msg)->payload[0];
+    }
+}
+
+/**
+ * @brief Dispatch handler copying the payload out of a slot, then reading it
+ */
+static void bench_event_copy_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    uint8_t buffer[sizeof(l_slots[0].payload)];
+
+    if (msg->sig == DATA_SIG)
+    {
+        memcpy(buffer, ((bench_event_512_t const *)msg)->payload, l_copy_len);
+        __atomic_add_fetch(&l_slot_tail, 1, __ATOMIC_RELEASE);
+        l_checksum += buffer[0];
+    }
+}
+
+/**
+ * @brief Start the receiving actor of a path
+ *
+ * @param dispatch Dispatch handler of the path
+ * @param heap Set to the heap the actor took
+ * @return Started actor
+ */
+static actor_t *bench_event_start(DispatchHandler dispatch, size_t * const heap)
+{
+    actor_t *sink = NULL;
+    size_t const free_before = xPortGetFreeHeapSize();
+
+    actor_ctor(NULL, &sink, dispatch);
+    actor_start(sink, BENCH_ACTOR_PRIO, POOL_BLOCKS, BENCH_STACK_SIZE);
+    *heap = free_before - xPortGetFreeHeapSize();
+    // INIT_SIG takes a queue slot until it is handled
+    vTaskDelay(1);
+
+    return sink;
+}
+
+/**
+ * @brief Stop the receiving actor of a path and report the measurement
+ */
+static void bench_event_finish(actor_t * const sink, char const *name, uint16_t size, uint64_t elapsed_ns,
+                               size_t heap, size_t statics)
+{
+    // QUIT_SIG needs a free slot; the last messages may still fill the queue
+    while (actor_stop(sink) != ESP_OK)
+    {
+        vTaskDelay(1);
+    }
+    actor_dtor(sink);
+
+    bench_report(SUITE, name, size, "per_msg", (double)elapsed_ns / MESSAGES, "ns");
+    bench_report(SUITE, name, size, "msgs_per_s", MESSAGES / (elapsed_ns / 1e9), "msgs/s");
+    bench_report(SUITE, name, size, "heap_bytes", heap, "B");
+    bench_report(SUITE, name, size, "static_bytes", statics, "B");
+}
+
+/**
+ * @brief Measure pooled events of `size` bytes
+ *
+ * @param size Event size
+ * @param pool_bytes Size of the pool the events come from
+ */
+static void bench_event_pooled(uint16_t size, size_t pool_bytes)
+{
+    size_t heap = 0;
+    actor_t * const sink = bench_event_start(bench_event_dispatch, &heap);
+
+    uint64_t const start = bench_now_ns();
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        bench_event_512_t *ev;
+
+        // The pool only runs dry if the receiver falls behind; let it catch up
+        while ((ev = (bench_event_512_t *)event_new(size, DATA_SIG)) == NULL)
+        {
+            taskYIELD();
+        }
+        memset(ev->payload, (int)i, size - sizeof(actor_msg_t));
+        actor_post(sink, &ev->super);
+    }
+    uint64_t const elapsed = bench_now_ns() - start;
+
+    bench_event_finish(sink, "pooled", size, elapsed, heap, pool_bytes);
+}
+
+/**
+ * @brief Measure copying the payload of `size` byte messages in and out
+ *
+ * @param size Message size
+ */
+static void bench_event_copy(uint16_t size)
+{
+    uint8_t buffer[sizeof(l_slots[0].payload)];
+    size_t heap = 0;
+    actor_t * const sink = bench_event_start(bench_event_copy_dispatch, &heap);
+
+    l_copy_len = size - sizeof(actor_msg_t);
+    l_slot_head = 0;
+    __atomic_store_n(&l_slot_tail, 0, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < POOL_BLOCKS; i++)
+    {
+        l_slots[i].super.sig = DATA_SIG;
+        l_slots[i].super.pool_id = 0;
+        l_slots[i].super.ref_count = 0;
+    }
+
+    uint64_t const start = bench_now_ns();
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        // Like the pool, the slots only run out if the receiver falls behind
+        while (l_slot_head - __atomic_load_n(&l_slot_tail, __ATOMIC_ACQUIRE) >= POOL_BLOCKS)
+        {
+            taskYIELD();
+        }
+        memset(buffer, (int)i, l_copy_len);
+        bench_event_512_t * const slot = &l_slots[l_slot_head++ % POOL_BLOCKS];
+        memcpy(slot->payload, buffer, l_copy_len);
+        // A refused slot would never be copied out and freed
+        while (actor_post(sink, &slot->super) != ESP_OK)
+        {
+            taskYIELD();
+        }
+    }
+    uint64_t const elapsed = bench_now_ns() - start;
+
+    // Slots sized for this payload, as a by-value queue would hold
+    bench_event_finish(sink, "copy", size, elapsed, heap, (size_t)POOL_BLOCKS * size);
+}
+
+// Described in .h
+void bench_event_pools(void)
+{
+    static bool registered = false;
+
+    if (!registered)
+    {
+        event_pool_init(l_pool_64, sizeof(l_pool_64), sizeof(l_pool_64[0]));
+        event_pool_init(l_pool_256, sizeof(l_pool_256), sizeof(l_pool_256[0]));
+        event_pool_init(l_pool_512, sizeof(l_pool_512), sizeof(l_pool_512[0]));
+        registered = true;
+    }
+}
+
+// Described in .h
+void bench_event(void)
+{
+    static uint16_t const sizes[] = { 64, 256, 512 };
+    static size_t const pool_bytes[] = { sizeof(l_pool_64), sizeof(l_pool_256), sizeof(l_pool_512) };
+
+    bench_event_pools();
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        bench_event_pooled(sizes[i], pool_bytes[i]);
+        bench_event_copy(sizes[i]);
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * @file bench_flow.c
+ * @brief Fast producer, slow consumer under each overflow policy
+ *
+ * The producer posts bursts of BURST messages every tick to a consumer that
+ * needs WORK_NS per message, about twice the rate the consumer can sustain.
+ * Under the drop policies the producer fires and forgets; under BLOCK and
+ * CREDITS it is paced by the consumer and retries refused posts.  Each policy
+ * reports lost messages, post-to-dispatch latency and how long the producer
+ * took.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_err.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "flow"
+
+/** Messages produced per policy */
+#define MESSAGES 2000
+
+/** Messages posted back to back before the producer sleeps a tick */
+#define BURST 50
+
+/** Time the consumer spends on each message */
+#define WORK_NS 40000u
+
+/** Queue length of the consumer */
+#define QUEUE_LENGTH 16
+
+/** Longest wait of a blocking post, in ticks */
+#define BLOCK_TICKS 10
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_flow_signals {
+    DATA_SIG = USER_SIG,
+};
+
+/** Message carrying the time it was posted */
+typedef struct bench_flow_msg_s {
+    actor_msg_t super;
+    uint64_t stamp;
+} bench_flow_msg_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static bench_flow_msg_t l_msgs[MESSAGES];
+
+static uint64_t l_samples[MESSAGES];
+
+static uint32_t volatile l_delivered;
+
+static uint32_t volatile l_lost;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of the slow consumer
+ */
+static void bench_flow_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig != DATA_SIG)
+    {
+        return;
+    }
+
+    uint64_t const now = bench_now_ns();
+    l_samples[l_delivered] = now - ((bench_flow_msg_t const *)msg)->stamp;
+
+    uint64_t const until = now + WORK_NS;
+    while (bench_now_ns() < until)
+    {
+    }
+
+    l_delivered++;
+    actor_grant_credits(me, 1);
+}
+
+/**
+ * @brief Count messages the consumer will never see
+ */
+static void bench_flow_overflow(actor_t * const me, actor_msg_t const * const msg)
+{
+    __atomic_add_fetch(&l_lost, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Run the producer against a consumer with the given policy
+ *
+ * @param name Benchmark name to report under
+ * @param policy Overflow policy of the consumer
+ * @param limit Timeout or initial credits, see actor_set_overflow
+ */
+static void bench_flow_run(char const *name, actor_overflow_t policy, uint32_t limit)
+{
+    actor_t *me = NULL;
+    bool const paced = (policy == ACTOR_OVERFLOW_BLOCK || policy == ACTOR_OVERFLOW_CREDITS);
+    uint32_t lost = 0;
+
+    actor_ctor(NULL, &me, bench_flow_dispatch);
+    actor_set_overflow(me, policy, limit, bench_flow_overflow);
+    actor_start(me, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+    vTaskDelay(1);
+
+    l_delivered = 0;
+    l_lost = 0;
+
+    // Outrank the consumer, like an interrupt-driven source would
+    vTaskPrioritySet(NULL, BENCH_ACTOR_PRIO + 1);
+    uint64_t const start = bench_now_ns();
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        l_msgs[i].super.sig = DATA_SIG;
+        l_msgs[i].stamp = bench_now_ns();
+        while (actor_post(me, &l_msgs[i].super) != ESP_OK)
+        {
+            if (!paced)
+            {
+                break;
+            }
+            // Refused by a paced consumer; back off and retry
+            lost++;
+            vTaskDelay(1);
+            l_msgs[i].stamp = bench_now_ns();
+        }
+        if ((i % BURST) == BURST - 1)
+        {
+            vTaskDelay(1);
+        }
+    }
+    uint64_t const elapsed = bench_now_ns() - start;
+    vTaskPrioritySet(NULL, BENCH_RUNNER_PRIO);
+
+    // Retried posts reached the overflow handler too but were not lost
+    while (l_delivered + l_lost - lost < MESSAGES)
+    {
+        vTaskDelay(1);
+    }
+
+    bench_report(SUITE, name, MESSAGES, "lost", l_lost - lost, "count");
+    bench_report(SUITE, name, MESSAGES, "refused", lost, "count");
+    bench_report(SUITE, name, MESSAGES, "producer_time", elapsed / 1e6, "ms");
+    bench_report_samples(SUITE, name, MESSAGES, l_samples, l_delivered);
+}
+
+// Described in .h
+void bench_flow(void)
+{
+    bench_flow_run("drop_newest", ACTOR_OVERFLOW_DROP_NEWEST, 0);
+    bench_flow_run("drop_oldest", ACTOR_OVERFLOW_DROP_OLDEST, 0);
+    bench_flow_run("block", ACTOR_OVERFLOW_BLOCK, BLOCK_TICKS);
+    bench_flow_run("credits", ACTOR_OVERFLOW_CREDITS, QUEUE_LENGTH);
+}
@@ -0,0 +1,341 @@
+/**
+ * @file bench_hsm.c
+ * @brief Transition order of a nested state machine and its dispatch cost
+ *
+ * The machine has a top-level state s with substates s1 (s11, s12) and s2
+ * (s21), and a second top-level state t.  A scripted sequence of signals
+ * takes sibling, self, cross-branch, ancestor-declared, top-level and
+ * guarded transitions; the entry, exit and transition actions are logged and
+ * compared with the order the least common ancestor rule requires.  A
+ * mismatch is printed and aborts the run.
+ *
+ * Dispatch cost is then compared with a flat switch doing the same work: a
+ * transition between the leaves s11 and s12, and a signal handled two levels
+ * above the leaf.  The host counts cycles in nanoseconds.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_port.h"
+#include "hsm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "hsm"
+
+/** Dispatches per measurement */
+#define DISPATCHES 1000000
+
+/** Size of the action log */
+#define LOG_SIZE 256
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_hsm_signals {
+    A_SIG = USER_SIG,   ///< s11 -> s12, siblings
+    B_SIG,              ///< Declared on s1: s1 -> s2
+    C_SIG,              ///< s21 -> s21, self
+    D_SIG,              ///< s2 -> s11, across branches
+    E_SIG,              ///< Declared on s: s -> t
+    F_SIG,              ///< t -> s, drilling into the initial substates
+    G_SIG,              ///< Internal transition of s
+    H_SIG,              ///< Declared on s1: s1 -> s12, a substate of the source
+    I_SIG,              ///< Declared on s: s -> s, self from a leaf
+    J_SIG,              ///< Guard refuses on s11; internal on s
+    K_SIG,              ///< s12 -> s11, siblings
+};
+
+/** States of the flat switch */
+typedef enum {
+    FLAT_S11,
+    FLAT_S12,
+} bench_hsm_flat_state_t;
+
+/** Step of the scripted sequence */
+typedef struct {
+    signal_t sig;               ///< Signal dispatched; INIT_SIG for the initial transition
+    char const *expected;       ///< Actions logged, in order
+} bench_hsm_step_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+static void bench_hsm_en_s(hsm_t * const me);
+static void bench_hsm_ex_s(hsm_t * const me);
+static void bench_hsm_en_s1(hsm_t * const me);
+static void bench_hsm_ex_s1(hsm_t * const me);
+static void bench_hsm_en_s11(hsm_t * const me);
+static void bench_hsm_ex_s11(hsm_t * const me);
+static void bench_hsm_en_s12(hsm_t * const me);
+static void bench_hsm_ex_s12(hsm_t * const me);
+static void bench_hsm_en_s2(hsm_t * const me);
+static void bench_hsm_ex_s2(hsm_t * const me);
+static void bench_hsm_en_s21(hsm_t * const me);
+static void bench_hsm_ex_s21(hsm_t * const me);
+static void bench_hsm_en_t(hsm_t * const me);
+static void bench_hsm_ex_t(hsm_t * const me);
+static void bench_hsm_action(hsm_t * const me, actor_msg_t const * const msg);
+static bool bench_hsm_refuse(hsm_t const * const me, actor_msg_t const * const msg);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+enum { ID_S, ID_S1, ID_S11, ID_S12, ID_S2, ID_S21, ID_T, NUM_STATES };
+
+static hsm_state_t const l_s;
+static hsm_state_t const l_s1;
+static hsm_state_t const l_s11;
+static hsm_state_t const l_s12;
+static hsm_state_t const l_s2;
+static hsm_state_t const l_s21;
+static hsm_state_t const l_t;
+
+/** Transitions, grouped by source state in the order of the state ids */
+static hsm_transition_t const l_transitions[] = {
+    // s
+    { E_SIG, &l_t, NULL, bench_hsm_action },
+    { G_SIG, NULL, NULL, bench_hsm_action },
+    { I_SIG, &l_s, NULL, bench_hsm_action },
+    { J_SIG, NULL, NULL, bench_hsm_action },
+    // s1
+    { B_SIG, &l_s2, NULL, bench_hsm_action },
+    { H_SIG, &l_s12, NULL, bench_hsm_action },
+    // s11
+    { A_SIG, &l_s12, NULL, bench_hsm_action },
+    { J_SIG, &l_t, bench_hsm_refuse, bench_hsm_action },
+    // s12
+    { K_SIG, &l_s11, NULL, bench_hsm_action },
+    // s2
+    { D_SIG, &l_s11, NULL, bench_hsm_action },
+    // s21
+    { C_SIG, &l_s21, NULL, bench_hsm_action },
+    // t
+    { F_SIG, &l_s, NULL, bench_hsm_action },
+};
+
+static hsm_state_t const l_s = { NULL, &l_s1, bench_hsm_en_s, bench_hsm_ex_s, 0, 4, ID_S };
+static hsm_state_t const l_s1 = { &l_s, &l_s11, bench_hsm_en_s1, bench_hsm_ex_s1, 4, 2, ID_S1 };
+static hsm_state_t const l_s11 = { &l_s1, NULL, bench_hsm_en_s11, bench_hsm_ex_s11, 6, 2, ID_S11 };
+static hsm_state_t const l_s12 = { &l_s1, NULL, bench_hsm_en_s12, bench_hsm_ex_s12, 8, 1, ID_S12 };
+static hsm_state_t const l_s2 = { &l_s, &l_s21, bench_hsm_en_s2, bench_hsm_ex_s2, 9, 1, ID_S2 };
+static hsm_state_t const l_s21 = { &l_s2, NULL, bench_hsm_en_s21, bench_hsm_ex_s21, 10, 1, ID_S21 };
+static hsm_state_t const l_t = { NULL, NULL, bench_hsm_en_t, bench_hsm_ex_t, 11, 1, ID_T };
+
+static hsm_state_t const * const l_states[NUM_STATES] = {
+    &l_s, &l_s1, &l_s11, &l_s12, &l_s2, &l_s21, &l_t,
+};
+
+static hsm_def_t const l_def = {
+    l_states, l_transitions, &l_s, NUM_STATES, sizeof(l_transitions) / sizeof(l_transitions[0]),
+};
+
+static hsm_path_t l_paths[sizeof(l_transitions) / sizeof(l_transitions[0])];
+
+static hsm_t l_hsm;
+
+/** Scripted sequence and the actions each step must log */
+static bench_hsm_step_t const l_script[] = {
+    { INIT_SIG, "en:s en:s1 en:s11" },
+    { A_SIG, "ex:s11 a:A en:s12" },
+    { B_SIG, "ex:s12 ex:s1 a:B en:s2 en:s21" },
+    { C_SIG, "ex:s21 a:C en:s21" },
+    { D_SIG, "ex:s21 ex:s2 a:D en:s1 en:s11" },
+    { H_SIG, "ex:s11 a:H en:s12" },
+    { I_SIG, "ex:s12 ex:s1 ex:s a:I en:s en:s1 en:s11" },
+    { G_SIG, "a:G" },
+    { J_SIG, "a:J" },
+    { E_SIG, "ex:s11 ex:s1 ex:s a:E en:t" },
+    { A_SIG, "" },
+    { F_SIG, "ex:t a:F en:s en:s1 en:s11" },
+};
+
+/** Actions logged while checking; NULL while measuring */
+static char *l_log = NULL;
+
+/** Bytes used in l_log */
+static size_t l_log_len = 0;
+
+/** Work done by the actions while measuring, so they are not optimised out */
+static uint32_t volatile l_work = 0;
+
+static bench_hsm_flat_state_t l_flat_state = FLAT_S11;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Log an action while checking; count it while measuring
+ */
+static void bench_hsm_log(char const *prefix, char const *name)
+{
+    if (l_log == NULL)
+    {
+        l_work++;
+        return;
+    }
+
+    l_log_len += snprintf(&l_log[l_log_len], LOG_SIZE - l_log_len, "%s%s:%s",
+                          (l_log_len == 0) ? "" : " ", prefix, name);
+}
+
+static void bench_hsm_en_s(hsm_t * const me) { bench_hsm_log("en", "s"); }
+static void bench_hsm_ex_s(hsm_t * const me) { bench_hsm_log("ex", "s"); }
+static void bench_hsm_en_s1(hsm_t * const me) { bench_hsm_log("en", "s1"); }
+static void bench_hsm_ex_s1(hsm_t * const me) { bench_hsm_log("ex", "s1"); }
+static void bench_hsm_en_s11(hsm_t * const me) { bench_hsm_log("en", "s11"); }
+static void bench_hsm_ex_s11(hsm_t * const me) { bench_hsm_log("ex", "s11"); }
+static void bench_hsm_en_s12(hsm_t * const me) { bench_hsm_log("en", "s12"); }
+static void bench_hsm_ex_s12(hsm_t * const me) { bench_hsm_log("ex", "s12"); }
+static void bench_hsm_en_s2(hsm_t * const me) { bench_hsm_log("en", "s2"); }
+static void bench_hsm_ex_s2(hsm_t * const me) { bench_hsm_log("ex", "s2"); }
+static void bench_hsm_en_s21(hsm_t * const me) { bench_hsm_log("en", "s21"); }
+static void bench_hsm_ex_s21(hsm_t * const me) { bench_hsm_log("ex", "s21"); }
+static void bench_hsm_en_t(hsm_t * const me) { bench_hsm_log("en", "t"); }
+static void bench_hsm_ex_t(hsm_t * const me) { bench_hsm_log("ex", "t"); }
+
+/**
+ * @brief Transition action; logs the letter of the signal
+ */
+static void bench_hsm_action(hsm_t * const me, actor_msg_t const * const msg)
+{
+    char const name[2] = { (char)('A' + (msg->sig - A_SIG)), '\0' };
+    bench_hsm_log("a", name);
+}
+
+/**
+ * @brief Guard that never lets the transition through
+ */
+static bool bench_hsm_refuse(hsm_t const * const me, actor_msg_t const * const msg)
+{
+    return false;
+}
+
+/**
+ * @brief Flat switch doing the work of the machine for A_SIG, K_SIG and G_SIG
+ */
+static void bench_hsm_flat(actor_msg_t const * const msg)
+{
+    switch (l_flat_state)
+    {
+        case FLAT_S11:
+        {
+            if (msg->sig == A_SIG)
+            {
+                bench_hsm_log("ex", "s11");
+                bench_hsm_log("a", "A");
+                bench_hsm_log("en", "s12");
+                l_flat_state = FLAT_S12;
+                return;
+            }
+            break;
+        }
+        case FLAT_S12:
+        {
+            if (msg->sig == K_SIG)
+            {
+                bench_hsm_log("ex", "s12");
+                bench_hsm_log("a", "K");
+                bench_hsm_log("en", "s11");
+                l_flat_state = FLAT_S11;
+                return;
+            }
+            break;
+        }
+    }
+
+    if (msg->sig == G_SIG)
+    {
+        bench_hsm_log("a", "G");
+    }
+}
+
+/**
+ * @brief Run the script and check the logged actions of every step
+ */
+static void bench_hsm_check(void)
+{
+    char log[LOG_SIZE];
+    uint32_t failed = 0;
+
+    hsm_init(&l_hsm, &l_def, l_paths, NULL);
+    l_log = log;
+    for (size_t i = 0; i < sizeof(l_script) / sizeof(l_script[0]); i++)
+    {
+        actor_msg_t const msg = { .sig = l_script[i].sig };
+        l_log_len = 0;
+        log[0] = '\0';
+        hsm_dispatch(&l_hsm, &msg);
+        if (strcmp(log, l_script[i].expected) != 0)
+        {
+            fprintf(stderr, "hsm step %u: expected \"%s\", got \"%s\"\n", (unsigned)i,
+                    l_script[i].expected, log);
+            failed++;
+        }
+    }
+    l_log = NULL;
+
+    if (!hsm_is_in(&l_hsm, &l_s11) || !hsm_is_in(&l_hsm, &l_s) || hsm_is_in(&l_hsm, &l_t))
+    {
+        fprintf(stderr, "hsm ended outside s11\n");
+        failed++;
+    }
+
+    bench_report(SUITE, "order", sizeof(l_script) / sizeof(l_script[0]), "failed", failed, "count");
+    if (failed != 0)
+    {
+        abort();
+    }
+}
+
+/**
+ * @brief Time DISPATCHES messages alternating between two signals
+ *
+ * @param name Benchmark name to report under
+ * @param first Signal of even dispatches
+ * @param second Signal of odd dispatches
+ */
+static void bench_hsm_measure(char const *name, signal_t first, signal_t second)
+{
+    actor_msg_t const msgs[2] = { { .sig = first }, { .sig = second } };
+    static actor_msg_t const init = { .sig = INIT_SIG };
+
+    hsm_init(&l_hsm, &l_def, l_paths, NULL);
+    hsm_dispatch(&l_hsm, &init);
+    uint32_t start = ACTOR_PORT_CYCLES();
+    for (uint32_t i = 0; i < DISPATCHES; i++)
+    {
+        hsm_dispatch(&l_hsm, &msgs[i & 1]);
+    }
+    double const hsm = (double)(ACTOR_PORT_CYCLES() - start) / DISPATCHES;
+
+    l_flat_state = FLAT_S11;
+    start = ACTOR_PORT_CYCLES();
+    for (uint32_t i = 0; i < DISPATCHES; i++)
+    {
+        bench_hsm_flat(&msgs[i & 1]);
+    }
+    double const flat = (double)(ACTOR_PORT_CYCLES() - start) / DISPATCHES;
+
+    bench_report(SUITE, name, DISPATCHES, "hsm_cycles", hsm, "cycles");
+    bench_report(SUITE, name, DISPATCHES, "flat_cycles", flat, "cycles");
+}
+
+// Described in .h
+void bench_hsm(void)
+{
+    bench_hsm_check();
+    bench_hsm_measure("leaf_transition", A_SIG, K_SIG);
+    bench_hsm_measure("handled_in_top", G_SIG, G_SIG);
+}
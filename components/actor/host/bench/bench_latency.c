@@ -0,0 +1,129 @@
+/**
+ * @file bench_latency.c
+ * @brief Post to dispatch round-trip latency
+ *
+ * The runner posts a message and blocks until the actor's dispatch handler
+ * notifies it back, for task-per-actor actors and for actors on the shared
+ * worker pool.  1, 10, 50 and 200 actors are started and pinged in turn, so
+ * the figure includes whatever the scheduler pays for the idle ones.  Each
+ * mode stops its actors before the next starts, to stay within
+ * CONFIG_ACTOR_MAX_ACTORS.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_sched.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "latency"
+
+/** Largest number of actors measured per mode */
+#define ACTORS_MAX 200
+
+/** Round trips measured per number of actors */
+#define SAMPLES 10000
+
+/** Round trips run before measuring */
+#define WARMUP 100
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_latency_signals {
+    PING_SIG = USER_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_msg_t const l_ping = { .sig = PING_SIG };
+
+static actor_t *l_actors[ACTORS_MAX];
+
+static uint64_t l_samples[SAMPLES];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler answering every ping with a task notification
+ */
+static void bench_latency_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == PING_SIG)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Measure round trips through 1, 10, 50 and 200 actors, then stop them
+ *
+ * @param name Benchmark name to report under
+ * @param pooled Start the actors on the worker pool instead of their own task
+ */
+static void bench_latency_run(char const *name, bool pooled)
+{
+    static uint32_t const counts[] = { 1, 10, 50, ACTORS_MAX };
+    uint32_t started = 0;
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        for (; started < counts[c]; started++)
+        {
+            l_actors[started] = NULL;
+            actor_ctor(NULL, &l_actors[started], bench_latency_dispatch);
+            if (pooled)
+            {
+                actor_start_pooled(l_actors[started], 0, 4, 0);
+            }
+            else
+            {
+                actor_start(l_actors[started], BENCH_ACTOR_PRIO, 4, BENCH_STACK_SIZE);
+            }
+        }
+
+        for (uint32_t i = 0; i < WARMUP; i++)
+        {
+            actor_post(l_actors[i % started], &l_ping);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        for (uint32_t i = 0; i < SAMPLES; i++)
+        {
+            actor_t * const me = l_actors[i % started];
+            uint64_t const start = bench_now_ns();
+            actor_post(me, &l_ping);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            l_samples[i] = bench_now_ns() - start;
+        }
+
+        bench_report_samples(SUITE, name, started, l_samples, SAMPLES);
+    }
+
+    for (uint32_t i = 0; i < started; i++)
+    {
+        actor_stop(l_actors[i]);
+        actor_dtor(l_actors[i]);
+        l_actors[i] = NULL;
+    }
+    // Let the idle task reclaim the deleted tasks
+    vTaskDelay(10);
+}
+
+// Described in .h
+void bench_latency(void)
+{
+    bench_latency_run("round_trip", false);
+    bench_latency_run("round_trip_pooled", true);
+}
@@ -0,0 +1,239 @@
+/**
+ * @file bench_layout.c
+ * @brief Dispatch cost and memory per actor, separate versus embedded objects
+ *
+ * Every actor keeps a counter and a few more bytes of private state.  In the
+ * separate layout, the one the blinky example used, the actor object comes
+ * from actor_ctor and the state from its own allocation, which the handler
+ * finds through a table indexed by the actor's id.  In the embedded layout
+ * the state struct starts with an actor_object_t and the handler casts `me`.
+ *
+ * Messages are handed to actor_dispatch_one directly, in a shuffled order,
+ * so the numbers are the cost of reaching the actor and its state without a
+ * queue or a task switch.  The cold runs evict the caches before every round,
+ * as for actors the target keeps in external RAM.  Memory per actor is the
+ * malloc heap taken, allocator overhead included, plus any static storage.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_priv.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "layout"
+
+/** Actors per layout */
+#define NUM_ACTORS 64
+
+/** Rounds over every actor with warm caches */
+#define HOT_ROUNDS 20000
+
+/** Rounds over every actor with cold caches */
+#define COLD_ROUNDS 200
+
+/** Bytes written to evict the caches */
+#define EVICT_BYTES (32u * 1024u * 1024u)
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_layout_signals {
+    TICK_SIG = USER_SIG,
+};
+
+/** Private state of an actor */
+typedef struct {
+    uint32_t count;             ///< Messages handled
+    uint8_t data[28];           ///< Rest of the state
+} bench_layout_state_t;
+
+/** Actor with its object embedded by value */
+typedef struct {
+    actor_object_t super;       ///< Base class
+    bench_layout_state_t state; ///< Private state
+} bench_layout_actor_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_msg_t const l_tick = { .sig = TICK_SIG };
+
+/** Private state of the separate layout, indexed by actor id */
+static bench_layout_state_t *l_states[CONFIG_ACTOR_MAX_ACTORS];
+
+static bench_layout_actor_t l_embedded[NUM_ACTORS];
+
+/** Order actors are dispatched in; the same for both layouts */
+static uint16_t l_order[NUM_ACTORS];
+
+static uint8_t *l_evict = NULL;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of the separate layout
+ */
+static void bench_layout_separate(actor_t * const me, actor_msg_t const * const msg)
+{
+    l_states[actor_get_id(me)]->count++;
+}
+
+/**
+ * @brief Dispatch handler of the embedded layout
+ */
+static void bench_layout_embedded(actor_t * const me, actor_msg_t const * const msg)
+{
+    ((bench_layout_actor_t *)me)->state.count++;
+}
+
+/**
+ * @brief Heap taken from malloc
+ */
+static size_t bench_layout_heap(void)
+{
+    return mallinfo2().uordblks;
+}
+
+/**
+ * @brief Write over a buffer larger than the caches
+ */
+static void bench_layout_evict(void)
+{
+    for (size_t i = 0; i < EVICT_BYTES; i += 64)
+    {
+        l_evict[i]++;
+    }
+    __asm__ volatile("" : : "r"(l_evict) : "memory");
+}
+
+/**
+ * @brief Dispatch a message to every actor, round after round
+ *
+ * @param name Benchmark name to report under
+ * @param actors Actors of the layout
+ * @param cold Evict the caches before every round
+ */
+static void bench_layout_dispatch(char const *name, actor_t * const actors[], bool cold)
+{
+    actor_envelope_t const env = { .msg = &l_tick };
+    uint32_t const rounds = cold ? COLD_ROUNDS : HOT_ROUNDS;
+    uint64_t elapsed = 0;
+
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        if (cold)
+        {
+            bench_layout_evict();
+        }
+        uint64_t const start = bench_now_ns();
+        for (uint16_t i = 0; i < NUM_ACTORS; i++)
+        {
+            actor_dispatch_one(actors[l_order[i]], &env);
+        }
+        elapsed += bench_now_ns() - start;
+    }
+
+    bench_report(SUITE, name, NUM_ACTORS, cold ? "dispatch_cold" : "dispatch_hot",
+                 (double)elapsed / ((double)rounds * NUM_ACTORS), "ns");
+}
+
+/**
+ * @brief Construct the actors of the separate layout
+ *
+ * @param actors Filled with the actors
+ * @return Bytes per actor
+ */
+static double bench_layout_separate_ctor(actor_t *actors[])
+{
+    size_t const before = bench_layout_heap();
+
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        actors[i] = NULL;
+        actor_ctor(NULL, &actors[i], bench_layout_separate);
+        bench_layout_state_t * const state = malloc(sizeof(*state));
+        memset(state, 0, sizeof(*state));
+        l_states[actor_get_id(actors[i])] = state;
+    }
+
+    // Plus the actor's entry of the table
+    return (double)(bench_layout_heap() - before) / NUM_ACTORS + (double)sizeof(l_states[0]);
+}
+
+/**
+ * @brief Construct the actors of the embedded layout
+ *
+ * @param actors Filled with the actors
+ * @return Bytes per actor
+ */
+static double bench_layout_embedded_ctor(actor_t *actors[])
+{
+    size_t const before = bench_layout_heap();
+
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        actors[i] = (actor_t *)&l_embedded[i].super;
+        actor_ctor(NULL, &actors[i], bench_layout_embedded);
+    }
+
+    return (double)(bench_layout_heap() - before) / NUM_ACTORS + (double)sizeof(bench_layout_actor_t);
+}
+
+// Described in .h
+void bench_layout(void)
+{
+    actor_t *separate[NUM_ACTORS];
+    actor_t *embedded[NUM_ACTORS];
+
+    // Fixed shuffle, so that neither layout gets a sequential walk
+    uint32_t seed = 12345;
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        l_order[i] = i;
+    }
+    for (uint16_t i = NUM_ACTORS - 1; i > 0; i--)
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint16_t const j = (uint16_t)((seed >> 16) % (i + 1u));
+        uint16_t const tmp = l_order[i];
+        l_order[i] = l_order[j];
+        l_order[j] = tmp;
+    }
+    l_evict = calloc(EVICT_BYTES, 1);
+
+    double const separate_bytes = bench_layout_separate_ctor(separate);
+    double const embedded_bytes = bench_layout_embedded_ctor(embedded);
+
+    bench_report(SUITE, "actor_object", 1, "size", (double)sizeof(actor_t), "B");
+    bench_report(SUITE, "actor_object", 1, "hot_bytes", (double)offsetof(struct actor_s, coalesce), "B");
+    bench_report(SUITE, "separate", NUM_ACTORS, "bytes_per_actor", separate_bytes, "B");
+    bench_report(SUITE, "embedded", NUM_ACTORS, "bytes_per_actor", embedded_bytes, "B");
+
+    bench_layout_dispatch("separate", separate, false);
+    bench_layout_dispatch("embedded", embedded, false);
+    bench_layout_dispatch("separate", separate, true);
+    bench_layout_dispatch("embedded", embedded, true);
+
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        uint16_t const id = actor_get_id(separate[i]);
+        free(l_states[id]);
+        l_states[id] = NULL;
+        actor_dtor(separate[i]);
+        actor_dtor(embedded[i]);
+    }
+    free(l_evict);
+    l_evict = NULL;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file bench_lifecycle.c
+ * @brief Restart latency under a supervisor and create/destroy memory stability
+ *
+ * A supervisor restarts a child in static storage each time the runner
+ * reports the child failed; the latency runs from actor_fail to the child's
+ * INIT_SIG.  The same is measured for a pooled child, and for a child that
+ * hangs and is killed by the watchdog.  Finally actors are created, started,
+ * stopped and destroyed more often than there are actor ids, and the FreeRTOS
+ * heap is compared before and after.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_sched.h"
+#include "actor_supervisor.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "lifecycle"
+
+/** Restarts measured per benchmark */
+#define SAMPLES 1000
+
+/** Restarts run before measuring */
+#define WARMUP 10
+
+/** Hangs measured; each costs a few ticks */
+#define HANGS 20
+
+/** Ticks a child may spend in one dispatch */
+#define WATCHDOG_TICKS 5
+
+/** Ticks between checks of the supervisor */
+#define CHECK_TICKS 1
+
+/** Create/start/stop/destroy cycles; more than there are actor ids */
+#define CYCLES 1000
+
+/** Queue length of every child */
+#define QUEUE_LENGTH 4
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_lifecycle_signals {
+    HANG_SIG = USER_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_msg_t const l_hang = { .sig = HANG_SIG };
+
+static actor_supervisor_t l_supervisor;
+
+ACTOR_STORAGE(l_child_storage, QUEUE_LENGTH, BENCH_STACK_SIZE);
+
+static uint64_t l_samples[SAMPLES];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of the supervisor; restarts are left to the framework
+ */
+static void bench_lifecycle_supervisor(actor_t * const me, actor_msg_t const * const msg)
+{
+}
+
+/**
+ * @brief Dispatch handler of a child; notifies the runner on every INIT_SIG
+ */
+static void bench_lifecycle_child(actor_t * const me, actor_msg_t const * const msg)
+{
+    switch (msg->sig)
+    {
+        case INIT_SIG:
+            xTaskNotifyGive(bench_runner());
+            break;
+
+        case HANG_SIG:
+            // Blocks rather than spins, so the simulated CPU keeps running
+            while (1)
+            {
+                vTaskDelay(1);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Dispatch handler of the actors created and destroyed in a loop
+ */
+static void bench_lifecycle_idle(actor_t * const me, actor_msg_t const * const msg)
+{
+}
+
+/**
+ * @brief Measure restarts of a child reported failed by the runner
+ *
+ * @param child Running child of a supervisor; its INIT_SIG was consumed
+ * @param name Benchmark name to report under
+ */
+static void bench_lifecycle_restart(actor_t * const child, char const *name)
+{
+    for (uint32_t i = 0; i < WARMUP + SAMPLES; i++)
+    {
+        uint64_t const start = bench_now_ns();
+        actor_fail(child);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (i >= WARMUP)
+        {
+            l_samples[i - WARMUP] = bench_now_ns() - start;
+        }
+    }
+
+    bench_report_samples(SUITE, name, 1, l_samples, SAMPLES);
+}
+
+/**
+ * @brief Measure recovery of a child that hangs in a dispatch
+ *
+ * @param child Running child of a supervisor with a watchdog period
+ */
+static void bench_lifecycle_hang(actor_t * const child)
+{
+    actor_set_watchdog(child, WATCHDOG_TICKS);
+    actor_set_killable(child, true);
+
+    for (uint32_t i = 0; i < HANGS; i++)
+    {
+        uint64_t const start = bench_now_ns();
+        actor_post(child, &l_hang);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        l_samples[i] = bench_now_ns() - start;
+    }
+
+    actor_set_watchdog(child, 0);
+    actor_set_killable(child, false);
+    bench_report_samples(SUITE, "hang_recovery", WATCHDOG_TICKS, l_samples, HANGS);
+}
+
+/**
+ * @brief Create, start, stop and destroy actors and compare the heap
+ */
+static void bench_lifecycle_churn(void)
+{
+    // Let the idle task reclaim tasks deleted by earlier suites
+    vTaskDelay(10);
+    size_t const free_before = xPortGetFreeHeapSize();
+    uint64_t const start = bench_now_ns();
+
+    for (uint32_t i = 0; i < CYCLES; i++)
+    {
+        actor_t *me = NULL;
+        actor_ctor(NULL, &me, bench_lifecycle_idle);
+        if (i % 2 == 0)
+        {
+            actor_start(me, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+        }
+        else
+        {
+            actor_start_pooled(me, 0, QUEUE_LENGTH, 0);
+        }
+        actor_stop(me);
+        actor_dtor(me);
+    }
+
+    double const elapsed_us = (bench_now_ns() - start) / 1000.0;
+    vTaskDelay(10);
+    bench_report(SUITE, "create_destroy", CYCLES, "per_cycle", elapsed_us / CYCLES, "us");
+    bench_report(SUITE, "create_destroy", CYCLES, "heap_delta",
+                 (double)free_before - (double)xPortGetFreeHeapSize(), "B");
+}
+
+// Described in .h
+void bench_lifecycle(void)
+{
+    actor_t *supervisor = NULL;
+    actor_t *child = NULL;
+    actor_t *pooled = NULL;
+
+    actor_ctor(NULL, &supervisor, bench_lifecycle_supervisor);
+    actor_supervise(supervisor, &l_supervisor, ACTOR_RESTART_ONE_FOR_ONE, CHECK_TICKS);
+    actor_ctor(supervisor, &child, bench_lifecycle_child);
+    actor_ctor(supervisor, &pooled, bench_lifecycle_child);
+    actor_start(supervisor, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+    actor_start_static(child, BENCH_ACTOR_PRIO, &l_child_storage);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    actor_start_pooled(pooled, 0, QUEUE_LENGTH, 0);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    bench_lifecycle_restart(child, "restart_task");
+    bench_lifecycle_restart(pooled, "restart_pooled");
+    bench_lifecycle_hang(child);
+
+    bench_report(SUITE, "restarts", 1, "count", l_supervisor.restarts, "restarts");
+
+    bench_lifecycle_churn();
+}
@@ -0,0 +1,215 @@
+/**
+ * @file bench_mailbox.c
+ * @brief Urgent lane and signal coalescing under a saturated mailbox
+ *
+ * `urgent` fills the queue of a slow actor and measures how long a normal
+ * and an urgent message take to be dispatched.  `coalesce` floods a slow
+ * actor with one signal, with and without actor_coalesce, and reports how
+ * deep the queue gets and how many posts were lost.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_priv.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "mailbox"
+
+/** Queue length of the measured actors */
+#define QUEUE_LENGTH 32
+
+/** Slots kept for the urgent lane */
+#define RESERVE 2
+
+/** Messages queued ahead of the measured one */
+#define FILL (QUEUE_LENGTH - RESERVE - 1)
+
+/** Time the handler spends on each message */
+#define WORK_NS 20000u
+
+/** Measurements per lane */
+#define SAMPLES 100
+
+/** Posts made by the coalescing flood */
+#define FLOOD 2000
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_mailbox_signals {
+    FILL_SIG = USER_SIG,
+    PROBE_SIG,
+    TICK_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_msg_t const l_fill = { .sig = FILL_SIG };
+static actor_msg_t const l_probe = { .sig = PROBE_SIG };
+static actor_msg_t const l_tick = { .sig = TICK_SIG };
+
+/** Time the probe was dispatched */
+static uint64_t volatile l_probe_ns;
+
+/** Dispatches of TICK_SIG and posts merged into them */
+static uint32_t volatile l_ticks;
+static uint32_t volatile l_merged;
+
+static uint64_t l_samples[SAMPLES];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Spin for WORK_NS to model a slow handler
+ */
+static void bench_mailbox_work(void)
+{
+    uint64_t const until = bench_now_ns() + WORK_NS;
+
+    while (bench_now_ns() < until)
+    {
+    }
+}
+
+/**
+ * @brief Dispatch handler of the slow actors
+ */
+static void bench_mailbox_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    switch (msg->sig)
+    {
+    case FILL_SIG:
+        bench_mailbox_work();
+        break;
+    case PROBE_SIG:
+        l_probe_ns = bench_now_ns();
+        xTaskNotifyGive(bench_runner());
+        break;
+    case TICK_SIG:
+        l_ticks++;
+        l_merged += actor_get_coalesced(me);
+        bench_mailbox_work();
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Wait until the actor's queue is empty
+ */
+static void bench_mailbox_drain(actor_t * const me)
+{
+    while (uxQueueMessagesWaiting(me->msg_queue) != 0)
+    {
+        vTaskDelay(1);
+    }
+    vTaskDelay(1);
+}
+
+/**
+ * @brief Measure dispatch delay of a probe behind FILL queued messages
+ *
+ * @param me Slow actor
+ * @param urgent Post the probe to the urgent lane
+ */
+static void bench_mailbox_probe(actor_t * const me, bool urgent)
+{
+    for (uint32_t i = 0; i < SAMPLES; i++)
+    {
+        for (uint32_t f = 0; f < FILL; f++)
+        {
+            actor_post(me, &l_fill);
+        }
+
+        uint64_t const start = bench_now_ns();
+        if (urgent)
+        {
+            actor_post_urgent(me, &l_probe);
+        }
+        else
+        {
+            actor_post(me, &l_probe);
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        l_samples[i] = l_probe_ns - start;
+
+        bench_mailbox_drain(me);
+    }
+
+    bench_report_samples(SUITE, urgent ? "urgent" : "normal", FILL, l_samples, SAMPLES);
+}
+
+/**
+ * @brief Flood a slow actor with TICK_SIG
+ *
+ * @param me Slow actor
+ * @param name Benchmark name to report under
+ */
+static void bench_mailbox_flood(actor_t * const me, char const *name)
+{
+    UBaseType_t depth_max = 0;
+
+    l_ticks = 0;
+    l_merged = 0;
+    for (uint32_t i = 0; i < FLOOD; i++)
+    {
+        actor_post(me, &l_tick);
+
+        UBaseType_t const depth = uxQueueMessagesWaiting(me->msg_queue);
+        if (depth > depth_max)
+        {
+            depth_max = depth;
+        }
+        if ((i % 64u) == 63u)
+        {
+            // Let the actor make some progress, like a periodic producer would
+            vTaskDelay(1);
+        }
+    }
+    bench_mailbox_drain(me);
+
+    bench_report(SUITE, name, FLOOD, "queue_depth_max", depth_max, "count");
+    bench_report(SUITE, name, FLOOD, "dispatched", l_ticks, "count");
+    bench_report(SUITE, name, FLOOD, "lost", FLOOD - l_ticks - l_merged, "count");
+}
+
+// Described in .h
+void bench_mailbox(void)
+{
+    actor_t *lanes = NULL;
+    actor_t *plain = NULL;
+    actor_t *coalesced = NULL;
+
+    actor_ctor(NULL, &lanes, bench_mailbox_dispatch);
+    actor_set_urgent_reserve(lanes, RESERVE);
+    actor_start(lanes, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+
+    // Outrank the actor so that the queue fills before it runs
+    vTaskPrioritySet(NULL, BENCH_ACTOR_PRIO + 1);
+    bench_mailbox_probe(lanes, false);
+    bench_mailbox_probe(lanes, true);
+    vTaskPrioritySet(NULL, BENCH_RUNNER_PRIO);
+
+    actor_ctor(NULL, &plain, bench_mailbox_dispatch);
+    actor_start(plain, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+    bench_mailbox_flood(plain, "flood");
+
+    actor_ctor(NULL, &coalesced, bench_mailbox_dispatch);
+    actor_coalesce(coalesced, TICK_SIG);
+    actor_start(coalesced, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+    bench_mailbox_flood(coalesced, "flood_coalesced");
+}
@@ -0,0 +1,220 @@
+/**
+ * @file bench_main.c
+ * @brief Runner for the host benchmark suite
+ *
+ * Usage: actor_bench [suite...]
+ *
+ * Runs every suite, or only the named ones, and writes the results to stdout
+ * as JSON lines (see bench.h).  Diagnostics go to stderr.
+ */
+
+#include "bench.h"
+
+#include "actor_sched.h"
+#include "time_event.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <sdkconfig.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Number of entries in a fixed array */
+#define COUNT_OF(a_) (sizeof(a_) / sizeof((a_)[0]))
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** A named benchmark suite */
+typedef struct bench_suite_s {
+    char const *name;
+    BenchSuiteHandler run;
+} bench_suite_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Task running the selected suites, then exiting the process
+ *
+ * @param pdata Unused
+ */
+static void bench_run(void *pdata);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/**
+ * Available suites.  Most suites create their actors once and keep them;
+ * power and tick run first, before the supervisor of lifecycle keeps a time
+ * event due on every tick, and memory runs last because it creates the most.
+ */
+static bench_suite_t const l_suites[] = {
+    { "power", bench_power },
+    { "tick", bench_tick },
+    { "latency", bench_latency },
+    { "request", bench_request },
+    { "pubsub", bench_pubsub },
+    { "affinity", bench_affinity },
+    { "lifecycle", bench_lifecycle },
+    { "throughput", bench_throughput },
+    { "overhead", bench_overhead },
+    { "mailbox", bench_mailbox },
+    { "flow", bench_flow },
+    { "timer", bench_timer },
+    { "event", bench_event },
+    { "hsm", bench_hsm },
+    { "channel", bench_channel },
+    { "remote", bench_remote },
+    { "replay", bench_replay },
+    { "sizing", bench_sizing },
+    { "layout", bench_layout },
+    { "memory", bench_memory },
+};
+
+/** Suites selected on the command line */
+static bool l_selected[COUNT_OF(l_suites)];
+
+static TaskHandle_t l_runner = NULL;
+
+static BenchTickHandler volatile l_tick_handler = NULL;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Described in .h
+void bench_report(char const *suite, char const *name, uint32_t param, char const *metric,
+                  double value, char const *unit)
+{
+    printf("{\"suite\":\"%s\",\"name\":\"%s\",\"param\":%u,\"metric\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n",
+           suite, name, (unsigned)param, metric, value, unit);
+    fflush(stdout);
+}
+
+/**
+ * @brief qsort comparator for uint64_t samples
+ */
+static int bench_cmp_u64(void const *a, void const *b)
+{
+    uint64_t const x = *(uint64_t const *)a;
+    uint64_t const y = *(uint64_t const *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Described in .h
+void bench_report_samples(char const *suite, char const *name, uint32_t param,
+                          uint64_t *samples, uint32_t count)
+{
+    double sum = 0.0;
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    qsort(samples, count, sizeof(samples[0]), bench_cmp_u64);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sum += (double)samples[i];
+    }
+
+    bench_report(suite, name, param, "mean", sum / count / 1000.0, "us");
+    bench_report(suite, name, param, "p50", samples[count / 2] / 1000.0, "us");
+    bench_report(suite, name, param, "p99", samples[(count * 99u) / 100u] / 1000.0, "us");
+    bench_report(suite, name, param, "max", samples[count - 1] / 1000.0, "us");
+}
+
+// Described in .h
+void bench_set_tick_handler(BenchTickHandler handler)
+{
+    l_tick_handler = handler;
+}
+
+// Described in .h
+TaskHandle_t bench_runner(void)
+{
+    return l_runner;
+}
+
+// Described above
+static void bench_run(void *pdata)
+{
+    for (size_t i = 0; i < COUNT_OF(l_suites); i++)
+    {
+        if (l_selected[i])
+        {
+            fprintf(stderr, "running %s\n", l_suites[i].name);
+            l_suites[i].run();
+        }
+    }
+
+    fflush(stdout);
+    exit(EXIT_SUCCESS);
+}
+
+void vApplicationTickHook(void)
+{
+    BenchTickHandler const handler = l_tick_handler;
+
+    if (handler != NULL)
+    {
+        handler();
+    }
+}
+
+void vAssertCalled(const char * const file, unsigned long line)
+{
+    fprintf(stderr, "FreeRTOS assertion failed at %s:%lu\n", file, line);
+    abort();
+}
+
+int main(int argc, char **argv)
+{
+    for (size_t i = 0; i < COUNT_OF(l_suites); i++)
+    {
+        l_selected[i] = (argc < 2);
+        for (int a = 1; a < argc; a++)
+        {
+            if (strcmp(argv[a], l_suites[i].name) == 0)
+            {
+                l_selected[i] = true;
+            }
+        }
+    }
+
+    time_event_init();
+    actor_sched_start(BENCH_ACTOR_PRIO, BENCH_STACK_SIZE);
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    bench_set_tick_handler(time_event_tick);
+#endif
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+    time_event_start_drain(BENCH_DRAIN_PRIO, BENCH_STACK_SIZE);
+#endif
+
+    xTaskCreate(bench_run, "bench", BENCH_STACK_SIZE, NULL, BENCH_RUNNER_PRIO, &l_runner);
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
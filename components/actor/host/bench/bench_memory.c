@@ -0,0 +1,134 @@
+/**
+ * @file bench_memory.c
+ * @brief Memory and startup time per actor
+ *
+ * Actors are constructed and started in steps of 10, 50 and 200 and the
+ * FreeRTOS heap is sampled at each step, for task-per-actor actors, pooled
+ * actors and task-per-actor actors in static storage.  The actor object
+ * itself comes from malloc, so its size is added to the heap delta.  Each
+ * mode stops and destroys its actors before the next starts, to stay within
+ * CONFIG_ACTOR_MAX_ACTORS.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_priv.h"
+#include "actor_sched.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "memory"
+
+/** Queue length of every actor */
+#define QUEUE_LENGTH 8
+
+/** Largest number of actors measured per mode */
+#define ACTORS_MAX 200
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** How the measured actors are started */
+typedef enum {
+    MODE_TASK,      ///< actor_start
+    MODE_POOLED,    ///< actor_start_pooled
+    MODE_STATIC,    ///< actor_start_static
+} bench_memory_mode_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_t *l_actors[ACTORS_MAX];
+
+static uint8_t l_queue_buffers[ACTORS_MAX][QUEUE_LENGTH * ACTOR_QUEUE_ITEM_SIZE];
+static StaticQueue_t l_queues[ACTORS_MAX];
+static StackType_t l_stacks[ACTORS_MAX][BENCH_STACK_SIZE];
+static StaticTask_t l_tcbs[ACTORS_MAX];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler that ignores everything
+ */
+static void bench_memory_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+}
+
+/**
+ * @brief Create actors up to each step and report memory and time per actor,
+ *        then stop and destroy them
+ *
+ * @param name Benchmark name to report under
+ * @param mode How to start the actors
+ */
+static void bench_memory_run(char const *name, bench_memory_mode_t mode)
+{
+    static uint32_t const steps[] = { 10, 50, ACTORS_MAX };
+
+    // Let the idle task reclaim tasks deleted by the previous mode
+    vTaskDelay(10);
+    size_t const free_before = xPortGetFreeHeapSize();
+    uint64_t elapsed = 0;
+    uint32_t created = 0;
+
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++)
+    {
+        for (; created < steps[s]; created++)
+        {
+            actor_storage_t const storage = {
+                QUEUE_LENGTH, l_queue_buffers[created], &l_queues[created],
+                BENCH_STACK_SIZE, l_stacks[created], &l_tcbs[created]
+            };
+            actor_t *me = NULL;
+            uint64_t const start = bench_now_ns();
+
+            actor_ctor(NULL, &me, bench_memory_dispatch);
+            l_actors[created] = me;
+            switch (mode)
+            {
+            case MODE_TASK:
+                actor_start(me, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+                break;
+            case MODE_POOLED:
+                actor_start_pooled(me, 0, QUEUE_LENGTH, 0);
+                break;
+            case MODE_STATIC:
+                actor_start_static(me, BENCH_ACTOR_PRIO, &storage);
+                break;
+            }
+            elapsed += bench_now_ns() - start;
+        }
+
+        size_t const used = free_before - xPortGetFreeHeapSize() + created * sizeof(actor_t);
+        bench_report(SUITE, name, created, "heap_per_actor", (double)used / created, "B");
+        bench_report(SUITE, name, created, "start_per_actor", elapsed / 1000.0 / created, "us");
+    }
+
+    for (uint32_t i = 0; i < created; i++)
+    {
+        actor_stop(l_actors[i]);
+        actor_dtor(l_actors[i]);
+        l_actors[i] = NULL;
+    }
+}
+
+// Described in .h
+void bench_memory(void)
+{
+    bench_report(SUITE, "actor_object", 1, "size", (double)sizeof(actor_t), "B");
+    bench_report(SUITE, "envelope", 1, "size", (double)sizeof(actor_envelope_t), "B");
+
+    bench_memory_run("task", MODE_TASK);
+    bench_memory_run("pooled", MODE_POOLED);
+    bench_memory_run("static", MODE_STATIC);
+}
@@ -0,0 +1,200 @@
+/**
+ * @file bench_overhead.c
+ * @brief Cost of the optional instrumentation on post and dispatch
+ *
+ * Statistics and tracing are compiled in or out, so the suite reports which
+ * options the build has and the same costs in every build; run it from builds
+ * with -DACTOR_HOST_STATS and -DACTOR_HOST_TRACE ON and OFF and compare.
+ * "dispatch" hands a message to actor_dispatch_one directly and counts cycles
+ * per call; "trace_record" counts cycles per trace record appended, 0 without
+ * tracing.  Both drain the trace buffer between rounds, outside the timing,
+ * so every record is stored rather than counted as lost.  "post_dispatch"
+ * streams messages through a running actor and reports the time per message;
+ * it does not drain, so once the buffer is full its records are lost ones.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_port.h"
+#include "actor_priv.h"
+#include "actor_trace.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "overhead"
+
+/** Dispatches between drains; two records each must fit the trace buffer */
+#define ROUND 256
+
+/** Direct dispatches measured */
+#define DISPATCHES (4000 * ROUND)
+
+/** Trace records appended directly */
+#define RECORDS (2000 * 2 * ROUND)
+
+/** Messages streamed through the running actor */
+#define MESSAGES 200000
+
+/** Queue length of the running actor */
+#define QUEUE_LENGTH 32
+
+#if CONFIG_ACTOR_STATS
+#define BUILD_STATS 1
+#else
+#define BUILD_STATS 0
+#endif
+
+#if CONFIG_ACTOR_TRACE
+#define BUILD_TRACE 1
+#else
+#define BUILD_TRACE 0
+#endif
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_overhead_signals {
+    WORK_SIG = USER_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_msg_t const l_work = { .sig = WORK_SIG };
+
+/** Messages handled by the running actor */
+static uint32_t l_handled = 0;
+
+/** Messages the running actor notifies the runner after */
+static uint32_t l_expected = 0;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler; notifies the runner once the stream is handled
+ */
+static void bench_overhead_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == WORK_SIG && ++l_handled == l_expected)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+#if CONFIG_ACTOR_TRACE
+/**
+ * @brief Trace writer that throws the frames away
+ */
+static void bench_overhead_discard(void *ctx, void const *data, size_t len)
+{
+}
+#endif
+
+/**
+ * @brief Empty the trace buffer
+ */
+static void bench_overhead_drain(void)
+{
+#if CONFIG_ACTOR_TRACE
+    actor_trace_drain(bench_overhead_discard, NULL);
+#endif
+}
+
+/**
+ * @brief Cycles per direct dispatch to an actor that is not started
+ */
+static void bench_overhead_direct(void)
+{
+    actor_t *me = NULL;
+    actor_envelope_t env = { .msg = &l_work };
+    uint64_t cycles = 0;
+
+    actor_ctor(NULL, &me, bench_overhead_dispatch);
+    l_expected = 0;
+    for (uint32_t done = 0; done < DISPATCHES; done += ROUND)
+    {
+        bench_overhead_drain();
+        uint32_t const start = ACTOR_PORT_CYCLES();
+        for (uint32_t i = 0; i < ROUND; i++)
+        {
+#if CONFIG_ACTOR_STATS
+            env.stamp = ACTOR_PORT_TIME_US();
+#endif
+            actor_dispatch_one(me, &env);
+        }
+        cycles += ACTOR_PORT_CYCLES() - start;
+    }
+    actor_dtor(me);
+
+    bench_report(SUITE, "dispatch", DISPATCHES, "cycles", (double)cycles / DISPATCHES, "cycles");
+}
+
+/**
+ * @brief Cycles per trace record appended
+ */
+static void bench_overhead_record(void)
+{
+    uint64_t cycles = 0;
+
+    for (uint32_t done = 0; done < RECORDS; done += 2 * ROUND)
+    {
+        bench_overhead_drain();
+        uint32_t const start = ACTOR_PORT_CYCLES();
+        for (uint32_t i = 0; i < 2 * ROUND; i++)
+        {
+            actor_trace_record(ACTOR_TRACE_POST, 0, WORK_SIG);
+        }
+        cycles += ACTOR_PORT_CYCLES() - start;
+    }
+    bench_overhead_drain();
+
+    bench_report(SUITE, "trace_record", RECORDS, "cycles", (double)cycles / RECORDS, "cycles");
+}
+
+/**
+ * @brief Time per message streamed through a running actor
+ */
+static void bench_overhead_stream(void)
+{
+    actor_t *me = NULL;
+
+    actor_ctor(NULL, &me, bench_overhead_dispatch);
+    actor_set_overflow(me, ACTOR_OVERFLOW_BLOCK, portMAX_DELAY, NULL);
+    actor_start(me, BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+
+    l_handled = 0;
+    l_expected = MESSAGES;
+    uint64_t const start = bench_now_ns();
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        actor_post(me, &l_work);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    double const ns = (double)(bench_now_ns() - start) / MESSAGES;
+
+    actor_stop(me);
+    actor_dtor(me);
+
+    bench_report(SUITE, "post_dispatch", MESSAGES, "time", ns, "ns");
+}
+
+// Described in .h
+void bench_overhead(void)
+{
+    bench_report(SUITE, "build", 1, "stats", BUILD_STATS, "bool");
+    bench_report(SUITE, "build", 1, "trace", BUILD_TRACE, "bool");
+
+    bench_overhead_direct();
+    bench_overhead_record();
+    bench_overhead_stream();
+}
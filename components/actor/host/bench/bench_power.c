@@ -0,0 +1,213 @@
+/**
+ * @file bench_power.c
+ * @brief Wakeups and sleep residency of a periodic workload with idle sleep
+ *
+ * Three actors run five periodic timers: a sampler at 10 and 50 ms, a logger
+ * at 100 ms and a radio that starts a transfer every 200 ms and keeps the
+ * system awake until it ends 5 ms later.  The runner sits below the actors'
+ * priority and plays the idle task, calling actor_power_idle in a loop.
+ *
+ * Light sleep is simulated: while asleep the tick hook drops ticks instead of
+ * processing them, as the stopped tick interrupt would, and the sleep reports
+ * how many were dropped.  An idle point that does not sleep waits for the next
+ * tick, which counts as a wakeup.  Without idle sleep every tick is a wakeup.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_power.h"
+#include "time_event.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "power"
+
+/** Length of the simulated run */
+#define RUN_MS 2000
+
+/** Shortest sleep taken; one tick */
+#define MIN_SLEEP_US ((uint64_t)portTICK_PERIOD_MS * 1000)
+
+/** Number of periodic timers */
+#define NUM_TIMERS 5
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_power_signals {
+    SAMPLE_SIG = USER_SIG,
+    FILTER_SIG,
+    LOG_SIG,
+    TX_START_SIG,
+    TX_END_SIG,
+};
+
+/** Periodic timer of the workload */
+typedef struct {
+    signal_t sig;               ///< Signal posted on expiry
+    uint8_t actor;              ///< Index of the receiving actor
+    uint32_t timeout;           ///< First expiry in ticks
+    uint32_t interval;          ///< Period in ticks
+} bench_power_timer_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static bench_power_timer_t const l_timer_specs[NUM_TIMERS] = {
+    { SAMPLE_SIG, 0, 10, 10 },
+    { FILTER_SIG, 0, 50, 50 },
+    { LOG_SIG, 1, 100, 100 },
+    { TX_START_SIG, 2, 200, 200 },
+    { TX_END_SIG, 2, 205, 200 },
+};
+
+static time_event_t l_timers[NUM_TIMERS];
+
+static actor_t *l_actors[3];
+
+/** Timer events dispatched during the run */
+static uint32_t l_events = 0;
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+/** Set while the simulated sleep has the tick stopped */
+static bool l_asleep = false;
+
+/** Ticks dropped during the current sleep */
+static uint32_t l_dropped = 0;
+#endif
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of all three actors
+ */
+static void bench_power_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig < USER_SIG)
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&l_events, 1, __ATOMIC_RELAXED);
+    if (msg->sig == TX_START_SIG)
+    {
+        actor_power_keep_awake(me, true);
+    }
+    else if (msg->sig == TX_END_SIG)
+    {
+        actor_power_keep_awake(me, false);
+    }
+}
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+/**
+ * @brief Tick handler; drops ticks while the simulated sleep runs
+ */
+static void bench_power_tick(void)
+{
+    if (__atomic_load_n(&l_asleep, __ATOMIC_ACQUIRE))
+    {
+        __atomic_add_fetch(&l_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    time_event_tick();
+}
+#endif
+
+/**
+ * @brief Simulated light sleep for the budget, capped at the run length
+ */
+static uint64_t bench_power_sleep(uint64_t budget_us)
+{
+    uint64_t ticks = budget_us / MIN_SLEEP_US;
+    if (ticks > RUN_MS / portTICK_PERIOD_MS)
+    {
+        ticks = RUN_MS / portTICK_PERIOD_MS;
+    }
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    __atomic_store_n(&l_dropped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&l_asleep, true, __ATOMIC_RELEASE);
+    vTaskDelay((TickType_t)ticks);
+    __atomic_store_n(&l_asleep, false, __ATOMIC_RELEASE);
+
+    return __atomic_load_n(&l_dropped, __ATOMIC_RELAXED) * MIN_SLEEP_US;
+#else
+    // The esp_timer clock keeps running through the simulated sleep
+    vTaskDelay((TickType_t)ticks);
+
+    return ticks * MIN_SLEEP_US;
+#endif
+}
+
+// Described in .h
+void bench_power(void)
+{
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        actor_ctor(NULL, &l_actors[i], bench_power_dispatch);
+        actor_start(l_actors[i], BENCH_ACTOR_PRIO, 8, BENCH_STACK_SIZE);
+    }
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    bench_set_tick_handler(bench_power_tick);
+#endif
+    actor_power_init(bench_power_sleep, MIN_SLEEP_US);
+
+    TickType_t const start_tick = xTaskGetTickCount();
+    uint64_t const start = bench_now_ns();
+    for (uint8_t i = 0; i < NUM_TIMERS; i++)
+    {
+        bench_power_timer_t const * const spec = &l_timer_specs[i];
+        time_event_ctor(&l_timers[i], spec->sig, l_actors[spec->actor]);
+        time_event_arm(&l_timers[i], spec->timeout, spec->interval);
+    }
+
+    // The runner only gets the CPU when every actor is blocked
+    uint32_t awake_ticks = 0;
+    while (bench_now_ns() - start < (uint64_t)RUN_MS * 1000000u)
+    {
+        if (!actor_power_idle())
+        {
+            vTaskDelay(1);
+            awake_ticks++;
+        }
+    }
+
+    for (uint8_t i = 0; i < NUM_TIMERS; i++)
+    {
+        time_event_disarm(&l_timers[i]);
+    }
+    double const seconds = (bench_now_ns() - start) / 1e9;
+    uint32_t const ticks = xTaskGetTickCount() - start_tick;
+
+    actor_power_stats_t stats;
+    actor_power_get_stats(&stats);
+    actor_power_init(NULL, 0);
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    bench_set_tick_handler(time_event_tick);
+#endif
+
+    bench_report(SUITE, "tick", NUM_TIMERS, "wakeups_per_s", ticks / seconds, "wakeups/s");
+    bench_report(SUITE, "idle_sleep", NUM_TIMERS, "wakeups_per_s", (stats.sleeps + awake_ticks) / seconds,
+                 "wakeups/s");
+    bench_report(SUITE, "idle_sleep", NUM_TIMERS, "residency", 100.0 * stats.slept_us / (seconds * 1e6), "%");
+    bench_report(SUITE, "idle_sleep", NUM_TIMERS, "vetoed", stats.vetoed, "count");
+    bench_report(SUITE, "idle_sleep", NUM_TIMERS, "timer_events_per_s", l_events / seconds, "events/s");
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        actor_stop(l_actors[i]);
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file bench_pubsub.c
+ * @brief Publish to dispatch latency for 1, 8 and 32 subscribers
+ *
+ * The runner publishes a pooled event and blocks until the last subscriber
+ * has handled it.  Subscribers are task-per-actor actors; more of them are
+ * subscribed for each measurement.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "event_pool.h"
+#include "pubsub.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "pubsub"
+
+/** Most subscribers measured */
+#define MAX_SUBSCRIBERS 32
+
+/** Publications measured per subscriber count */
+#define SAMPLES 2000
+
+/** Publications run before measuring */
+#define WARMUP 50
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_pubsub_signals {
+    NEWS_SIG = USER_SIG,
+    MAX_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_subscr_list_t l_subscr[MAX_SIG];
+
+static actor_t *l_subscribers[MAX_SUBSCRIBERS];
+
+/** Subscribers that still have to handle the current publication */
+static uint32_t l_remaining = 0;
+
+static uint64_t l_samples[SAMPLES];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of the subscribers; the last one notifies the runner
+ */
+static void bench_pubsub_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == NEWS_SIG && __atomic_sub_fetch(&l_remaining, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Publish one pooled event and wait for every subscriber to handle it
+ *
+ * @param subscribers Number of subscribed actors
+ * @return Time from publish to the last dispatch in nanoseconds
+ */
+static uint64_t bench_pubsub_once(uint32_t subscribers)
+{
+    actor_msg_t * const msg = event_new(sizeof(actor_msg_t), NEWS_SIG);
+
+    __atomic_store_n(&l_remaining, subscribers, __ATOMIC_RELEASE);
+    uint64_t const start = bench_now_ns();
+    actor_publish(msg);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return bench_now_ns() - start;
+}
+
+// Described in .h
+void bench_pubsub(void)
+{
+    static uint32_t const counts[] = { 1, 8, MAX_SUBSCRIBERS };
+    uint32_t subscribed = 0;
+
+    bench_event_pools();
+    actor_pubsub_init(l_subscr, MAX_SIG);
+
+    for (uint32_t i = 0; i < MAX_SUBSCRIBERS; i++)
+    {
+        actor_ctor(NULL, &l_subscribers[i], bench_pubsub_dispatch);
+        actor_start(l_subscribers[i], BENCH_ACTOR_PRIO, 4, BENCH_STACK_SIZE);
+    }
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        for (; subscribed < counts[c]; subscribed++)
+        {
+            actor_subscribe(l_subscribers[subscribed], NEWS_SIG);
+        }
+
+        for (uint32_t i = 0; i < WARMUP; i++)
+        {
+            bench_pubsub_once(subscribed);
+        }
+        for (uint32_t i = 0; i < SAMPLES; i++)
+        {
+            l_samples[i] = bench_pubsub_once(subscribed);
+        }
+        bench_report_samples(SUITE, "publish_to_last", subscribed, l_samples, SAMPLES);
+    }
+
+    for (uint32_t i = 0; i < MAX_SUBSCRIBERS; i++)
+    {
+        actor_unsubscribe_all(l_subscribers[i]);
+        actor_stop(l_subscribers[i]);
+        actor_dtor(l_subscribers[i]);
+        l_subscribers[i] = NULL;
+    }
+}
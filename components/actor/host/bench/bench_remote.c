@@ -0,0 +1,204 @@
+/**
+ * @file bench_remote.c
+ * @brief Message encoding cost and proxy frame rate over the loopback transport
+ *
+ * A sensor-style message is encoded and decoded in a loop to measure the
+ * cost per message.  The runner then posts the same message to a proxy whose
+ * frames go through the loopback transport to an endpoint that posts them to
+ * a local sink.  With the proxy above the runner's priority it tends to flush
+ * each message as it arrives; at the runner's priority it drains its queue in
+ * bursts and packs them into shared frames, up to the size of its buffer.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_remote.h"
+#include "event_pool.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_cpu.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "remote"
+
+/** Encodes and decodes measured */
+#define CODEC_ROUNDS 100000
+
+/** Messages sent through the proxy per run */
+#define MESSAGES 20000
+
+/** Queue length of the proxy; also its largest burst */
+#define PROXY_QUEUE 32
+
+/** Queue length of the sink; kept below the pool size so decoding never runs dry */
+#define SINK_QUEUE 4
+
+/** Size of the proxy's frame buffer */
+#define FRAME_SIZE 512
+
+/** Largest signal with a schema, plus one */
+#define MAX_SIGNAL (SAMPLE_SIG + 1)
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_remote_signals {
+    SAMPLE_SIG = USER_SIG,
+};
+
+/** Reading of a sensor, as sent between nodes */
+typedef struct {
+    actor_msg_t super;
+    uint32_t sensor;
+    int32_t temperature;
+    uint16_t flags;
+    float value;
+    uint8_t tag[8];
+} bench_remote_sample_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_field_t const l_sample_fields[] = {
+    ACTOR_FIELD(bench_remote_sample_t, sensor, ACTOR_FIELD_UINT),
+    ACTOR_FIELD(bench_remote_sample_t, temperature, ACTOR_FIELD_INT),
+    ACTOR_FIELD(bench_remote_sample_t, flags, ACTOR_FIELD_UINT),
+    ACTOR_FIELD(bench_remote_sample_t, value, ACTOR_FIELD_RAW),
+    ACTOR_FIELD(bench_remote_sample_t, tag, ACTOR_FIELD_RAW),
+};
+
+static actor_schema_t const l_sample_schema = ACTOR_SCHEMA(SAMPLE_SIG, bench_remote_sample_t, l_sample_fields);
+
+static actor_schema_t const *l_schemas[MAX_SIGNAL];
+
+static bench_remote_sample_t const l_sample = {
+    .super = { .sig = SAMPLE_SIG },
+    .sensor = 42,
+    .temperature = -125,
+    .flags = 0x0101,
+    .value = 3.5f,
+    .tag = "node-a",
+};
+
+static uint8_t l_frame[FRAME_SIZE];
+
+static actor_t *l_sink = NULL;
+
+static actor_endpoint_t l_endpoint;
+
+static actor_loopback_t l_loopback;
+
+/** Messages received by the sink in the current run */
+static uint32_t l_received = 0;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of the sink; notifies the runner after MESSAGES
+ */
+static void bench_remote_sink(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == SAMPLE_SIG && ++l_received == MESSAGES)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Measure encoding and decoding one sample
+ */
+static void bench_remote_codec(void)
+{
+    uint8_t buf[64];
+    size_t len = 0;
+
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < CODEC_ROUNDS; i++)
+    {
+        len = actor_schema_encode(&l_sample.super, buf, sizeof(buf));
+    }
+    uint32_t const encode = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < CODEC_ROUNDS; i++)
+    {
+        actor_msg_t *msg = NULL;
+        size_t used = 0;
+        actor_schema_decode(buf, len, &msg, &used);
+        event_gc(msg);
+    }
+    uint32_t const decode = esp_cpu_get_cycle_count() - start;
+
+    bench_report(SUITE, "encode", sizeof(bench_remote_sample_t), "cycles", (double)encode / CODEC_ROUNDS,
+                 "cycles");
+    bench_report(SUITE, "decode", sizeof(bench_remote_sample_t), "cycles", (double)decode / CODEC_ROUNDS,
+                 "cycles");
+    bench_report(SUITE, "encode", sizeof(bench_remote_sample_t), "size", len, "B");
+}
+
+/**
+ * @brief Send MESSAGES samples through a proxy and report the frame rate
+ *
+ * @param name Benchmark name to report under
+ * @param prio Priority of the proxy's task
+ */
+static void bench_remote_frames(char const *name, uint8_t prio)
+{
+    static actor_proxy_t proxies[2];
+    static uint8_t used = 0;
+
+    actor_proxy_t * const proxy = &proxies[used++];
+    actor_t *actor = NULL;
+
+    actor_proxy_ctor(proxy, NULL, &actor, &l_loopback.super, 0, l_frame, sizeof(l_frame));
+    actor_set_overflow(actor, ACTOR_OVERFLOW_BLOCK, portMAX_DELAY, NULL);
+    actor_start(actor, prio, PROXY_QUEUE, BENCH_STACK_SIZE);
+
+    l_received = 0;
+    uint64_t const start = bench_now_ns();
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        actor_post(actor, &l_sample.super);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    double const seconds = (bench_now_ns() - start) / 1e9;
+
+    bench_report(SUITE, name, MESSAGES, "frames_per_s", proxy->frames / seconds, "frames/s");
+    bench_report(SUITE, name, MESSAGES, "msgs_per_s", proxy->messages / seconds, "msgs/s");
+    bench_report(SUITE, name, MESSAGES, "msgs_per_frame", (double)proxy->messages / proxy->frames, "msgs");
+
+    actor_stop(actor);
+}
+
+// Described in .h
+void bench_remote(void)
+{
+    bench_event_pools();
+    actor_schema_init(l_schemas, MAX_SIGNAL);
+    actor_schema_register(&l_sample_schema);
+
+    bench_remote_codec();
+
+    actor_ctor(NULL, &l_sink, bench_remote_sink);
+    actor_set_overflow(l_sink, ACTOR_OVERFLOW_BLOCK, portMAX_DELAY, NULL);
+    actor_start(l_sink, BENCH_ACTOR_PRIO + 1, SINK_QUEUE, BENCH_STACK_SIZE);
+
+    actor_t * const exports[] = { l_sink };
+    actor_endpoint_ctor(&l_endpoint, exports, 1);
+    actor_loopback_ctor(&l_loopback, &l_endpoint);
+
+    bench_remote_frames("eager", BENCH_ACTOR_PRIO);
+    bench_remote_frames("batched", BENCH_RUNNER_PRIO);
+
+    bench_report(SUITE, "endpoint", MESSAGES, "errors", l_endpoint.errors, "count");
+}
@@ -0,0 +1,217 @@
+/**
+ * @file bench_replay.c
+ * @brief Size of a recording and the rate and timing of its replay
+ *
+ * A sink whose handler spins for a fixed time records the messages posted to
+ * it: one per tick for a while, then a burst that backs up its short queue.
+ * The recording is drained into memory and replayed to the same sink, once
+ * as fast as the sink takes it and once at the recorded pace.  The flat-out
+ * run measures the handler offline; the paced run shows how closely replay
+ * reproduces the original arrival times.
+ *
+ * Needs the host build with -DACTOR_HOST_RECORD=ON; otherwise it reports
+ * nothing.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_record.h"
+#include "actor_remote.h"
+#include "event_pool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "replay"
+
+/** Messages posted one per tick */
+#define PACED 200
+
+/** Messages posted back to back after the paced ones */
+#define BURST 800
+
+/** Messages recorded */
+#define MESSAGES (PACED + BURST)
+
+/** Time the sink's handler spins per message */
+#define WORK_NS 20000
+
+/** Queue length of the sink */
+#define SINK_QUEUE 4
+
+/** Largest signal with a schema, plus one */
+#define MAX_SIGNAL (READING_SIG + 1)
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_replay_signals {
+    READING_SIG = USER_SIG,
+};
+
+/** Reading handled by the sink */
+typedef struct {
+    actor_msg_t super;
+    uint32_t seq;
+    int32_t value;
+    uint16_t channel;
+} bench_replay_reading_t;
+
+#if CONFIG_ACTOR_RECORD
+/** Recording drained into memory; one frame header more than the record buffer */
+typedef struct {
+    uint8_t data[CONFIG_ACTOR_RECORD_BUFFER_SIZE + sizeof(actor_record_frame_t)];
+    size_t len;
+} bench_replay_buffer_t;
+#endif
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_RECORD
+static actor_field_t const l_reading_fields[] = {
+    ACTOR_FIELD(bench_replay_reading_t, seq, ACTOR_FIELD_UINT),
+    ACTOR_FIELD(bench_replay_reading_t, value, ACTOR_FIELD_INT),
+    ACTOR_FIELD(bench_replay_reading_t, channel, ACTOR_FIELD_UINT),
+};
+
+static actor_schema_t const l_reading_schema = ACTOR_SCHEMA(READING_SIG, bench_replay_reading_t, l_reading_fields);
+
+static actor_schema_t const *l_schemas[MAX_SIGNAL];
+
+static bench_replay_buffer_t l_recording;
+
+static actor_t *l_sink = NULL;
+
+/** Messages handled by the sink in the current run */
+static uint32_t l_handled = 0;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler of the sink; notifies the runner after MESSAGES
+ */
+static void bench_replay_sink(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig != READING_SIG)
+    {
+        return;
+    }
+
+    uint64_t const start = bench_now_ns();
+    while (bench_now_ns() - start < WORK_NS)
+    {
+    }
+
+    if (++l_handled == MESSAGES)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Record sink; appends to the in-memory recording
+ */
+static void bench_replay_write(void *ctx, void const *data, size_t len)
+{
+    bench_replay_buffer_t * const buf = ctx;
+
+    if (len <= sizeof(buf->data) - buf->len)
+    {
+        memcpy(&buf->data[buf->len], data, len);
+        buf->len += len;
+    }
+}
+
+/**
+ * @brief Post the paced messages, then the burst, while recording the sink
+ */
+static void bench_replay_record(void)
+{
+    actor_record_enable(l_sink, true);
+
+    l_handled = 0;
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        bench_replay_reading_t * const reading = EVENT_NEW(bench_replay_reading_t, READING_SIG);
+        reading->seq = i;
+        reading->value = (int32_t)(i * 37) - 5000;
+        reading->channel = (uint16_t)(i % 4);
+        actor_post(l_sink, &reading->super);
+        if (i < PACED)
+        {
+            vTaskDelay(1);
+        }
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    actor_record_enable(l_sink, false);
+
+    l_recording.len = 0;
+    uint32_t const records = actor_record_drain(bench_replay_write, &l_recording);
+
+    actor_record_frame_t frame;
+    memcpy(&frame, l_recording.data, sizeof(frame));
+    bench_report(SUITE, "record", MESSAGES, "records", records, "count");
+    bench_report(SUITE, "record", MESSAGES, "lost", frame.lost, "count");
+    bench_report(SUITE, "record", MESSAGES, "bytes_per_record", (double)l_recording.len / records, "B");
+}
+
+/**
+ * @brief Replay the recording to the sink and report the rate and timing
+ *
+ * @param name Benchmark name to report under
+ * @param mode Pace of the replay
+ */
+static void bench_replay_run(char const *name, actor_replay_mode_t mode)
+{
+    l_handled = 0;
+    actor_replay_stats_t stats;
+    uint64_t const start = bench_now_ns();
+    actor_replay(l_recording.data, l_recording.len, NULL, 0, mode, &stats);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    double const seconds = (bench_now_ns() - start) / 1e9;
+
+    bench_report(SUITE, name, MESSAGES, "msgs_per_s", stats.posted / seconds, "msgs/s");
+    bench_report(SUITE, name, MESSAGES, "skipped", stats.skipped + stats.refused + stats.uncaptured, "count");
+    if (mode == ACTOR_REPLAY_RECORDED)
+    {
+        double const span = stats.span_us / 1e6;
+        bench_report(SUITE, name, MESSAGES, "timing_error", 100.0 * (seconds - span) / span, "%");
+    }
+}
+#endif
+
+// Described in .h
+void bench_replay(void)
+{
+#if CONFIG_ACTOR_RECORD
+    bench_event_pools();
+    actor_schema_init(l_schemas, MAX_SIGNAL);
+    actor_schema_register(&l_reading_schema);
+
+    actor_ctor(NULL, &l_sink, bench_replay_sink);
+    actor_set_overflow(l_sink, ACTOR_OVERFLOW_BLOCK, portMAX_DELAY, NULL);
+    actor_start(l_sink, BENCH_ACTOR_PRIO, SINK_QUEUE, BENCH_STACK_SIZE);
+
+    bench_replay_record();
+    bench_replay_run("flat_out", ACTOR_REPLAY_FLAT_OUT);
+    bench_replay_run("recorded", ACTOR_REPLAY_RECORDED);
+
+    actor_stop(l_sink);
+#else
+    fprintf(stderr, "replay needs the host build with -DACTOR_HOST_RECORD=ON\n");
+#endif
+}
@@ -0,0 +1,169 @@
+/**
+ * @file bench_request.c
+ * @brief Request/reply round-trip latency
+ *
+ * A client actor sends requests to a server actor through a pending request
+ * with a timeout armed, and measures from send to matched reply.  The runner
+ * task then calls the same server with actor_call and measures each blocking
+ * call.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_request.h"
+#include "event_pool.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "request"
+
+/** Round trips measured per benchmark */
+#define SAMPLES 10000
+
+/** Round trips run before measuring */
+#define WARMUP 100
+
+/** Timeout armed with every actor request, in ticks; never expires */
+#define TIMEOUT_TICKS 1000
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_request_signals {
+    START_SIG = USER_SIG,
+    QUERY_SIG,
+    ANSWER_SIG,
+    TIMEOUT_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_msg_t const l_start = { .sig = START_SIG };
+
+/** Requests and replies are static; only one is in flight at a time */
+static actor_request_t l_query = { .super = { .sig = QUERY_SIG } };
+
+static actor_reply_t l_answer = { .super = { .sig = ANSWER_SIG } };
+
+static actor_t *l_server = NULL;
+
+static actor_pending_t l_pending;
+
+/** Round trips completed by the client, warm-up included */
+static uint32_t l_count = 0;
+
+static uint64_t l_sent_ns = 0;
+
+static uint64_t l_samples[SAMPLES];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler answering every query
+ */
+static void bench_request_server(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == QUERY_SIG)
+    {
+        actor_reply((actor_request_t const *)msg, &l_answer);
+    }
+}
+
+/**
+ * @brief Send the next query from the client
+ */
+static void bench_request_send(void)
+{
+    l_sent_ns = bench_now_ns();
+    actor_pending_request(&l_pending, l_server, &l_query, TIMEOUT_TICKS);
+}
+
+/**
+ * @brief Dispatch handler of the client, running WARMUP + SAMPLES round trips
+ */
+static void bench_request_client(actor_t * const me, actor_msg_t const * const msg)
+{
+    switch (msg->sig)
+    {
+        case START_SIG:
+            l_count = 0;
+            bench_request_send();
+            break;
+
+        case ANSWER_SIG:
+            if (actor_pending_reply(&l_pending, msg))
+            {
+                uint64_t const now = bench_now_ns();
+                if (l_count >= WARMUP)
+                {
+                    l_samples[l_count - WARMUP] = now - l_sent_ns;
+                }
+                l_count++;
+
+                if (l_count < WARMUP + SAMPLES)
+                {
+                    bench_request_send();
+                }
+                else
+                {
+                    xTaskNotifyGive(bench_runner());
+                }
+            }
+            break;
+
+        case TIMEOUT_SIG:
+            if (actor_pending_timeout(&l_pending, msg))
+            {
+                // Not expected; give up so the runner does not hang
+                xTaskNotifyGive(bench_runner());
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Described in .h
+void bench_request(void)
+{
+    actor_t *client = NULL;
+
+    actor_ctor(NULL, &l_server, bench_request_server);
+    actor_start(l_server, BENCH_ACTOR_PRIO, 4, BENCH_STACK_SIZE);
+    actor_ctor(NULL, &client, bench_request_client);
+    actor_start(client, BENCH_ACTOR_PRIO, 4, BENCH_STACK_SIZE);
+    actor_pending_ctor(&l_pending, TIMEOUT_SIG, client);
+
+    actor_post(client, &l_start);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (l_count == WARMUP + SAMPLES)
+    {
+        bench_report_samples(SUITE, "actor_round_trip", 1, l_samples, SAMPLES);
+    }
+
+    for (uint32_t i = 0; i < WARMUP + SAMPLES; i++)
+    {
+        actor_reply_t const *reply = NULL;
+        uint64_t const start = bench_now_ns();
+        actor_call(l_server, &l_query, &reply, portMAX_DELAY);
+        if (i >= WARMUP)
+        {
+            l_samples[i - WARMUP] = bench_now_ns() - start;
+        }
+        event_gc(&reply->super);
+    }
+
+    bench_report_samples(SUITE, "task_round_trip", 1, l_samples, SAMPLES);
+}
@@ -0,0 +1,242 @@
+/**
+ * @file bench_sizing.c
+ * @brief RAM saved by sizing actors from a profiling run
+ *
+ * Twenty actors start with a queue of 10, as in the blinky example, and the
+ * benchmarks' stack.  Actor 0 stands for the example: it starts with the
+ * example's stack of 2048, which the host counts in words, and formats a
+ * log line per message.  The others touch between 0.5 and 9.5 kB of stack
+ * and receive bursts of 1 to 6 messages.  After the workload
+ * the generated header goes to stderr, the actors are destroyed and rebuilt
+ * with the recommended sizes, and the workload runs again while
+ * actor_sizing_check watches for actors over their profile.
+ *
+ * Needs the host build with -DACTOR_HOST_SIZING=ON; otherwise it reports
+ * nothing.  Stack use on the host includes the C library's needs, so only
+ * the saving relative to the starting sizes carries over to the target.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_port.h"
+#include "actor_priv.h"
+#include "actor_sizing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "sizing"
+
+/** Actors in the workload */
+#define NUM_ACTORS 20
+
+/** Queue length of the blinky example */
+#define EXAMPLE_QUEUE 10
+
+/** Stack size of the blinky example */
+#define EXAMPLE_STACK 2048
+
+/** Bursts posted to every actor per run */
+#define ROUNDS 50
+
+/** Largest burst */
+#define MAX_BURST 6
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_sizing_signals {
+    WORK_SIG = USER_SIG,
+};
+
+/** RAM taken by the actors of a run */
+typedef struct {
+    size_t heap;                ///< Heap used by the actors, tasks and queues
+    size_t example;             ///< Queue and stack of actor 0, the blinky example
+} bench_sizing_ram_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_SIZING
+static actor_msg_t const l_work = { .sig = WORK_SIG };
+
+static actor_t *l_actors[NUM_ACTORS];
+
+/** Sizes recommended by the profiling run, indexed like l_actors */
+static actor_size_t l_sizes[NUM_ACTORS];
+
+/** Messages handled in the current run */
+static uint32_t l_handled = 0;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Burst of messages posted to an actor per round
+ */
+static uint32_t bench_sizing_burst(uint16_t index)
+{
+    return 1 + index % MAX_BURST;
+}
+
+/**
+ * @brief Stack touched by an actor per message in bytes
+ */
+static size_t bench_sizing_depth(uint16_t index)
+{
+    return index * 512;
+}
+
+/**
+ * @brief Dispatch handler; actor 0 formats a line, the others touch stack
+ */
+static void bench_sizing_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig != WORK_SIG)
+    {
+        return;
+    }
+
+    uint16_t index = 0;
+    while (l_actors[index] != me)
+    {
+        index++;
+    }
+
+    if (index == 0)
+    {
+        char line[64];
+        snprintf(line, sizeof(line), "I (%lu) main_app: Calling the blink event...",
+                 (unsigned long)xTaskGetTickCount());
+        __asm__ volatile("" : : "r"(line) : "memory");
+    }
+    else
+    {
+        uint8_t buf[bench_sizing_depth(index)];
+        memset(buf, (int)index, sizeof(buf));
+        __asm__ volatile("" : : "r"(buf) : "memory");
+    }
+
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        total += bench_sizing_burst(i) * ROUNDS;
+    }
+    if (__atomic_add_fetch(&l_handled, 1, __ATOMIC_RELAXED) == total)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Generated header sink; copies it to stderr
+ */
+static void bench_sizing_write(void *ctx, char const *text, size_t len)
+{
+    fwrite(text, 1, len, stderr);
+}
+
+/**
+ * @brief Start the actors, run the workload and measure the RAM it took
+ *
+ * @param ram Filled with the RAM the actors took
+ * @param apply Start the actors with the sizes of the profiling run
+ */
+static void bench_sizing_run(bench_sizing_ram_t * const ram, bool apply)
+{
+    vTaskDelay(10);
+    size_t const free_before = xPortGetFreeHeapSize();
+
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        actor_ctor(NULL, &l_actors[i], bench_sizing_dispatch);
+        actor_set_overflow(l_actors[i], ACTOR_OVERFLOW_BLOCK, portMAX_DELAY, NULL);
+    }
+    if (apply)
+    {
+        // Earlier suites leave free ids behind, so map the profile onto the new ids
+        for (uint16_t i = 0; i < NUM_ACTORS; i++)
+        {
+            l_sizes[i].id = actor_get_id(l_actors[i]);
+        }
+        actor_sizing_apply(l_sizes, NUM_ACTORS);
+    }
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        actor_start(l_actors[i], BENCH_ACTOR_PRIO, EXAMPLE_QUEUE, (i == 0) ? EXAMPLE_STACK : BENCH_STACK_SIZE);
+    }
+    ram->heap = free_before - xPortGetFreeHeapSize();
+    ram->example = l_actors[0]->queue_length * sizeof(actor_envelope_t) +
+                   l_actors[0]->stack_size * ACTOR_PORT_STACK_UNIT;
+
+    l_handled = 0;
+    for (uint32_t round = 0; round < ROUNDS; round++)
+    {
+        for (uint16_t i = 0; i < NUM_ACTORS; i++)
+        {
+            for (uint32_t j = 0; j < bench_sizing_burst(i); j++)
+            {
+                actor_post(l_actors[i], &l_work);
+            }
+        }
+        vTaskDelay(1);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+/**
+ * @brief Stop and destroy the actors of a run
+ */
+static void bench_sizing_teardown(void)
+{
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        actor_stop(l_actors[i]);
+        actor_dtor(l_actors[i]);
+        l_actors[i] = NULL;
+    }
+}
+#endif
+
+// Described in .h
+void bench_sizing(void)
+{
+#if CONFIG_ACTOR_SIZING
+    bench_sizing_ram_t profiled;
+    bench_sizing_run(&profiled, false);
+
+    actor_sizing_emit(bench_sizing_write, NULL);
+    for (uint16_t i = 0; i < NUM_ACTORS; i++)
+    {
+        actor_sizing_measure(l_actors[i], &l_sizes[i]);
+    }
+    bench_sizing_teardown();
+
+    bench_sizing_ram_t applied;
+    bench_sizing_run(&applied, true);
+    uint16_t const alarms = actor_sizing_check(NULL);
+    bench_sizing_teardown();
+    actor_sizing_apply(NULL, 0);
+
+    bench_report(SUITE, "workload", NUM_ACTORS, "profiled_heap", profiled.heap, "B");
+    bench_report(SUITE, "workload", NUM_ACTORS, "applied_heap", applied.heap, "B");
+    bench_report(SUITE, "workload", NUM_ACTORS, "saved", (double)profiled.heap - (double)applied.heap, "B");
+    bench_report(SUITE, "workload", NUM_ACTORS, "alarms", alarms, "count");
+    bench_report(SUITE, "example", 1, "profiled", profiled.example, "B");
+    bench_report(SUITE, "example", 1, "applied", applied.example, "B");
+#else
+    fprintf(stderr, "sizing needs the host build with -DACTOR_HOST_SIZING=ON\n");
+#endif
+}
@@ -0,0 +1,188 @@
+/**
+ * @file bench_throughput.c
+ * @brief Messages per second through one actor and through chains of actors
+ *
+ * A single chain of CHAIN_MAX actors is built once; a chain of N actors is
+ * measured by entering it N actors from the end.  Each actor forwards the
+ * message to the next and the last notifies the runner.  The runner keeps at
+ * most WINDOW messages in flight so that no queue overflows.
+ *
+ * `batch` measures one actor fed in bursts by a higher priority producer,
+ * with batches of 1, 8 and 32 messages (see actor_set_batch).  Each pass of
+ * the message loop is one wakeup of the actor's task, so passes per message
+ * is an upper bound on context switches per message.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "throughput"
+
+/** Longest chain measured */
+#define CHAIN_MAX 16
+
+/** Messages pushed through each chain */
+#define MESSAGES 20000
+
+/** Messages in flight at once */
+#define WINDOW 16
+
+/** Queue length of each chain actor; holds a full window */
+#define QUEUE_LENGTH (2 * WINDOW)
+
+/** Messages posted per burst in the batch benchmark */
+#define BURST 32
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Each chain position has its own signal so the handler knows where it is */
+enum bench_throughput_signals {
+    HOP_SIG = USER_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_t *l_chain[CHAIN_MAX];
+
+static actor_msg_t l_hop[CHAIN_MAX];
+
+static actor_msg_t const l_data = { .sig = HOP_SIG };
+
+/** Messages and message loop passes seen by the batch handler */
+static uint32_t volatile l_batch_msgs;
+static uint32_t volatile l_batch_passes;
+
+/** Batch handler notifies the runner once l_batch_msgs reaches this */
+static uint32_t volatile l_batch_target;
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler forwarding each message down the chain
+ */
+static void bench_throughput_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig < HOP_SIG)
+    {
+        return;
+    }
+
+    uint32_t const pos = msg->sig - HOP_SIG;
+    if (pos + 1u < CHAIN_MAX)
+    {
+        actor_post(l_chain[pos + 1u], &l_hop[pos + 1u]);
+    }
+    else
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Push MESSAGES messages through the last `length` actors of the chain
+ */
+static void bench_throughput_run(uint32_t length)
+{
+    uint32_t const first = CHAIN_MAX - length;
+    uint64_t const start = bench_now_ns();
+
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        if (i >= WINDOW)
+        {
+            ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+        }
+        actor_post(l_chain[first], &l_hop[first]);
+    }
+    for (uint32_t i = 0; i < WINDOW; i++)
+    {
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    }
+
+    double const seconds = (bench_now_ns() - start) / 1e9;
+    bench_report(SUITE, "chain", length, "msgs_per_s", MESSAGES / seconds, "msg/s");
+    bench_report(SUITE, "chain", length, "hops_per_s", (double)MESSAGES * length / seconds, "msg/s");
+}
+
+/**
+ * @brief Batch handler counting messages and passes
+ */
+static void bench_throughput_batch(actor_t * const me, actor_msg_t const * const msgs[], uint16_t count)
+{
+    l_batch_passes++;
+    l_batch_msgs += count;
+    if (l_batch_msgs >= l_batch_target)
+    {
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Feed one actor in bursts with the given batch size
+ */
+static void bench_throughput_batch_run(uint16_t batch)
+{
+    actor_t *me = NULL;
+
+    actor_ctor(NULL, &me, bench_throughput_dispatch);
+    actor_set_batch(me, batch, bench_throughput_batch);
+    actor_start(me, BENCH_ACTOR_PRIO, 2 * BURST, BENCH_STACK_SIZE);
+
+    // Outrank the actor so that each burst is queued before it runs
+    vTaskPrioritySet(NULL, BENCH_ACTOR_PRIO + 1);
+    l_batch_msgs = 0;
+    l_batch_passes = 0;
+
+    uint64_t const start = bench_now_ns();
+    for (uint32_t sent = 0; sent < MESSAGES; sent += BURST)
+    {
+        l_batch_target = sent + BURST;
+        for (uint32_t i = 0; i < BURST; i++)
+        {
+            actor_post(me, &l_data);
+        }
+        while (l_batch_msgs < l_batch_target)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+    double const seconds = (bench_now_ns() - start) / 1e9;
+    vTaskPrioritySet(NULL, BENCH_RUNNER_PRIO);
+
+    bench_report(SUITE, "batch", batch, "msgs_per_s", l_batch_msgs / seconds, "msg/s");
+    bench_report(SUITE, "batch", batch, "passes_per_msg", (double)l_batch_passes / l_batch_msgs, "count");
+}
+
+// Described in .h
+void bench_throughput(void)
+{
+    for (uint32_t i = 0; i < CHAIN_MAX; i++)
+    {
+        l_hop[i].sig = HOP_SIG + i;
+        actor_ctor(NULL, &l_chain[i], bench_throughput_dispatch);
+        actor_start(l_chain[i], BENCH_ACTOR_PRIO, QUEUE_LENGTH, BENCH_STACK_SIZE);
+    }
+
+    for (uint32_t length = 1; length <= CHAIN_MAX; length *= 2)
+    {
+        bench_throughput_run(length);
+    }
+
+    bench_throughput_batch_run(1);
+    bench_throughput_batch_run(8);
+    bench_throughput_batch_run(32);
+}
@@ -0,0 +1,207 @@
+/**
+ * @file bench_tick.c
+ * @brief Time from a tick expiring timers to their dispatch, and ring overflow
+ *
+ * Tick back end only.  The suite detaches time_event_tick() from the tick
+ * hook and drives it from the runner, one tick at a time, after arming 1, 8
+ * or 32 one-shot timers to expire on that tick.  `expiry_to_dispatch` is the
+ * time from the start of the tick to the dispatch of the last of them by the
+ * sink actor.  Without CONFIG_ACTOR_TIME_EVENT_DEFERRED the tick posts them
+ * itself; with it, the tick only fills the ring and the drain task posts, so
+ * run it from builds with -DACTOR_HOST_DEFERRED ON and OFF and compare.
+ *
+ * In deferred builds `ring_overflow` expires more timers on one tick than the
+ * ring holds.  Exactly the ring's worth must be dispatched and the rest
+ * counted by time_event_get_overruns(); anything else is printed and aborts
+ * the run.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "time_event.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <sdkconfig.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "tick"
+
+/** Most timers expiring on one tick when measuring */
+#define MAX_EXPIRIES 32
+
+/** Most ticks driven to get past other timers before a measurement */
+#define QUIET_TICKS 64
+
+/** Ticks measured per number of expiries */
+#define SAMPLES 1000
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+#define BUILD_DEFERRED 1
+
+/** Timers expired on the overflowing tick */
+#define OVERFLOW_TIMERS (CONFIG_ACTOR_TIME_EVENT_RING_SIZE + 8)
+#else
+#define BUILD_DEFERRED 0
+#define OVERFLOW_TIMERS MAX_EXPIRIES
+#endif
+
+/** Queue length of the sink; holds every timer of a tick */
+#define SINK_QUEUE (OVERFLOW_TIMERS + 8)
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_tick_signals {
+    EXPIRY_SIG = USER_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+static actor_t *l_sink = NULL;
+
+static time_event_t l_timers[OVERFLOW_TIMERS];
+
+/** Expiries dispatched by the sink */
+static uint32_t l_dispatched = 0;
+
+/** Expiries the sink notifies the runner after */
+static uint32_t l_expected = 0;
+
+/** Time the expected expiry was dispatched */
+static uint64_t volatile l_done_ns = 0;
+
+static uint64_t l_samples[SAMPLES];
+#endif
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+/**
+ * @brief Dispatch handler of the sink; notifies the runner after the last expiry
+ */
+static void bench_tick_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == EXPIRY_SIG && ++l_dispatched == l_expected)
+    {
+        l_done_ns = bench_now_ns();
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Drive ticks until no other timer expires on the next, for a while at most
+ *
+ * The suite runs before lifecycle, whose supervisor keeps a timer due on
+ * every tick; only the bound keeps a late run from spinning forever.
+ */
+static void bench_tick_quiet(void)
+{
+    for (uint32_t i = 0; i < QUIET_TICKS && time_event_next_expiry_us() == 0; i++)
+    {
+        time_event_tick();
+    }
+}
+
+/**
+ * @brief Expire `count` timers on one tick and wait for the sink to dispatch them
+ *
+ * @param count Timers armed to expire on the tick
+ * @param expected Dispatches to wait for
+ * @return Time from the start of the tick to the last dispatch in nanoseconds
+ */
+static uint64_t bench_tick_once(uint32_t count, uint32_t expected)
+{
+    // The drain task frees a ring slot only after its post returns, which can
+    // be after the dispatch the previous sample waited for
+    vTaskDelay(1);
+    bench_tick_quiet();
+    l_dispatched = 0;
+    l_expected = expected;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        time_event_arm(&l_timers[i], 1, 0);
+    }
+
+    uint64_t const start = bench_now_ns();
+    time_event_tick();
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return l_done_ns - start;
+}
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+/**
+ * @brief Overflow the ring on one tick and check what was delivered and lost
+ */
+static void bench_tick_overflow(void)
+{
+    uint32_t const overruns = time_event_get_overruns();
+
+    bench_tick_once(OVERFLOW_TIMERS, CONFIG_ACTOR_TIME_EVENT_RING_SIZE);
+    // Give a late post the chance to show up
+    vTaskDelay(2);
+
+    uint32_t const lost = time_event_get_overruns() - overruns;
+    if (l_dispatched != CONFIG_ACTOR_TIME_EVENT_RING_SIZE ||
+        l_dispatched + lost != OVERFLOW_TIMERS)
+    {
+        fprintf(stderr, "tick overflow: %u dispatched, %u lost of %u\n", (unsigned)l_dispatched,
+                (unsigned)lost, (unsigned)OVERFLOW_TIMERS);
+        abort();
+    }
+
+    bench_report(SUITE, "ring_overflow", OVERFLOW_TIMERS, "dispatched", l_dispatched, "count");
+    bench_report(SUITE, "ring_overflow", OVERFLOW_TIMERS, "overruns", lost, "count");
+}
+#endif
+#endif
+
+// Described in .h
+void bench_tick(void)
+{
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    static uint32_t const counts[] = { 1, 8, MAX_EXPIRIES };
+
+    bench_report(SUITE, "build", 1, "deferred", BUILD_DEFERRED, "bool");
+
+    actor_ctor(NULL, &l_sink, bench_tick_dispatch);
+    actor_start(l_sink, BENCH_ACTOR_PRIO, SINK_QUEUE, BENCH_STACK_SIZE);
+    for (uint32_t i = 0; i < OVERFLOW_TIMERS; i++)
+    {
+        time_event_ctor(&l_timers[i], EXPIRY_SIG, l_sink);
+    }
+
+    bench_set_tick_handler(NULL);
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        for (uint32_t i = 0; i < SAMPLES; i++)
+        {
+            l_samples[i] = bench_tick_once(counts[c], counts[c]);
+        }
+        bench_report_samples(SUITE, "expiry_to_dispatch", counts[c], l_samples, SAMPLES);
+    }
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+    bench_tick_overflow();
+#endif
+    bench_set_tick_handler(time_event_tick);
+
+    actor_stop(l_sink);
+#else
+    fprintf(stderr, "tick needs the tick time event back end\n");
+#endif
+}
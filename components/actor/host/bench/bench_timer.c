@@ -0,0 +1,325 @@
+/**
+ * @file bench_timer.c
+ * @brief Timer tick cost versus armed timers, and timer accuracy
+ *
+ * `tick_cost` (tick back end only) arms N periodic timers with periods spread
+ * over the measured window, detaches time_event_tick() from the tick hook and
+ * calls it directly, so the figure is the cost per tick in cycles including
+ * wheel cascades and expiries; `expiries_per_tick` shows how many were
+ * dispatched, and deferred builds also report the `overruns` of the ring.  The
+ * expiries go to a sink that coalesces them, so no post is refused.  `accuracy`
+ * measures how far from the requested deadline a one-shot timer is
+ * dispatched, with either back end.  `coalesce` runs 36 sensor polls at 10,
+ * 20 and 50 ms with random phases on 4 actors, without slack and with a
+ * quarter of the period as slack, and counts the wakeups (ticks or one-shot
+ * expirations on which any timer fired) and the batches the actors drained.
+ */
+
+#include "bench.h"
+
+#include "actor.h"
+#include "actor_port.h"
+#include "time_event.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <sdkconfig.h>
+
+#include <stdlib.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SUITE "timer"
+
+/** Largest number of armed timers measured */
+#define TIMERS_MAX 10000
+
+/** Ticks driven per tick cost measurement */
+#define TICKS 10000
+
+/** Armed timers repeat every PERIOD_MIN to PERIOD_MIN + PERIOD_SPREAD ticks */
+#define PERIOD_MIN (TICKS / 10)
+#define PERIOD_SPREAD (TICKS - PERIOD_MIN)
+
+/** One-shot timers measured for accuracy */
+#define SAMPLES 200
+
+/** Timeout of the accuracy timer */
+#define ACCURACY_US 5000u
+
+/** Sensor polls per period in the coalescing run */
+#define POLLS_PER_PERIOD 12
+
+/** Periods of the sensor polls in ticks */
+#define NUM_PERIODS 3
+
+#define NUM_POLLS (POLLS_PER_PERIOD * NUM_PERIODS)
+
+/** Actors sharing the sensor polls */
+#define NUM_POLLERS 4
+
+/** Ticks each coalescing run lasts */
+#define COALESCE_TICKS 1000
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+enum bench_timer_signals {
+    TIMEOUT_SIG = USER_SIG,
+    POLL_SIG,
+    EXPIRY_SIG,
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static actor_t *l_sink = NULL;
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+static time_event_t l_timers[TIMERS_MAX];
+
+/** Receives the expiries of l_timers */
+static actor_t *l_wheel_sink = NULL;
+
+/** Expiries dispatched by l_wheel_sink, merged ones included */
+static uint32_t l_expired = 0;
+#endif
+
+static time_event_t l_accuracy;
+
+/** Time the accuracy timer was dispatched */
+static uint64_t volatile l_fired_ns;
+
+static uint64_t l_samples[SAMPLES];
+
+static uint32_t const l_periods[NUM_PERIODS] = { 10, 20, 50 };
+
+static time_event_t l_polls[NUM_POLLS];
+
+static actor_t *l_pollers[NUM_POLLERS];
+
+/** Batches drained and poll events dispatched by the pollers */
+static uint32_t l_batches = 0;
+static uint32_t l_polled = 0;
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+/** Ticks on which at least one timer fired */
+static uint32_t l_fire_ticks = 0;
+#endif
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Dispatch handler recording when the accuracy timer fires
+ */
+static void bench_timer_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg == &l_accuracy.super)
+    {
+        l_fired_ns = bench_now_ns();
+        xTaskNotifyGive(bench_runner());
+    }
+}
+
+/**
+ * @brief Batch handler of the pollers; counts what each wakeup drained
+ */
+static void bench_timer_poll(actor_t * const me, actor_msg_t const * const msgs[], uint16_t count)
+{
+    __atomic_add_fetch(&l_batches, 1, __ATOMIC_RELAXED);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (msgs[i]->sig == POLL_SIG)
+        {
+            __atomic_add_fetch(&l_polled, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+/**
+ * @brief Dispatch handler of the wheel sink; counts expiries
+ */
+static void bench_timer_expiry(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg->sig == EXPIRY_SIG)
+    {
+        __atomic_add_fetch(&l_expired, 1u + actor_get_coalesced(me), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Tick handler counting the ticks on which a timer fires
+ */
+static void bench_timer_counting_tick(void)
+{
+    if (time_event_next_expiry_us() == 0)
+    {
+        l_fire_ticks++;
+    }
+
+    time_event_tick();
+}
+
+/**
+ * @brief Measure time_event_tick() with `count` armed timers
+ */
+static void bench_timer_tick_cost(uint32_t count)
+{
+    srand(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // Random phases, so the expiries spread over the window
+        uint32_t const period = PERIOD_MIN + (uint32_t)rand() % PERIOD_SPREAD;
+        time_event_arm(&l_timers[i], 1 + (uint32_t)rand() % period, period);
+    }
+
+    bench_set_tick_handler(NULL);
+    __atomic_store_n(&l_expired, 0, __ATOMIC_RELAXED);
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+    uint32_t const overruns = time_event_get_overruns();
+#endif
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < TICKS; i++)
+    {
+        uint32_t const start = ACTOR_PORT_CYCLES();
+        time_event_tick();
+        cycles += ACTOR_PORT_CYCLES() - start;
+    }
+    bench_set_tick_handler(time_event_tick);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        time_event_disarm(&l_timers[i]);
+    }
+    // Let the sink dispatch what is still queued
+    vTaskDelay(2);
+
+    bench_report(SUITE, "tick_cost", count, "per_tick", (double)cycles / TICKS, "cycles");
+    bench_report(SUITE, "tick_cost", count, "expiries_per_tick",
+                 (double)__atomic_load_n(&l_expired, __ATOMIC_RELAXED) / TICKS, "count");
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+    // Expiries lost to a full ring are not dispatched
+    bench_report(SUITE, "tick_cost", count, "overruns", time_event_get_overruns() - overruns, "count");
+#endif
+}
+#endif
+
+/**
+ * @brief Measure the dispatch error of a one-shot timer
+ */
+static void bench_timer_accuracy(void)
+{
+#if CONFIG_ACTOR_TIME_EVENT_TICKLESS
+    uint32_t const wakeups = time_event_get_wakeups();
+#endif
+
+    for (uint32_t i = 0; i < SAMPLES; i++)
+    {
+        uint64_t const deadline = bench_now_ns() + ACCURACY_US * 1000ull;
+        time_event_arm_us(&l_accuracy, ACCURACY_US, 0);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        l_samples[i] = (l_fired_ns > deadline) ? l_fired_ns - deadline : deadline - l_fired_ns;
+    }
+
+    bench_report_samples(SUITE, "accuracy", ACCURACY_US, l_samples, SAMPLES);
+#if CONFIG_ACTOR_TIME_EVENT_TICKLESS
+    bench_report(SUITE, "accuracy", ACCURACY_US, "wakeups_per_timer",
+                 (double)(time_event_get_wakeups() - wakeups) / SAMPLES, "count");
+#endif
+}
+
+/**
+ * @brief Run the sensor polls for COALESCE_TICKS and report wakeups and batches
+ *
+ * @param name Benchmark name to report under
+ * @param slack_div Slack is the period divided by this; 0 for no slack
+ */
+static void bench_timer_coalesce(char const *name, uint32_t slack_div)
+{
+    srand(NUM_POLLS);
+    for (uint32_t i = 0; i < NUM_POLLS; i++)
+    {
+        uint32_t const period = l_periods[i % NUM_PERIODS];
+        time_event_set_slack(&l_polls[i], (slack_div > 0) ? period / slack_div : 0);
+    }
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    l_fire_ticks = 0;
+    bench_set_tick_handler(bench_timer_counting_tick);
+#else
+    uint32_t const wakeups = time_event_get_wakeups();
+#endif
+    l_batches = 0;
+    l_polled = 0;
+
+    for (uint32_t i = 0; i < NUM_POLLS; i++)
+    {
+        uint32_t const period = l_periods[i % NUM_PERIODS];
+        time_event_arm(&l_polls[i], 1 + (uint32_t)rand() % period, period);
+    }
+    vTaskDelay(COALESCE_TICKS);
+    for (uint32_t i = 0; i < NUM_POLLS; i++)
+    {
+        time_event_disarm(&l_polls[i]);
+    }
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    bench_set_tick_handler(time_event_tick);
+    uint32_t const fired = l_fire_ticks;
+#else
+    uint32_t const fired = time_event_get_wakeups() - wakeups;
+#endif
+    double const seconds = (double)COALESCE_TICKS * portTICK_PERIOD_MS / 1000.0;
+
+    bench_report(SUITE, name, NUM_POLLS, "wakeups_per_s", fired / seconds, "wakeups/s");
+    bench_report(SUITE, name, NUM_POLLS, "batches_per_s", l_batches / seconds, "batches/s");
+    bench_report(SUITE, name, NUM_POLLS, "events_per_s", l_polled / seconds, "events/s");
+}
+
+// Described in .h
+void bench_timer(void)
+{
+    actor_ctor(NULL, &l_sink, bench_timer_dispatch);
+    actor_start(l_sink, BENCH_ACTOR_PRIO, 16, BENCH_STACK_SIZE);
+    time_event_ctor(&l_accuracy, TIMEOUT_SIG, l_sink);
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    actor_ctor(NULL, &l_wheel_sink, bench_timer_expiry);
+    actor_coalesce(l_wheel_sink, EXPIRY_SIG);
+    actor_start(l_wheel_sink, BENCH_ACTOR_PRIO, 4, BENCH_STACK_SIZE);
+    for (uint32_t i = 0; i < TIMERS_MAX; i++)
+    {
+        time_event_ctor(&l_timers[i], EXPIRY_SIG, l_wheel_sink);
+    }
+    bench_timer_tick_cost(0);
+    for (uint32_t count = 10; count <= TIMERS_MAX; count *= 10)
+    {
+        bench_timer_tick_cost(count);
+    }
+#endif
+
+    bench_timer_accuracy();
+
+    for (uint32_t i = 0; i < NUM_POLLERS; i++)
+    {
+        actor_ctor(NULL, &l_pollers[i], bench_timer_dispatch);
+        actor_set_batch(l_pollers[i], NUM_POLLS / NUM_POLLERS, bench_timer_poll);
+        actor_start(l_pollers[i], BENCH_ACTOR_PRIO, NUM_POLLS / NUM_POLLERS, BENCH_STACK_SIZE);
+    }
+    for (uint32_t i = 0; i < NUM_POLLS; i++)
+    {
+        time_event_ctor(&l_polls[i], POLL_SIG, l_pollers[i % NUM_POLLERS]);
+    }
+
+    bench_timer_coalesce("coalesce_no_slack", 0);
+    bench_timer_coalesce("coalesce_slack", 4);
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2024 MSR Consulting, LLC
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+"""Compare two benchmark result files written by actor_bench.
+
+Results are matched on (suite, name, param, metric).  A result regresses when
+it moves in the wrong direction by more than the threshold: throughput
+(msg/s) should not fall, everything else (time, bytes, counts) should not
+rise.  Exits with status 1 if any result regressed.
+
+    compare.py baseline.jsonl current.jsonl [--threshold 10]
+"""
+
+import argparse
+import json
+import sys
+
+HIGHER_IS_BETTER = {'msg/s'}
+
+
+def load(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith('{'):
+                continue
+            r = json.loads(line)
+            results[(r['suite'], r['name'], r['param'], r['metric'])] = r
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('baseline', help='results of the reference run')
+    parser.add_argument('current', help='results of the run under test')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='allowed change in percent (default 10)')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    regressions = 0
+
+    for key in sorted(baseline.keys() & current.keys(), key=str):
+        old = baseline[key]['value']
+        new = current[key]['value']
+        unit = current[key]['unit']
+        if old == 0:
+            continue
+        change = (new - old) / old * 100.0
+        worse = -change if unit in HIGHER_IS_BETTER else change
+        flag = ''
+        if worse > args.threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        suite, name, param, metric = key
+        print(f'{suite}/{name}[{param}] {metric}: {old:.3f} -> {new:.3f} {unit} ({change:+.1f}%){flag}')
+
+    for key in sorted(baseline.keys() - current.keys(), key=str):
+        print(f'{"/".join(map(str, key))}: missing from {args.current}')
+
+    print(f'{regressions} regression(s) above {args.threshold:.0f}%')
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,48 @@
+/**
+ * @file FreeRTOSConfig.h
+ * @brief FreeRTOS configuration for the host build (POSIX port)
+ */
+
+#pragma once
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     1
+#define configTICK_RATE_HZ                      1000
+#define configMAX_PRIORITIES                    16
+#define configMINIMAL_STACK_SIZE                ((unsigned short)4096)
+#define configTOTAL_HEAP_SIZE                   ((size_t)(16 * 1024 * 1024))
+#define configMAX_TASK_NAME_LEN                 16
+#define configTICK_TYPE_WIDTH_IN_BITS           TICK_TYPE_WIDTH_32_BITS
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             1
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configQUEUE_REGISTRY_SIZE               0
+#define configUSE_TRACE_FACILITY                0
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configKERNEL_PROVIDED_STATIC_MEMORY     1
+#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 2
+
+/* Software timers back the host esp_timer stand-in */
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               (configMAX_PRIORITIES - 1)
+#define configTIMER_QUEUE_LENGTH                32
+#define configTIMER_TASK_STACK_DEPTH            configMINIMAL_STACK_SIZE
+
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetSchedulerState          1
+
+#define configASSERT(x) do { if (!(x)) { vAssertCalled(__FILE__, __LINE__); } } while (0)
+
+void vAssertCalled(const char * const file, unsigned long line);
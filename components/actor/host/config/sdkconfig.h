@@ -0,0 +1,51 @@
+/**
+ * @file sdkconfig.h
+ * @brief Configuration of the actor component for the host build
+ *
+ * Stands in for the header ESP-IDF generates from Kconfig.  Options selected
+ * through the host CMake options are passed on the command line.
+ */
+
+#pragma once
+
+/** Use the FreeRTOS POSIX port definitions in actor_port.h */
+#define CONFIG_ACTOR_PORT_POSIX 1
+
+#define CONFIG_ACTOR_MAX_EVENT_POOLS 3
+#define CONFIG_ACTOR_MAX_ACTORS 255
+#define CONFIG_ACTOR_HSM_MAX_DEPTH 8
+#define CONFIG_ACTOR_BATCH_MAX 32
+#define CONFIG_ACTOR_COALESCE_MAX 4
+#define CONFIG_ACTOR_REMOTE_MAX_PROXIES 8
+
+/* The POSIX port simulates a single core */
+#define CONFIG_ACTOR_SCHED_WORKERS 1
+#define CONFIG_ACTOR_SCHED_PRIO_LEVELS 32
+
+#if !CONFIG_ACTOR_TIME_EVENT_TICKLESS
+#define CONFIG_ACTOR_TIME_EVENT_TICK 1
+#define CONFIG_ACTOR_TIME_WHEEL_BITS 6
+#define CONFIG_ACTOR_TIME_WHEEL_LEVELS 4
+#endif
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+#define CONFIG_ACTOR_TIME_EVENT_RING_SIZE 32
+#endif
+
+#if CONFIG_ACTOR_STATS
+#define CONFIG_ACTOR_STATS_MAX_SIGNALS 32
+#define CONFIG_ACTOR_STATS_TLS_INDEX 1
+#endif
+
+#if CONFIG_ACTOR_TRACE
+#define CONFIG_ACTOR_TRACE_BUFFER_RECORDS 1024
+#endif
+
+#if CONFIG_ACTOR_RECORD
+#define CONFIG_ACTOR_RECORD_BUFFER_SIZE 65536
+#define CONFIG_ACTOR_RECORD_MAX_MESSAGE 64
+#endif
+
+#if CONFIG_ACTOR_SIZING
+#define CONFIG_ACTOR_SIZING_MARGIN 25
+#endif
@@ -0,0 +1,21 @@
+/**
+ * @file esp_cpu.h
+ * @brief Cycle counter for the host build
+ *
+ * The host has no portable cycle counter, so "cycles" are nanoseconds of the
+ * monotonic clock; esp_rom_get_cpu_ticks_per_us() reports 1000 to match.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
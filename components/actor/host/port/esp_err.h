@@ -0,0 +1,23 @@
+/**
+ * @file esp_err.h
+ * @brief Subset of the ESP-IDF error codes used by the actor component
+ */
+
+#pragma once
+
+#include <assert.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                0
+#define ESP_FAIL              -1
+#define ESP_ERR_NO_MEM        0x101
+#define ESP_ERR_INVALID_ARG   0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE  0x104
+#define ESP_ERR_NOT_FOUND     0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT       0x107
+#define ESP_ERR_INVALID_VERSION 0x10A
+
+#define ESP_ERROR_CHECK(x_) do { esp_err_t const err_ = (x_); assert(err_ == ESP_OK); (void)err_; } while (0)
@@ -0,0 +1,17 @@
+/**
+ * @file esp_log.h
+ * @brief ESP-IDF logging macros printing to stderr
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOG_HOST(level_, tag_, fmt_, ...) \
+    fprintf(stderr, level_ " (%s) " fmt_ "\n", tag_, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag_, fmt_, ...) ESP_LOG_HOST("E", tag_, fmt_, ##__VA_ARGS__)
+#define ESP_LOGW(tag_, fmt_, ...) ESP_LOG_HOST("W", tag_, fmt_, ##__VA_ARGS__)
+#define ESP_LOGI(tag_, fmt_, ...) ESP_LOG_HOST("I", tag_, fmt_, ##__VA_ARGS__)
+#define ESP_LOGD(tag_, fmt_, ...) do { } while (0)
+#define ESP_LOGV(tag_, fmt_, ...) do { } while (0)
@@ -0,0 +1,14 @@
+/**
+ * @file esp_rom_sys.h
+ * @brief Clock rate matching the host esp_cpu_get_cycle_count()
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** esp_cpu_get_cycle_count() counts nanoseconds on the host */
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return 1000u;
+}
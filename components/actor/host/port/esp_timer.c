@@ -0,0 +1,73 @@
+/**
+ * @file esp_timer.c
+ * @brief Host implementation of the esp_timer subset, see esp_timer.h
+ */
+
+#include "esp_timer.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+
+#include <stdlib.h>
+#include <time.h>
+
+struct esp_timer {
+    TimerHandle_t timer;
+    esp_timer_cb_t callback;
+    void * arg;
+};
+
+static void esp_timer_trampoline(TimerHandle_t timer)
+{
+    struct esp_timer * const me = pvTimerGetTimerID(timer);
+    me->callback(me->arg);
+}
+
+esp_err_t esp_timer_create(esp_timer_create_args_t const * args, esp_timer_handle_t * out_handle)
+{
+    struct esp_timer * const me = malloc(sizeof(*me));
+
+    if (me == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    me->callback = args->callback;
+    me->arg = args->arg;
+    me->timer = xTimerCreate(args->name ? args->name : "esp_timer", 1, pdFALSE, me,
+                             esp_timer_trampoline);
+
+    if (me->timer == NULL)
+    {
+        free(me);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *out_handle = me;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    uint64_t const us_per_tick = 1000000u / configTICK_RATE_HZ;
+    TickType_t ticks = (TickType_t)((timeout_us + us_per_tick - 1u) / us_per_tick);
+
+    if (ticks == 0)
+    {
+        ticks = 1;
+    }
+
+    return (xTimerChangePeriod(timer->timer, ticks, portMAX_DELAY) == pdPASS) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    return (xTimerStop(timer->timer, portMAX_DELAY) == pdPASS) ? ESP_OK : ESP_FAIL;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file esp_timer.h
+ * @brief Subset of the ESP-IDF high resolution timer API for the host build
+ *
+ * esp_timer_get_time() reads the monotonic clock.  One-shot timers are
+ * FreeRTOS software timers, so callbacks run in the timer service task (as
+ * with ESP_TIMER_TASK) but only with tick resolution.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct esp_timer * esp_timer_handle_t;
+
+typedef void (*esp_timer_cb_t)(void * arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void * arg;
+    esp_timer_dispatch_t dispatch_method;
+    char const * name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(esp_timer_create_args_t const * args, esp_timer_handle_t * out_handle);
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,21 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Maps the ESP-IDF `freertos/` include layout onto the upstream kernel
+ */
+
+#pragma once
+
+#include <FreeRTOS.h>
+
+/**
+ * The POSIX port runs every task on one simulated CPU.  Tasks are given a
+ * logical core instead - the core they were pinned to, see freertos/task.h -
+ * so that affinity and per-core bookkeeping can be exercised on the host.
+ */
+#ifndef portNUM_PROCESSORS
+#define portNUM_PROCESSORS ACTOR_HOST_CORES
+#endif
+
+#ifndef tskNO_AFFINITY
+#define tskNO_AFFINITY 0x7FFFFFFF
+#endif
@@ -0,0 +1,10 @@
+/**
+ * @file queue.h
+ * @brief Maps the ESP-IDF `freertos/` include layout onto the upstream kernel
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include <queue.h>
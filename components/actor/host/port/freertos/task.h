@@ -0,0 +1,77 @@
+/**
+ * @file task.h
+ * @brief Maps the ESP-IDF `freertos/` include layout onto the upstream kernel
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include <stdint.h>
+
+#include <task.h>
+
+/** Thread local storage slot holding the logical core of a task */
+#define HOST_CORE_TLS_INDEX 0
+
+/**
+ * @brief Record the logical core of a new task
+ *
+ * Unpinned tasks run on logical core 0.
+ */
+static inline void host_set_core(TaskHandle_t task, BaseType_t core)
+{
+    BaseType_t const logical = (core == tskNO_AFFINITY) ? 0 : core;
+    vTaskSetThreadLocalStoragePointer(task, HOST_CORE_TLS_INDEX, (void *)(uintptr_t)logical);
+}
+
+/** Logical core of the running task; 0 before the scheduler starts */
+static inline BaseType_t xPortGetCoreID(void)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+    {
+        return 0;
+    }
+
+    return (BaseType_t)(uintptr_t)pvTaskGetThreadLocalStoragePointer(NULL, HOST_CORE_TLS_INDEX);
+}
+
+/** xTaskCreate, with the task placed on logical core `core` */
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, char const * const name,
+                                                 uint32_t stack, void * const arg, UBaseType_t prio,
+                                                 TaskHandle_t * const handle, BaseType_t core)
+{
+    TaskHandle_t task = NULL;
+
+    // Keep the new task from running before its core is recorded
+    vTaskSuspendAll();
+    BaseType_t const ret = xTaskCreate(fn, name, stack, arg, prio, &task);
+    if (ret == pdPASS)
+    {
+        host_set_core(task, core);
+    }
+    (void)xTaskResumeAll();
+
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+    return ret;
+}
+
+/** xTaskCreateStatic, with the task placed on logical core `core` */
+static inline TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, char const * const name,
+                                                         uint32_t stack, void * const arg,
+                                                         UBaseType_t prio, StackType_t * const stack_buffer,
+                                                         StaticTask_t * const tcb, BaseType_t core)
+{
+    vTaskSuspendAll();
+    TaskHandle_t const task = xTaskCreateStatic(fn, name, stack, arg, prio, stack_buffer, tcb);
+    if (task != NULL)
+    {
+        host_set_core(task, core);
+    }
+    (void)xTaskResumeAll();
+
+    return task;
+}
@@ -0,0 +1,10 @@
+/**
+ * @file timers.h
+ * @brief Maps the ESP-IDF `freertos/` include layout onto the upstream kernel
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include <timers.h>
@@ -31,17 +31,125 @@
  * SOFTWARE.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <freertos/task.h>
 
+#include <esp_err.h>
+#include <sdkconfig.h>
+
 #pragma once
 
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
+
+/** Core value of an actor that may run on any core */
+#define ACTOR_NO_AFFINITY tskNO_AFFINITY
+
+/** Size of one item of an actor's message queue */
+#if CONFIG_ACTOR_STATS
+#define ACTOR_QUEUE_ITEM_SIZE sizeof(struct { void const *msg; uint32_t stamp; })
+#else
+#define ACTOR_QUEUE_ITEM_SIZE sizeof(void const *)
+#endif
+
+/** Size of an actor's statistics, see actor_stats_t */
+#if CONFIG_ACTOR_STATS
+#define ACTOR_OBJECT_STATS_SIZE (160 + 4 * (CONFIG_ACTOR_STATS_MAX_SIGNALS + portNUM_PROCESSORS))
+#else
+#define ACTOR_OBJECT_STATS_SIZE 0
+#endif
+
+/** Size of the recording and sizing state of an actor */
+#if CONFIG_ACTOR_RECORD || CONFIG_ACTOR_SIZING
+#define ACTOR_OBJECT_DIAG_SIZE 4
+#else
+#define ACTOR_OBJECT_DIAG_SIZE 0
+#endif
+
+/**
+ * Size of an actor object, see actor_object_t.
+ *
+ * Counts the pointer-sized members of struct actor_s (handles, pointers,
+ * BaseType_t) as sizeof(void *) each, one actor_coalesce_t per coalesced
+ * signal as 6 bytes, and every other fixed-size member plus padding in the
+ * constant.  A field added to struct actor_s goes in the matching term.  The
+ * build checks the result against the real object: it fails if the object
+ * does not fit, or if more than two pointers are reserved for nothing.
+ */
+#define ACTOR_OBJECT_SIZE \
+    (19 * sizeof(void *) + 6 * CONFIG_ACTOR_COALESCE_MAX + 52 + ACTOR_OBJECT_DIAG_SIZE + ACTOR_OBJECT_STATS_SIZE)
+
+/**
+ * @brief Declare static storage for an actor with its own task
+ *
+ * @param name_ Name of the resulting actor_storage_t
+ * @param queue_length_ Number of messages that can be queued for the actor
+ * @param stack_size_ Stack size of the actor's task, as for xTaskCreateStatic
+ */
+#define ACTOR_STORAGE(name_, queue_length_, stack_size_)                                    \
+    static uint8_t name_##_queue_buffer[(queue_length_) * ACTOR_QUEUE_ITEM_SIZE];          \
+    static StaticQueue_t name_##_queue;                                                    \
+    static StackType_t name_##_stack[(stack_size_)];                                       \
+    static StaticTask_t name_##_tcb;                                                       \
+    static actor_storage_t const name_ = {                                                 \
+        (queue_length_), name_##_queue_buffer, &name_##_queue,                             \
+        (stack_size_), name_##_stack, &name_##_tcb                                         \
+    }
+
+/**
+ * @brief Declare static storage for an actor run by the shared worker pool
+ *
+ * @param name_ Name of the resulting actor_storage_t
+ * @param queue_length_ Number of messages that can be queued for the actor
+ */
+#define ACTOR_POOLED_STORAGE(name_, queue_length_)                                          \
+    static uint8_t name_##_queue_buffer[(queue_length_) * ACTOR_QUEUE_ITEM_SIZE];          \
+    static StaticQueue_t name_##_queue;                                                    \
+    static actor_storage_t const name_ = {                                                 \
+        (queue_length_), name_##_queue_buffer, &name_##_queue, 0, NULL, NULL               \
+    }
+
+/**
+ * @brief Entry of an actor topology table
+ *
+ * @param me_ Address of the actor handle (`actor_t *`) to construct
+ * @param parent_ Address of the parent's handle; NULL for a root actor
+ * @param dispatch_ Dispatch handler of the actor
+ * @param prio_ Task priority, or worker pool level for pooled storage
+ * @param storage_ Address of storage from ACTOR_STORAGE or ACTOR_POOLED_STORAGE
+ */
+#define ACTOR_NODE(me_, parent_, dispatch_, prio_, storage_) \
+    { (me_), (parent_), (dispatch_), (prio_), (storage_), ACTOR_NO_AFFINITY }
+
+/**
+ * @brief Entry of an actor topology table for an actor pinned to a core
+ *
+ * As ACTOR_NODE, with the actor's task pinned to `core_`, see
+ * actor_set_affinity.  Pooled actors run on the core of their home worker.
+ */
+#define ACTOR_NODE_PINNED(me_, parent_, dispatch_, prio_, storage_, core_) \
+    { (me_), (parent_), (dispatch_), (prio_), (storage_), (core_) }
+
+/**
+ * @brief Declare the actor topology of an application
+ *
+ * Parents must be listed before their children.  Start the whole table with
+ * ACTOR_TOPOLOGY_START.
+ *
+ * @param name_ Name of the table
+ * @param ... ACTOR_NODE entries
+ */
+#define ACTOR_TOPOLOGY(name_, ...) static actor_node_t const name_[] = { __VA_ARGS__ }
+
+/**
+ * @brief Construct and start every actor of a table declared with ACTOR_TOPOLOGY
+ */
+#define ACTOR_TOPOLOGY_START(name_) actor_topology_start((name_), sizeof(name_) / sizeof((name_)[0]))
 /*******************************************************************************
  * Type Definitions
  ******************************************************************************/
@@ -50,22 +158,99 @@ typedef uint16_t signal_t;
 
 /** Define reserved signals for use by the framework */
 enum ReservedSignals {
-    INIT_SIG,   ///< Initialization signal to be used by all actors
-    QUIT_SIG,
-    USER_SIG,   ///< User signals begin here
+    INIT_SIG,       ///< Initialization signal to be used by all actors
+    QUIT_SIG,       ///< Last message handled by an actor stopped with actor_stop
+    CHILD_EXIT_SIG, ///< A child terminated; the message is an actor_exit_t
+    WATCHDOG_SIG,   ///< Periodic check of a supervisor; consumed by the framework
+    USER_SIG,       ///< User signals begin here
 };
 
 /** Definition of the base message class */
 typedef struct actor_msg_s {
-    signal_t sig;
+    signal_t sig;                   ///< Signal identifying the message
+    uint8_t pool_id;                ///< Owning event pool (1-based); 0 for static messages
+    uint16_t volatile ref_count;    ///< Outstanding references to a pooled message
 } actor_msg_t;
 
 /** Forward declaration of the actor class */
 typedef struct actor_s actor_t;
 
+/**
+ * Storage for an actor object embedded by value.  Put it first in the
+ * struct of an actor, point the handle passed to actor_ctor at it and the
+ * actor is constructed in place: the dispatch handler gets the struct back
+ * by casting `me`, without a separate allocation or a pointer to follow.
+ * Align the enclosing storage to 64 bytes to keep the fields read by every
+ * post and dispatch in one cache line.
+ */
+typedef union actor_object_u {
+    uint8_t bytes[ACTOR_OBJECT_SIZE];   ///< Contents are hidden
+    uint64_t align;                     ///< Alignment of the object
+    void *align_ptr;                    ///< Alignment of the object
+} actor_object_t;
+
 /** Definition of the dispatch handler for each class */
 typedef void (*DispatchHandler)(actor_t * const me, actor_msg_t const * const msg);
 
+/**
+ * Batch dispatch handler, see actor_set_batch.  `msgs` holds `count` messages
+ * in the order they were queued; they are released when the handler returns.
+ */
+typedef void (*BatchHandler)(actor_t * const me, actor_msg_t const * const msgs[], uint16_t count);
+
+/**
+ * Called when a message is refused or discarded because the receiving actor
+ * is overloaded, see actor_set_overflow.  Runs in the context of the post
+ * (possibly an ISR); the message is released when the handler returns.
+ */
+typedef void (*OverflowHandler)(actor_t * const me, actor_msg_t const * const msg);
+
+/** What actor_post does when the receiving actor cannot take the message */
+typedef enum {
+    ACTOR_OVERFLOW_DROP_NEWEST,     ///< Refuse the new message (default)
+    ACTOR_OVERFLOW_DROP_OLDEST,     ///< Discard the oldest normal message to make room
+    ACTOR_OVERFLOW_BLOCK,           ///< Wait for room, up to a timeout; ISR posts drop the newest
+    ACTOR_OVERFLOW_CREDITS,         ///< Accept normal posts only against credits granted by the actor
+} actor_overflow_t;
+
+/** Why an actor terminated, see actor_exit_t */
+typedef enum {
+    ACTOR_EXIT_NORMAL,      ///< Stopped with actor_stop
+    ACTOR_EXIT_FAILED,      ///< Reported with actor_fail or actor_fail_from_isr
+    ACTOR_EXIT_HUNG,        ///< A dispatch ran longer than the actor's watchdog timeout
+} actor_exit_reason_t;
+
+/**
+ * CHILD_EXIT_SIG message, posted to the parent when a child terminates or
+ * fails.  It is part of the child, so it stays valid until the child is
+ * destroyed with actor_dtor.
+ */
+typedef struct actor_exit_s {
+    actor_msg_t super;          ///< Message with CHILD_EXIT_SIG
+    actor_t *child;             ///< Child concerned
+    uint8_t reason;             ///< One of actor_exit_reason_t
+} actor_exit_t;
+
+/** Caller-provided storage for an actor's queue and task, see ACTOR_STORAGE */
+typedef struct actor_storage_s {
+    uint32_t queue_length;      ///< Number of messages the queue holds
+    uint8_t *queue_buffer;      ///< queue_length * ACTOR_QUEUE_ITEM_SIZE bytes
+    StaticQueue_t *queue;       ///< Queue control block
+    uint32_t stack_size;        ///< Stack size of the task; 0 for pooled actors
+    StackType_t *stack;         ///< Task stack; NULL for pooled actors
+    StaticTask_t *tcb;          ///< Task control block; NULL for pooled actors
+} actor_storage_t;
+
+/** Entry of an actor topology table, see ACTOR_NODE */
+typedef struct actor_node_s {
+    actor_t **me;                       ///< Handle of the actor
+    actor_t **parent;                   ///< Handle of the parent; NULL for a root actor
+    DispatchHandler dispatch;           ///< Dispatch handler
+    uint8_t prio;                       ///< Task priority or worker pool level
+    actor_storage_t const *storage;     ///< Queue and task storage
+    BaseType_t core;                    ///< Core of the task or ACTOR_NO_AFFINITY
+} actor_node_t;
+
 /*******************************************************************************
  * Function Prototypes
  ******************************************************************************/
@@ -73,14 +258,26 @@ typedef void (*DispatchHandler)(actor_t * const me, actor_msg_t const * const ms
 /**
  * @brief Constructor for the actor object
  *
- * @param me
- * @param dispatch
+ * If `*me` is NULL the actor object is allocated: from a static array of
+ * CONFIG_ACTOR_MAX_ACTORS objects when CONFIG_ACTOR_STATIC_ALLOCATION is set,
+ * from the heap otherwise.  Otherwise `*me` points to an actor_object_t
+ * embedded in the caller's object, which is constructed in place and stays
+ * the caller's memory.  The actor is appended to the parent's children.
+ *
+ * When no object or no actor id is left, an error is logged and an allocated
+ * `*me` is set back to NULL; an embedded object is left unregistered and must
+ * not be used.
+ *
+ * @param parent Parent actor; NULL for a root actor
+ * @param me Handle of the actor
+ * @param dispatch Dispatch handler of the actor
  */
-void actor_ctor(actor_t const * parent, actor_t **me, DispatchHandler dispatch);
+void actor_ctor(actor_t * parent, actor_t **me, DispatchHandler dispatch);
 
 /**
  * @brief Start the actor processes
  *
+ * Sizes applied with actor_sizing_apply replace queue_length and stack_size.
  *
  * @param me
  * @param prio
@@ -90,11 +287,385 @@ void actor_ctor(actor_t const * parent, actor_t **me, DispatchHandler dispatch);
 void actor_start(actor_t *const me, uint8_t prio, uint32_t queue_length, uint32_t stack_size);
 
 /**
- * @brief
+ * @brief Let the actor drain several queued messages per wakeup
  *
- * @param me
- * @param msg
+ * After blocking for a message, the actor's task takes up to `max_batch - 1`
+ * further messages that are already queued without blocking again, which
+ * saves a wakeup per message when producers are bursty.  If `batch` is set
+ * the whole burst is handed to it in one call; otherwise each message goes to
+ * the dispatch handler as usual.  Bursts holding a reserved signal, such as
+ * QUIT_SIG, always go to the dispatch handler.
+ *
+ * Applies to task-per-actor actors; the worker pool dispatches pooled actors
+ * one message at a time.  Call before the actor is started.
+ *
+ * @param me Actor to configure
+ * @param max_batch Largest burst, 1 to CONFIG_ACTOR_BATCH_MAX; 1 disables batching
+ * @param batch Optional handler for a whole burst; NULL to dispatch one by one
+ */
+void actor_set_batch(actor_t * const me, uint16_t max_batch, BatchHandler batch);
+
+/**
+ * @brief Pin the actor's task to a core
+ *
+ * Actors that exchange many messages are cheapest on the same core: a post
+ * then wakes the receiver with a local context switch instead of an
+ * interrupt to the other core.  See actor_stats_suggest_placement for a
+ * placement based on the observed traffic.  Applies to task-per-actor
+ * actors; call after actor_ctor and before the actor is started.
+ *
+ * @param me Actor to configure
+ * @param core Core to run on, or ACTOR_NO_AFFINITY (default) for any core
+ */
+void actor_set_affinity(actor_t * const me, BaseType_t core);
+
+/**
+ * @brief Get the core an actor's messages are dispatched on
+ *
+ * @param me Started actor
+ * @return Pinned core of a task-per-actor actor, core of the home worker of
+ *         a pooled actor, or ACTOR_NO_AFFINITY
+ */
+BaseType_t actor_get_core(actor_t const * const me);
+
+/**
+ * @brief Start the actor process in caller-provided storage
+ *
+ * Same as `actor_start`, but the queue and the task come from `storage`
+ * (see ACTOR_STORAGE) instead of the heap.
+ *
+ * @param me Actor to start
+ * @param prio Priority of the actor's task
+ * @param storage Queue and task storage; must remain valid for the lifetime of the actor
+ */
+void actor_start_static(actor_t *const me, uint8_t prio, actor_storage_t const * const storage);
+
+/**
+ * @brief Construct and start the actors of a topology table
+ *
+ * All actors are constructed in table order before any is started, so every
+ * handle in the table is valid by the time an actor handles INIT_SIG.  Actors
+ * with pooled storage are started on the worker pool with `prio` as their
+ * level and worker 0 as their home.
+ *
+ * @param nodes Table declared with ACTOR_TOPOLOGY
+ * @param count Number of entries in the table
+ */
+void actor_topology_start(actor_node_t const * const nodes, uint16_t count);
+
+/**
+ * @brief Stop an actor
+ *
+ * Posts QUIT_SIG to the urgent lane and refuses every later post.  After the
+ * dispatch handler has handled QUIT_SIG the actor releases whatever is still
+ * queued, drops its subscriptions, deletes its task and queue and posts
+ * CHILD_EXIT_SIG to its parent.  Stopping is asynchronous; see
+ * actor_is_stopped.  A stopped actor can be started again or destroyed with
+ * actor_dtor.  Storage from ACTOR_STORAGE can be started again once the idle
+ * task has cleaned up the deleted task.
+ *
+ * @param me Running actor
+ * @return ESP_OK if QUIT_SIG was queued,
+ *         ESP_ERR_INVALID_STATE if the actor is not running,
+ *         ESP_ERR_NO_MEM if its queue is full of urgent messages
+ */
+esp_err_t actor_stop(actor_t * const me);
+
+/**
+ * @brief Restart an actor in place
+ *
+ * Like actor_stop, but instead of terminating the actor releases its queued
+ * messages, clears its deferred and coalesced messages and handles INIT_SIG
+ * again, reusing its task and queue.  The parent is not notified.  Armed
+ * time events and subscriptions are kept.
+ *
+ * @param me Running actor
+ * @return As actor_stop
+ */
+esp_err_t actor_restart(actor_t * const me);
+
+/**
+ * @brief Check whether an actor accepts messages
+ *
+ * @param me Actor
+ * @return true from start until actor_stop is called; false while a restart
+ *         or a supervisor's respawn is in progress
+ */
+bool actor_is_running(actor_t const * const me);
+
+/**
+ * @brief Check whether an actor's task and queue are gone
+ *
+ * @param me Actor
+ * @return true if the actor was never started or has finished stopping
+ */
+bool actor_is_stopped(actor_t const * const me);
+
+/**
+ * @brief Destroy a stopped actor
+ *
+ * Unlinks the actor from its parent and releases its id for reuse.  Its
+ * children become root actors.  The actor object is returned to the heap or
+ * the static pool if actor_ctor allocated it.  A parent may destroy a child
+ * when it handles the child's CHILD_EXIT_SIG; if the child has not finished
+ * stopping yet this waits for it.  Time events aimed at the actor must be
+ * disarmed first.
+ *
+ * @param me Actor that was never started or has stopped
+ */
+void actor_dtor(actor_t * const me);
+
+/**
+ * @brief Post a message to the actor's queue
+ *
+ * Only a reference to the message is queued, so the message must remain valid
+ * until it is dispatched.  Pooled messages (see event_pool.h) are reference
+ * counted and released after the actor's dispatch handler returns.
+ *
+ * What happens when the actor cannot take the message depends on its
+ * overflow policy, see actor_set_overflow.
+ *
+ * @param me Actor to receive the message
+ * @param msg Message to post
+ * @return ESP_OK if the message was queued or coalesced,
+ *         ESP_ERR_NO_MEM if the queue was full,
+ *         ESP_ERR_TIMEOUT if a blocking post timed out,
+ *         ESP_ERR_INVALID_STATE if the actor granted no credits or is not running
+ */
+esp_err_t actor_post(actor_t *const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Post a message to the actor's queue from interrupt context
+ *
+ * The caller is responsible for requesting a context switch at the end of the
+ * ISR (`portYIELD_FROM_ISR(*woken)`), which lets several posts made in the
+ * same interrupt share a single yield.
+ *
+ * @param me Actor to receive the message
+ * @param msg Message to post
+ * @param woken Set to pdTRUE if the post unblocked a higher priority task;
+ *              left untouched otherwise
+ * @return As actor_post; never blocks
+ */
+esp_err_t actor_post_from_isr(actor_t *const me, actor_msg_t const * const msg, BaseType_t * const woken);
+
+/**
+ * @brief Post a message to the urgent lane of the actor's mailbox
+ *
+ * The message is queued in front of every normal message, so it waits at
+ * most for the dispatch in progress and for other urgent messages.  Urgent
+ * messages among themselves are served newest first.  See
+ * actor_set_urgent_reserve for keeping room for them in a full queue.
+ * Urgent posts do not need credits.
+ *
+ * @param me Actor to receive the message
+ * @param msg Message to post
+ * @return As actor_post
+ */
+esp_err_t actor_post_urgent(actor_t *const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Post a message to the urgent lane from interrupt context
+ *
+ * @param me Actor to receive the message
+ * @param msg Message to post
+ * @param woken Set to pdTRUE if the post unblocked a higher priority task;
+ *              left untouched otherwise
+ * @return As actor_post; never blocks
+ */
+esp_err_t actor_post_urgent_from_isr(actor_t *const me, actor_msg_t const * const msg,
+                                     BaseType_t * const woken);
+
+/**
+ * @brief Keep queue slots free for urgent messages
+ *
+ * Normal posts fail once only `reserve` free slots remain, so urgent posts
+ * still find room when the actor falls behind.  The reserve is enforced on a
+ * best-effort basis: concurrent normal posts can take up to one reserved slot
+ * each.
+ *
+ * @param me Actor to configure
+ * @param reserve Slots kept for actor_post_urgent; 0 (default) for none
+ */
+void actor_set_urgent_reserve(actor_t * const me, uint8_t reserve);
+
+/**
+ * @brief Give the actor a queue for deferred messages
+ *
+ * @param me Actor to configure
+ * @param storage Room for `length` message references; must remain valid for
+ *                the lifetime of the actor
+ * @param length Number of messages that can be deferred at once
+ */
+void actor_defer_init(actor_t * const me, actor_msg_t const ** const storage, uint8_t length);
+
+/**
+ * @brief Set aside a message the actor cannot handle in its current state
+ *
+ * Call from the dispatch handler with the message being dispatched.  The
+ * message keeps a reference while deferred, so pooled messages stay valid.
+ * Use actor_recall once the actor can handle it.
+ *
+ * @param me Dispatching actor
+ * @param msg Message to defer
+ * @return ESP_OK if deferred, ESP_ERR_NO_MEM if the defer queue is full,
+ *         ESP_ERR_INVALID_STATE if actor_defer_init was not called
+ */
+esp_err_t actor_defer(actor_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Move the oldest deferred message back into the actor's mailbox
+ *
+ * The message is posted to the urgent lane, so it is dispatched right after
+ * the current dispatch returns, ahead of everything that arrived in the
+ * meantime.  Call from the dispatch handler.  Each recall goes in front of
+ * the previous one, so to keep the original order recall one message per
+ * dispatch, e.g. recall the next one when handling the recalled message.
+ *
+ * @param me Dispatching actor
+ * @return true if a message was recalled; false if none was deferred or the
+ *         mailbox had no room, in which case it stays deferred (the refused
+ *         post still reaches the overflow handler)
+ */
+bool actor_recall(actor_t * const me);
+
+/**
+ * @brief Choose what happens when the actor cannot take a message
+ *
+ * - ACTOR_OVERFLOW_DROP_NEWEST: the post fails with ESP_ERR_NO_MEM.
+ * - ACTOR_OVERFLOW_DROP_OLDEST: the message at the head of the queue is
+ *   discarded and the new one queued.  Urgent messages are never discarded;
+ *   while one is at the head the new message is refused with ESP_ERR_NO_MEM.
+ * - ACTOR_OVERFLOW_BLOCK: a task-level post waits up to `limit` ticks for a
+ *   free slot and fails with ESP_ERR_TIMEOUT; the urgent reserve does not
+ *   apply while waiting.  ISR posts behave as DROP_NEWEST.
+ * - ACTOR_OVERFLOW_CREDITS: every normal post takes one credit and fails with
+ *   ESP_ERR_INVALID_STATE when none are left.  The actor starts with `limit`
+ *   credits and hands out more with actor_grant_credits, typically as it
+ *   finishes work, so producers are paced by the consumer.  A full queue
+ *   still fails with ESP_ERR_NO_MEM.
+ *
+ * Every refused or discarded message is passed to `handler` and counted as
+ * dropped by the statistics.
+ *
+ * @param me Actor to configure
+ * @param policy Overflow policy
+ * @param limit Timeout in ticks for ACTOR_OVERFLOW_BLOCK, initial credits
+ *              for ACTOR_OVERFLOW_CREDITS; ignored otherwise
+ * @param handler Optional overflow handler; NULL for none
+ */
+void actor_set_overflow(actor_t * const me, actor_overflow_t policy, uint32_t limit,
+                        OverflowHandler handler);
+
+/**
+ * @brief Hand producers more credits to post to an actor
+ *
+ * Only meaningful with ACTOR_OVERFLOW_CREDITS.  Safe from any context.
+ *
+ * @param me Actor granting the credits
+ * @param credits Number of further normal posts to accept
+ */
+void actor_grant_credits(actor_t * const me, uint32_t credits);
+
+/**
+ * @brief Get the credits an actor has left
+ *
+ * @param me Actor
+ * @return Normal posts the actor will still accept under ACTOR_OVERFLOW_CREDITS
+ */
+uint32_t actor_get_credits(actor_t const * const me);
+
+/**
+ * @brief Coalesce posts of a signal while one is queued
+ *
+ * While a message with signal `sig` is queued for the actor, further posts of
+ * that signal are counted instead of queued, and the queued (oldest) message
+ * is the one dispatched.  The dispatch handler reads the count with
+ * actor_get_coalesced.  Suits periodic and level-type events such as timer
+ * ticks or "data ready", where a slow handler should see one message rather
+ * than a backlog.
+ *
+ * @param me Actor to configure
+ * @param sig Signal to coalesce; up to CONFIG_ACTOR_COALESCE_MAX per actor
+ */
+void actor_coalesce(actor_t * const me, signal_t sig);
+
+/**
+ * @brief Get the number of posts merged into the message being dispatched
+ *
+ * Only meaningful inside the dispatch handler.  In a batch handler it is the
+ * total for the burst.
+ *
+ * @param me Dispatching actor
+ * @return Posts merged by coalescing; 0 for signals that are not coalesced
+ */
+uint16_t actor_get_coalesced(actor_t const * const me);
+
+/**
+ * @brief Construct an actor as the last child of another
+ *
+ * @param me Parent actor
+ * @param child Handle of the child; allocated as by `actor_ctor` if NULL
+ * @param dispatch Dispatch handler of the child
+ */
+void actor_add_child(actor_t * const me, actor_t **child, DispatchHandler dispatch);
+
+/**
+ * @brief Get the parent of an actor
+ *
+ * @param me Actor
+ * @return Parent actor or NULL for a root actor
+ */
+actor_t *actor_get_parent(actor_t const * const me);
+
+/**
+ * @brief Get the first child of an actor
+ *
+ * Children are kept in the order they were constructed; iterate with
+ * `actor_get_next_sibling`.
+ *
+ * @param me Actor
+ * @return First child or NULL if the actor has no children
+ */
+actor_t *actor_get_first_child(actor_t const * const me);
+
+/**
+ * @brief Get the next child of the same parent
+ *
+ * @param me Actor
+ * @return Next sibling or NULL if `me` is the last child
+ */
+actor_t *actor_get_next_sibling(actor_t const * const me);
+
+/**
+ * @brief Get the id of an actor
+ *
+ * Ids are handed out as actors are constructed and reused after
+ * actor_dtor, so a program that constructs its actors in the same order
+ * gets the same ids on every run.
+ *
+ * @param me Actor
+ * @return Id of the actor
+ */
+uint16_t actor_get_id(actor_t const * const me);
+
+/**
+ * @brief Find an actor by id
+ *
+ * Constant time, for routing messages by id and for tools walking every
+ * actor up to actor_get_id_limit.
+ *
+ * @param id Id from actor_get_id
+ * @return Actor with the id; NULL if no constructed actor has it
  */
-void actor_post(actor_t *const me, actor_msg_t const * const msg);
+actor_t *actor_from_id(uint16_t id);
 
-void actor_add_child(actor_t * const me, actor_t type, DispatchHandler dispatch);
+/**
+ * @brief Get one more than the highest actor id handed out
+ *
+ * Ids are dense: they are reused lowest first after actor_dtor, so walking
+ * the ids below the limit visits every actor with few gaps.
+ *
+ * @return Bound of the ids in use
+ */
+uint16_t actor_get_id_limit(void);
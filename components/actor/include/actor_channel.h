@@ -0,0 +1,168 @@
+/**
+ * @file actor_channel.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for zero-copy byte channels streaming into an actor
+ * @version 0.1
+ * @date 2025-01-13
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+
+#include <esp_err.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Single-producer, single-consumer byte channel owned by an actor
+ *
+ * The producer, a task or an interrupt, acquires a contiguous span of the
+ * ring, fills it in place (e.g. as a DMA target) and commits it.  The
+ * consumer reads committed bytes in place and releases them.  Head and tail
+ * are each written by one side only, so neither side takes a lock.
+ *
+ * The channel is its own notification: a commit posts the channel to the
+ * consumer unless a notification is already waiting, so a burst of commits
+ * costs one message.  The consumer's dispatch handler receives the channel
+ * as the message and should read until the channel is empty; data committed
+ * after it looked posts a new notification.  A notification discarded before
+ * it is dispatched, by drop-oldest or by stopping or restarting the
+ * consumer, is forgotten, so the next commit notifies again.
+ */
+typedef struct actor_channel_s {
+    actor_msg_t super;          ///< Notification posted to the consumer
+    actor_t *consumer;          ///< Actor reading the channel
+    uint8_t *buffer;            ///< Ring storage
+    uint32_t size;              ///< Size of the ring, a power of two
+    uint32_t head;              ///< Bytes committed; written by the producer
+    uint32_t tail;              ///< Bytes released; written by the consumer
+    bool pending;               ///< A notification is queued and not yet read
+    uint32_t notifications;     ///< Notifications posted
+    uint32_t stalls;            ///< Acquires that found the ring full
+    struct actor_channel_s *next;  ///< Next constructed channel
+} actor_channel_t;
+
+/** Committed bytes readable in place; the second span holds what wrapped */
+typedef struct {
+    uint8_t const *data[2];     ///< Start of each span
+    size_t len[2];              ///< Length of each span; 0 when unused
+} actor_channel_span_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Constructor for a channel
+ *
+ * Producers that commit chunks dividing the ring size always get whole
+ * chunks from actor_channel_acquire.
+ *
+ * @param me Channel to initialize
+ * @param buffer Ring storage
+ * @param size Size of buffer; must be a power of two
+ * @param consumer Actor notified of new data
+ * @param sig Signal of the notification
+ */
+void actor_channel_ctor(actor_channel_t * const me, uint8_t * const buffer, uint32_t size, actor_t * const consumer,
+                        signal_t sig);
+
+/**
+ * @brief Get the free span the producer can fill in place
+ *
+ * The span is contiguous, so it stops at the end of the ring; acquire again
+ * after committing to continue at the start.
+ *
+ * @param me Channel
+ * @param data Set to the start of the span
+ * @return Length of the span; 0 if the ring is full
+ */
+size_t actor_channel_acquire(actor_channel_t * const me, uint8_t **data);
+
+/**
+ * @brief Publish bytes written into an acquired span
+ *
+ * @param me Channel
+ * @param len Bytes written, at most the length acquired
+ * @return ESP_OK, or the error of posting the notification
+ */
+esp_err_t actor_channel_commit(actor_channel_t * const me, size_t len);
+
+/**
+ * @brief Publish bytes written into an acquired span from an interrupt
+ *
+ * @param me Channel
+ * @param len Bytes written, at most the length acquired
+ * @param woken Set to pdTRUE if the consumer's task should run next
+ * @return ESP_OK, or the error of posting the notification
+ */
+esp_err_t actor_channel_commit_from_isr(actor_channel_t * const me, size_t len, BaseType_t * const woken);
+
+/**
+ * @brief Copy bytes into the channel and publish them
+ *
+ * For producers without a buffer of their own, e.g. a UART interrupt.
+ *
+ * @param me Channel
+ * @param data Bytes to write
+ * @param len Number of bytes
+ * @param woken NULL from a task; from an interrupt, set to pdTRUE if the
+ *              consumer's task should run next
+ * @return Bytes written; less than len if the ring filled up
+ */
+size_t actor_channel_write(actor_channel_t * const me, void const *data, size_t len, BaseType_t * const woken);
+
+/**
+ * @brief Get the committed bytes, in place
+ *
+ * Called by the consumer.  Marks the notification read, so anything
+ * committed from here on posts a new one.
+ *
+ * @param me Channel
+ * @param span Filled with up to two spans; the second one starts at the
+ *             start of the ring
+ * @return Total bytes readable
+ */
+size_t actor_channel_peek(actor_channel_t * const me, actor_channel_span_t * const span);
+
+/**
+ * @brief Give read bytes back to the producer
+ *
+ * @param me Channel
+ * @param len Bytes consumed, at most the total of the last peek
+ */
+void actor_channel_release(actor_channel_t * const me, size_t len);
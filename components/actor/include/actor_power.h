@@ -0,0 +1,141 @@
+/**
+ * @file actor_power.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for sleeping at idle points until the next time event
+ * @version 0.1
+ * @date 2024-12-23
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Put the system to sleep
+ *
+ * Must return once `budget_us` has elapsed or any wakeup source fired,
+ * whichever comes first.
+ *
+ * @param budget_us Longest sleep in microseconds; UINT64_MAX if no time event
+ *                  is armed
+ * @return Microseconds during which the RTOS tick was stopped
+ */
+typedef uint64_t (*ActorPowerSleep)(uint64_t budget_us);
+
+/** Counters of the idle points seen by actor_power_idle */
+typedef struct {
+    uint32_t sleeps;            ///< Times the system slept; each ends in one wakeup
+    uint64_t slept_us;          ///< Total time asleep in microseconds
+    uint32_t vetoed;            ///< Idle points skipped because an actor voted to stay awake
+    uint32_t busy;              ///< Idle points skipped because of queued messages, dispatches or busy cores
+    uint32_t too_short;         ///< Idle points skipped because a time event was due soon
+} actor_power_stats_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Enable sleeping at idle points
+ *
+ * @param sleep Function putting the system to sleep, e.g.
+ *              actor_power_light_sleep; NULL disables sleeping
+ * @param min_sleep_us Shortest sleep worth its entry and exit cost
+ */
+void actor_power_init(ActorPowerSleep sleep, uint64_t min_sleep_us);
+
+/**
+ * @brief Sleep until the next time event if no actor has work pending
+ *
+ * Meant to be called from vApplicationIdleHook on every core.  The system
+ * sleeps when no actor votes to stay awake, no dispatch is in progress, no
+ * running actor has messages queued, every other core runs its idle task and
+ * the next time event is at least the minimum sleep away.  With the tick back
+ * end the ticks missed while asleep are handed to time_event_add_ticks; the
+ * part of a tick left over is kept for the next sleep.
+ *
+ * Posts from interrupts only wake the system if their source is also a
+ * wakeup source of the sleep function.  An actor blocked inside its dispatch
+ * handler keeps the system awake.
+ *
+ * @return true if the system slept
+ */
+bool actor_power_idle(void);
+
+/**
+ * @brief Get how long the system could sleep now
+ *
+ * Also usable to clip the expected idle time of FreeRTOS tickless idle in
+ * configPRE_SUPPRESS_TICKS_AND_SLEEP_PROCESSING.
+ *
+ * @return Microseconds until the next time event; 0 while an actor votes to
+ *         stay awake, dispatches or has messages queued; UINT64_MAX with no
+ *         time event
+ */
+uint64_t actor_power_budget_us(void);
+
+/**
+ * @brief Vote to keep the system awake, or withdraw the vote
+ *
+ * The system does not sleep while any actor votes to stay awake, e.g. while
+ * a peripheral transfer it started is in progress.  Votes do not nest and are
+ * withdrawn when the actor stops or restarts.
+ *
+ * @param me Voting actor
+ * @param awake true to keep the system awake
+ */
+void actor_power_keep_awake(actor_t * const me, bool awake);
+
+/**
+ * @brief Get the idle point counters
+ *
+ * @param stats Filled with the counters since actor_power_init
+ */
+void actor_power_get_stats(actor_power_stats_t * const stats);
+
+/**
+ * @brief Enter light sleep with a timer wakeup after the budget
+ *
+ * Other wakeup sources, e.g. GPIO or UART, are configured by the application.
+ * Not available in the host build.
+ *
+ * @param budget_us Longest sleep in microseconds; UINT64_MAX for no timer
+ * @return Time spent in light sleep in microseconds
+ */
+uint64_t actor_power_light_sleep(uint64_t budget_us);
@@ -0,0 +1,160 @@
+/**
+ * @file actor_record.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for recording the messages queued for actors and replaying them
+ * @version 0.1
+ * @date 2024-12-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Marks the start of every frame in a drained recording ("AREC") */
+#define ACTOR_RECORD_MAGIC 0x43455241u
+
+/** Version of the recording format */
+#define ACTOR_RECORD_VERSION 2
+
+/** Record flag: the message was posted to the urgent lane */
+#define ACTOR_RECORD_URGENT 0x01u
+
+/** Record flag: only the signal was captured, the payload is missing */
+#define ACTOR_RECORD_SIGNAL_ONLY 0x02u
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Header preceding each block of records in a drained recording
+ *
+ * Little endian on the wire.  Each record that follows is a varint of the
+ * microseconds since the previous record, a varint of the receiving actor's
+ * id, a varint of ACTOR_RECORD_* flags, a varint of the message length and
+ * the message as written by actor_schema_encode.  Messages whose signal has
+ * no schema, or that encode to more than CONFIG_ACTOR_RECORD_MAX_MESSAGE
+ * bytes, are recorded as their signal alone with ACTOR_RECORD_SIGNAL_ONLY.
+ */
+typedef struct actor_record_frame_s {
+    uint32_t magic;             ///< ACTOR_RECORD_MAGIC
+    uint8_t version;            ///< ACTOR_RECORD_VERSION
+    uint8_t reserved;           ///< Written as 0
+    uint16_t count;             ///< Number of records following the header
+    uint32_t lost;              ///< Records dropped since the previous frame
+    uint32_t len;               ///< Bytes of records following the header
+} actor_record_frame_t;
+
+/** Sink for a drained recording, e.g. a file or UART writer */
+typedef void (*RecordWriteHandler)(void *ctx, void const *data, size_t len);
+
+/** Pace of a replay */
+typedef enum {
+    ACTOR_REPLAY_RECORDED,      ///< Keep the recorded gaps between messages, at tick resolution
+    ACTOR_REPLAY_FLAT_OUT,      ///< Post every message as soon as possible
+} actor_replay_mode_t;
+
+/** Outcome of a replay */
+typedef struct {
+    uint32_t records;           ///< Records read
+    uint32_t posted;            ///< Messages queued
+    uint32_t refused;           ///< Messages refused by the receiving actor
+    uint32_t skipped;           ///< Records for unknown actors or that could not be decoded
+    uint32_t uncaptured;        ///< Records whose payload was not captured; not posted
+    uint64_t span_us;           ///< Time covered by the recording
+} actor_replay_stats_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_RECORD
+/**
+ * @brief Start or stop recording the messages queued for an actor
+ *
+ * Each accepted post is recorded with the time it was queued and its lane,
+ * including posts from interrupts and posts merged by actor_coalesce.
+ * Register the schemas of the recorded signals first, see actor_remote.h;
+ * ACTOR_SCHEMA_EMPTY covers signals without payload.  A message without a
+ * schema is recorded as its signal alone and skipped on replay.
+ *
+ * @param me Actor to record
+ * @param enable true to record
+ */
+void actor_record_enable(actor_t * const me, bool enable);
+
+/**
+ * @brief Move buffered records to a sink
+ *
+ * Writes one frame with every record buffered so far.  Recording continues
+ * while draining; records added meanwhile are left for the next call.
+ * Intended to run from a low-priority task.
+ *
+ * @param write Sink receiving the recording
+ * @param ctx Context passed to the sink
+ * @return Number of records written
+ */
+uint32_t actor_record_drain(RecordWriteHandler write, void *ctx);
+#endif
+
+/**
+ * @brief Post a recording to the actors it was recorded from
+ *
+ * Decodes each message into a pooled event and posts it to the lane it was
+ * recorded on, so it goes through the receiving actor's queue and message
+ * loop like the original.  Records without their payload are counted and
+ * not posted.  Replays
+ * run in the calling task; set ACTOR_OVERFLOW_BLOCK on the actors for a
+ * lossless flat-out replay.  Register the same schemas as on the recording
+ * node.
+ *
+ * @param data Recording, one or more drained frames
+ * @param len Length of data in bytes
+ * @param actors Actors indexed by the id they were recorded under, see
+ *               actor_get_id; NULL entries are skipped.  NULL to post to the
+ *               actors that currently have those ids
+ * @param num_actors Number of entries in actors
+ * @param mode Pace of the replay
+ * @param stats Filled with the outcome; can be NULL
+ * @return ESP_OK,
+ *         ESP_ERR_INVALID_VERSION if a frame header is not recognized,
+ *         ESP_ERR_INVALID_SIZE if the recording is truncated
+ */
+esp_err_t actor_replay(uint8_t const * const data, size_t len, actor_t * const actors[], uint16_t num_actors,
+                       actor_replay_mode_t mode, actor_replay_stats_t * const stats);
@@ -0,0 +1,284 @@
+/**
+ * @file actor_remote.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for posting messages to actors on other nodes
+ * @version 0.1
+ * @date 2024-12-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** First byte of every frame; bumped when the wire format changes */
+#define ACTOR_FRAME_VERSION 1
+
+/** Bytes of frame header before the first message */
+#define ACTOR_FRAME_HEADER 3
+
+/**
+ * @brief Describe one member of a message type
+ *
+ * @param type_ Message type
+ * @param member_ Member to transfer
+ * @param kind_ One of actor_field_kind_t
+ */
+#define ACTOR_FIELD(type_, member_, kind_) \
+    { offsetof(type_, member_), (kind_), sizeof(((type_ *)0)->member_) }
+
+/**
+ * @brief Describe the wire format of a message type
+ *
+ * @param sig_ Signal the schema applies to
+ * @param type_ Message type, beginning with an `actor_msg_t super` member
+ * @param fields_ Array of ACTOR_FIELD entries, in wire order
+ */
+#define ACTOR_SCHEMA(sig_, type_, fields_) \
+    { (sig_), sizeof(type_), (fields_), sizeof(fields_) / sizeof((fields_)[0]) }
+
+/**
+ * @brief Describe a signal whose messages carry no payload
+ *
+ * @param sig_ Signal the schema applies to
+ */
+#define ACTOR_SCHEMA_EMPTY(sig_) { (sig_), sizeof(actor_msg_t), NULL, 0 }
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Encoding of a message member */
+typedef enum {
+    ACTOR_FIELD_UINT,   ///< Unsigned integer of 1, 2, 4 or 8 bytes; LEB128 varint
+    ACTOR_FIELD_INT,    ///< Signed integer of 1, 2, 4 or 8 bytes; zigzag varint
+    ACTOR_FIELD_RAW,    ///< Bytes copied as they are, e.g. floats and fixed arrays
+} actor_field_kind_t;
+
+/** One member of a message type, see ACTOR_FIELD */
+typedef struct actor_field_s {
+    uint16_t offset;            ///< Offset of the member in the message
+    uint8_t kind;               ///< One of actor_field_kind_t
+    uint8_t size;               ///< Size of the member in bytes
+} actor_field_t;
+
+/**
+ * @brief Wire format of the messages with one signal, see ACTOR_SCHEMA
+ *
+ * Both nodes must register the same schema for a signal.  Members not listed
+ * are not transferred and arrive zeroed.
+ */
+typedef struct actor_schema_s {
+    signal_t sig;               ///< Signal the schema applies to
+    uint16_t size;              ///< Size of the message type, allocated on decode
+    actor_field_t const *fields;  ///< Members in wire order
+    uint8_t num_fields;         ///< Number of entries in fields
+} actor_schema_t;
+
+typedef struct actor_transport_s actor_transport_t;
+
+/**
+ * @brief Send one frame to the other node
+ *
+ * Called from the task of a proxy.  Several proxies may share a transport,
+ * so the function must be safe to call from several tasks.  Links that can
+ * corrupt or split data must add their own framing and checksum.
+ *
+ * @param me Transport
+ * @param frame Frame to send; only valid during the call
+ * @param len Length of the frame in bytes
+ * @return ESP_OK if the frame was handed to the link
+ */
+typedef esp_err_t (*TransportSend)(actor_transport_t const * const me, uint8_t const * const frame,
+                                   size_t len);
+
+/**
+ * @brief Base class of transports
+ *
+ * Transports begin with an `actor_transport_t super` member.  Received
+ * frames are handed to actor_endpoint_receive by the transport's driver.
+ */
+struct actor_transport_s {
+    TransportSend send;         ///< Sends a frame
+};
+
+/**
+ * @brief Receiving end of a link
+ *
+ * Frames name their destination by its index in the endpoint's export table.
+ * Counters are updated by actor_endpoint_receive.
+ */
+typedef struct actor_endpoint_s {
+    actor_t * const *exports;   ///< Local actors the other node can post to
+    uint8_t num_exports;        ///< Number of entries in exports
+    uint32_t frames;            ///< Frames received
+    uint32_t messages;          ///< Messages posted to local actors
+    uint32_t errors;            ///< Malformed frames and messages that could not be posted
+} actor_endpoint_t;
+
+/**
+ * @brief Actor standing in for an actor on another node
+ *
+ * Messages posted to the proxy's actor are encoded and sent as frames.  A
+ * task-per-actor proxy packs each burst drained from its queue into as few
+ * frames as possible; a pooled proxy sends one frame per message.
+ */
+typedef struct actor_proxy_s {
+    actor_t *actor;             ///< Actor to post to
+    actor_transport_t const *transport;  ///< Link to the other node
+    uint8_t address;            ///< Index of the remote actor in the other node's exports
+    uint8_t *frame;             ///< Frame being built
+    uint16_t frame_size;        ///< Capacity of frame
+    uint16_t frame_len;         ///< Bytes used in frame
+    uint32_t frames;            ///< Frames sent
+    uint32_t messages;          ///< Messages sent
+    uint32_t dropped;           ///< Messages without a schema, too large or not sent
+} actor_proxy_t;
+
+/** Transport handing frames straight to an endpoint on the same node */
+typedef struct actor_loopback_s {
+    actor_transport_t super;    ///< Transport interface
+    actor_endpoint_t *peer;     ///< Endpoint receiving the frames
+} actor_loopback_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Provide the schema table
+ *
+ * @param storage Table of `max_signal` schema pointers; cleared here
+ * @param max_signal One more than the highest signal with a schema
+ */
+void actor_schema_init(actor_schema_t const ** const storage, signal_t max_signal);
+
+/**
+ * @brief Register the wire format of a signal
+ *
+ * @param schema Schema; must stay valid
+ */
+void actor_schema_register(actor_schema_t const * const schema);
+
+/**
+ * @brief Encode a message
+ *
+ * Members are read straight from the message, which is usually a pooled
+ * event, so nothing is copied besides the encoded bytes.  The message is
+ * encoded as its signal as a varint followed by its members in schema order.
+ *
+ * @param msg Message to encode
+ * @param buf Destination
+ * @param size Room in buf
+ * @return Bytes written; 0 if the signal has no schema or buf is too small
+ */
+size_t actor_schema_encode(actor_msg_t const * const msg, uint8_t * const buf, size_t size);
+
+/**
+ * @brief Decode a message into a new pooled event
+ *
+ * @param buf Encoded message
+ * @param len Bytes available in buf
+ * @param msg Set to the new event, or NULL if none could be allocated
+ * @param used Set to the bytes the encoded message takes, also when no event
+ *             could be allocated
+ * @return ESP_OK,
+ *         ESP_ERR_NO_MEM if no event was available; the message can be skipped,
+ *         ESP_ERR_NOT_FOUND if the signal has no schema,
+ *         ESP_ERR_INVALID_SIZE if the message is truncated
+ */
+esp_err_t actor_schema_decode(uint8_t const * const buf, size_t len, actor_msg_t **msg,
+                              size_t * const used);
+
+/**
+ * @brief Initialize an endpoint
+ *
+ * @param me Endpoint
+ * @param exports Local actors the other node can post to; must stay valid
+ * @param num_exports Number of entries in exports
+ */
+void actor_endpoint_ctor(actor_endpoint_t * const me, actor_t * const *exports, uint8_t num_exports);
+
+/**
+ * @brief Post the messages of a received frame to local actors
+ *
+ * Each message is decoded into a pooled event and posted to the exported
+ * actor the frame is addressed to.  Call it from the transport's receive
+ * task.
+ *
+ * Frame layout: ACTOR_FRAME_VERSION, the destination index, the number of
+ * messages, then the messages as written by actor_schema_encode.
+ *
+ * @param me Endpoint
+ * @param frame Received frame
+ * @param len Length of the frame in bytes
+ * @return ESP_OK if every message was posted,
+ *         ESP_ERR_INVALID_VERSION or ESP_ERR_NOT_FOUND for a frame that cannot be used,
+ *         otherwise the error of the first message that was lost
+ */
+esp_err_t actor_endpoint_receive(actor_endpoint_t * const me, uint8_t const * const frame, size_t len);
+
+/**
+ * @brief Construct a proxy actor
+ *
+ * Constructs the proxy's actor like actor_ctor and configures it to batch.
+ * Start it with any of the actor_start functions.  Posting to it is then
+ * like posting to the actor at `address` on the other node, as long as the
+ * signal has a schema.
+ *
+ * @param proxy Proxy; must stay valid
+ * @param parent Parent of the proxy's actor; can be NULL
+ * @param me Handle of the proxy's actor, as for actor_ctor
+ * @param transport Link to the other node
+ * @param address Index of the remote actor in the other node's exports
+ * @param frame Storage for frames; its size bounds the largest message
+ * @param frame_size Size of frame in bytes, at least ACTOR_FRAME_HEADER + 1
+ */
+void actor_proxy_ctor(actor_proxy_t * const proxy, actor_t *parent, actor_t **me,
+                      actor_transport_t const * const transport, uint8_t address,
+                      uint8_t * const frame, uint16_t frame_size);
+
+/**
+ * @brief Initialize a loopback transport
+ *
+ * Frames are received by `peer` in the sending proxy's task.  Stands in for
+ * a physical link in host tests.
+ *
+ * @param me Transport
+ * @param peer Endpoint receiving the frames
+ */
+void actor_loopback_ctor(actor_loopback_t * const me, actor_endpoint_t * const peer);
@@ -0,0 +1,196 @@
+/**
+ * @file actor_request.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for request/reply messaging between actors and tasks
+ * @version 0.1
+ * @date 2024-12-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+#include "time_event.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+
+#include <esp_err.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Base class of request messages
+ *
+ * Requests are ordinary messages whose type begins with an
+ * `actor_request_t super` member.  The framework fills in the correlation id
+ * and the reply address when the request is sent.
+ */
+typedef struct actor_request_s {
+    actor_msg_t super;          ///< Message carrying the request
+    uint32_t corr_id;           ///< Correlation id copied into the reply
+    actor_t *reply_to;          ///< Actor receiving the reply; NULL for a task in actor_call
+} actor_request_t;
+
+/** Base class of reply messages; types begin with an `actor_reply_t super` */
+typedef struct actor_reply_s {
+    actor_msg_t super;          ///< Message carrying the reply
+    uint32_t corr_id;           ///< Correlation id of the request answered
+} actor_reply_t;
+
+/**
+ * @brief Outstanding request of an actor, with its timeout
+ *
+ * An actor keeps one of these per request it can have in flight.  The
+ * timeout is an ordinary time event posted to the requesting actor, so a
+ * pending request costs nothing until its reply or its timeout arrives.
+ */
+typedef struct actor_pending_s {
+    time_event_t timeout;       ///< Posts the timeout signal to the requester
+    uint32_t corr_id;           ///< Correlation id awaited; 0 when idle
+    bool timed;                 ///< The outstanding request armed the timeout
+} actor_pending_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Send a request to an actor
+ *
+ * Assigns a new correlation id, stored in `req->corr_id`, and posts the
+ * request.  The server answers with actor_reply, which posts the reply to
+ * `reply_to`.
+ *
+ * @param server Actor handling the request
+ * @param req Request to send
+ * @param reply_to Actor receiving the reply
+ * @return Result of actor_post
+ */
+esp_err_t actor_request(actor_t * const server, actor_request_t * const req, actor_t * const reply_to);
+
+/**
+ * @brief Answer a request
+ *
+ * Copies the request's correlation id into the reply and delivers it: posted
+ * to the requesting actor, or handed to the task blocked in actor_call.  A
+ * reply nobody waits for any more is released.  To answer after the dispatch
+ * handler returns, keep the request with event_ref or copy its `corr_id` and
+ * `reply_to` into a request of your own.
+ *
+ * @param req Request being answered
+ * @param reply Reply to deliver; ownership passes to the framework
+ * @return ESP_OK if delivered; ESP_ERR_TIMEOUT if the requester gave up;
+ *         otherwise the result of actor_post
+ */
+esp_err_t actor_reply(actor_request_t const * const req, actor_reply_t * const reply);
+
+/**
+ * @brief Send a request from a task and block until the reply arrives
+ *
+ * Uses the calling task's notification value, so it must not be called from
+ * an actor's dispatch handler or from a task that waits on notifications for
+ * other purposes.  A reply arriving after the timeout is released.  The
+ * server may still be holding `req` after a timeout, so `req` should be a
+ * pooled event rather than a variable on the caller's stack.
+ *
+ * @param server Actor handling the request
+ * @param req Request to send
+ * @param reply Receives the reply on success; release it with event_gc
+ * @param timeout Longest wait in ticks
+ * @return ESP_OK with `*reply` set; ESP_ERR_TIMEOUT if no reply arrived in
+ *         time; otherwise the result of actor_post
+ */
+esp_err_t actor_call(actor_t * const server, actor_request_t * const req,
+                     actor_reply_t const ** const reply, TickType_t timeout);
+
+/**
+ * @brief Constructor for a pending request
+ *
+ * @param me Pending request to initialize
+ * @param timeout_sig Signal posted to `requester` when a request times out
+ * @param requester Actor sending the requests and receiving the replies
+ */
+void actor_pending_ctor(actor_pending_t * const me, signal_t timeout_sig, actor_t * const requester);
+
+/**
+ * @brief Send a request whose reply is tracked by a pending request
+ *
+ * Like actor_request with the requester as `reply_to`.  Replaces any request
+ * still outstanding on `me`; its reply will no longer match.
+ *
+ * @param me Pending request tracking the reply
+ * @param server Actor handling the request
+ * @param req Request to send
+ * @param timeout Ticks until the timeout signal is posted; 0 for no timeout
+ * @return Result of actor_post
+ */
+esp_err_t actor_pending_request(actor_pending_t * const me, actor_t * const server,
+                                actor_request_t * const req, uint32_t timeout);
+
+/**
+ * @brief Check whether a message is the reply to the outstanding request
+ *
+ * Call from the requester's dispatch handler for every reply signal.  On a
+ * match the timeout is cancelled and `me` becomes idle; late replies to
+ * requests that timed out or were replaced do not match.
+ *
+ * @param me Pending request
+ * @param msg Message received by the requester
+ * @return true if `msg` answers the outstanding request
+ */
+bool actor_pending_reply(actor_pending_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Check whether a message is the timeout of the outstanding request
+ *
+ * Call from the requester's dispatch handler for the timeout signal.  On a
+ * match `me` becomes idle.  A timeout that expired while its reply was
+ * already queued does not match, nor does it match a later request unless
+ * that request's own timer has expired as well.
+ *
+ * @param me Pending request
+ * @param msg Message received by the requester
+ * @return true if the outstanding request timed out
+ */
+bool actor_pending_timeout(actor_pending_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Check whether a request is outstanding
+ *
+ * @param me Pending request
+ * @return true while waiting for a reply or timeout
+ */
+bool actor_pending_busy(actor_pending_t const * const me);
@@ -0,0 +1,94 @@
+/**
+ * @file actor_sched.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for running actors on a shared pool of worker tasks
+ * @version 0.1
+ * @date 2024-10-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdint.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Start the shared worker tasks
+ *
+ * Creates CONFIG_ACTOR_SCHED_WORKERS worker tasks, pinned round-robin to the
+ * available cores.  Each worker owns a ready set of pooled actors and steals
+ * from the other workers when its own set is empty, trying the workers on its
+ * own core first.  A pooled actor runs on the core of its home worker unless
+ * it is stolen.
+ *
+ * @param task_prio FreeRTOS priority of the worker tasks
+ * @param stack_size Stack size of each worker task
+ */
+void actor_sched_start(uint8_t task_prio, uint32_t stack_size);
+
+/**
+ * @brief Start an actor on the shared worker pool
+ *
+ * Alternative to `actor_start` for lightweight actors that do not need a
+ * task of their own.  Messages are dispatched run-to-completion, one at a
+ * time, by whichever worker picks the actor up; the highest ready priority
+ * level is always served first.  The dispatch handler sees no difference
+ * from a task-per-actor actor, but must not block.
+ *
+ * @param me Actor to start
+ * @param prio Priority level, 0 (lowest) to CONFIG_ACTOR_SCHED_PRIO_LEVELS - 1
+ * @param queue_length Number of messages that can be queued for the actor
+ * @param home Worker whose ready set holds the actor
+ */
+void actor_start_pooled(actor_t *const me, uint8_t prio, uint32_t queue_length, uint8_t home);
+
+/**
+ * @brief Start an actor on the shared worker pool in caller-provided storage
+ *
+ * Same as `actor_start_pooled`, but the queue comes from `storage` (see
+ * ACTOR_POOLED_STORAGE) instead of the heap.
+ *
+ * @param me Actor to start
+ * @param prio Priority level, 0 (lowest) to CONFIG_ACTOR_SCHED_PRIO_LEVELS - 1
+ * @param storage Queue storage; must remain valid for the lifetime of the actor
+ * @param home Worker whose ready set holds the actor
+ */
+void actor_start_pooled_static(actor_t *const me, uint8_t prio, actor_storage_t const * const storage,
+                               uint8_t home);
@@ -0,0 +1,132 @@
+/**
+ * @file actor_sizing.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for sizing actor stacks and queues from measured use
+ * @version 0.1
+ * @date 2025-01-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Measured and recommended sizes of an actor */
+typedef struct actor_size_s {
+    uint16_t id;                ///< Id of the actor, see actor_get_id
+    uint16_t queue_length;      ///< Recommended queue length
+    uint32_t stack_size;        ///< Recommended stack size as passed to actor_start; 0 for pooled actors
+    uint16_t queue_peak;        ///< Most messages waiting in the queue at once
+    uint32_t stack_used;        ///< Deepest stack use, in the unit of stack_size
+} actor_size_t;
+
+/** Sink for the generated header, e.g. a console or file writer */
+typedef void (*SizingWriteHandler)(void *ctx, char const *text, size_t len);
+
+/**
+ * Called for an actor that used more than it did when it was profiled.
+ * `profiled` is its entry in the applied table, `now` its current use.
+ */
+typedef void (*SizingAlarmHandler)(actor_t * const me, actor_size_t const * const profiled,
+                                   actor_size_t const * const now);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_SIZING
+/**
+ * @brief Measure an actor and recommend its sizes
+ *
+ * The stack is measured from its high-water mark while the actor's task
+ * runs; for a stopped actor the current size is kept.  Recommendations add
+ * CONFIG_ACTOR_SIZING_MARGIN percent to the measured use.  A queue that has
+ * been full keeps its length, since it may have needed more.
+ *
+ * @param me Actor to measure
+ * @param size Filled with the measured and recommended sizes
+ */
+void actor_sizing_measure(actor_t const * const me, actor_size_t * const size);
+
+/**
+ * @brief Clear an actor's queue peak
+ *
+ * The stack high-water mark cannot be cleared; it covers the life of the task.
+ *
+ * @param me Actor to reset
+ */
+void actor_sizing_reset(actor_t * const me);
+
+/**
+ * @brief Write a header with the recommended sizes of every actor
+ *
+ * The header defines ACTOR_SIZE_<id>_QUEUE_LENGTH and
+ * ACTOR_SIZE_<id>_STACK_SIZE for sizing static storage, and ACTOR_SIZES_INIT
+ * and ACTOR_SIZES_COUNT for a table to pass to actor_sizing_apply.  Run it
+ * after a representative workload.
+ *
+ * @param write Sink receiving the header text
+ * @param ctx Context passed to the sink
+ * @return Number of actors written
+ */
+uint16_t actor_sizing_emit(SizingWriteHandler write, void *ctx);
+
+/**
+ * @brief Size actors started from now on from a table
+ *
+ * actor_start and actor_start_pooled take the queue length and stack size of
+ * the actor's entry instead of their arguments; actors without an entry
+ * keep their arguments.  Static storage is not resized, use the per-actor
+ * macros of the generated header for it.  The table must stay valid.
+ *
+ * @param table Sizes, usually ACTOR_SIZES_INIT from a generated header; NULL
+ *              to stop applying sizes
+ * @param count Number of entries in table
+ */
+void actor_sizing_apply(actor_size_t const * const table, uint16_t count);
+
+/**
+ * @brief Check the actors of the applied table against their profile
+ *
+ * An actor whose stack or queue went deeper than when it was profiled is
+ * eating into its margin, which the profiling run did not cover.  Intended
+ * to run periodically from a low-priority task.
+ *
+ * @param alarm Called for each such actor; can be NULL
+ * @return Number of actors over their profile
+ */
+uint16_t actor_sizing_check(SizingAlarmHandler alarm);
+#endif
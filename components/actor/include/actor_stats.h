@@ -0,0 +1,141 @@
+/**
+ * @file actor_stats.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for per-actor runtime statistics
+ * @version 0.1
+ * @date 2024-11-18
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Number of buckets in the queueing latency histogram */
+#define ACTOR_STATS_BUCKETS 24
+
+/** Number of senders tracked per actor */
+#define ACTOR_STATS_PEERS 4
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_STATS
+/** Actor posting to another, with an estimate of the messages it posted */
+typedef struct actor_peer_s {
+    uint16_t id;                ///< Id of the sending actor
+    uint32_t posts;             ///< Messages posted; 0 for an unused entry
+} actor_peer_t;
+
+/** Snapshot of an actor's runtime statistics */
+typedef struct actor_stats_s {
+    uint32_t posted;            ///< Messages queued
+    uint32_t dropped;           ///< Messages lost because the queue was full
+    uint32_t dispatched;        ///< Messages handled by the dispatch function
+    uint32_t queue_hwm;         ///< Most messages waiting in the queue at once
+    uint64_t cpu_cycles;        ///< Cycles spent in the dispatch function
+
+    /**
+     * Time from post to start of dispatch.  Bucket 0 counts latencies below
+     * 1 us, bucket n latencies in [2^(n-1), 2^n) us; the last bucket also
+     * counts everything longer.
+     */
+    uint32_t latency[ACTOR_STATS_BUCKETS];
+
+    /** Longest dispatch in cycles per signal; higher signals share the last entry */
+    uint32_t max_dispatch[CONFIG_ACTOR_STATS_MAX_SIGNALS];
+
+    /** Messages queued per core of the sender, interrupts included */
+    uint32_t from_core[portNUM_PROCESSORS];
+
+    /**
+     * Actors that posted the most messages, tracked with the space-saving
+     * algorithm: a new sender replaces the entry with the fewest posts and
+     * inherits its count, so counts are upper bounds.  Posts from interrupts
+     * and from tasks that are not actors are not attributed.  The sender is
+     * the actor the posting task is dispatching, kept in the task's
+     * thread-local slot CONFIG_ACTOR_STATS_TLS_INDEX.
+     */
+    actor_peer_t peers[ACTOR_STATS_PEERS];
+} actor_stats_t;
+#endif
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_STATS
+/**
+ * @brief Take a snapshot of an actor's statistics
+ *
+ * Counters are updated without locking, so a snapshot taken while the actor
+ * is busy may be off by a message.
+ *
+ * @param me Actor to inspect
+ * @param stats Filled in with the current values
+ */
+void actor_stats_get(actor_t const * const me, actor_stats_t * const stats);
+
+/**
+ * @brief Clear an actor's statistics
+ *
+ * @param me Actor to reset
+ */
+void actor_stats_reset(actor_t * const me);
+
+/**
+ * @brief Log an actor's statistics to the console
+ *
+ * @param me Actor to dump
+ */
+void actor_stats_dump(actor_t const * const me);
+
+/**
+ * @brief Suggest cores for a set of actors from their observed traffic
+ *
+ * Actors are grouped with the senders that account for at least a quarter of
+ * the messages they received, so that tightly coupled actors share a core.
+ * Groups are then spread over the cores, heaviest first, balancing the CPU
+ * time spent in their dispatch handlers.  Only traffic between the listed
+ * actors is considered.  Apply the result with actor_set_affinity (or the
+ * home worker of pooled actors) on the next start.
+ *
+ * @param actors Actors to place
+ * @param cores Receives the suggested core of each actor
+ * @param count Number of actors, at most CONFIG_ACTOR_MAX_ACTORS
+ */
+void actor_stats_suggest_placement(actor_t * const actors[], BaseType_t cores[], uint16_t count);
+#endif
@@ -0,0 +1,153 @@
+/**
+ * @file actor_supervisor.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for supervising child actors and restarting them on failure
+ * @version 0.1
+ * @date 2024-12-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+#include "time_event.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Children restarted when one of them fails */
+typedef enum {
+    ACTOR_RESTART_ONE_FOR_ONE,      ///< Only the failed child
+    ACTOR_RESTART_ONE_FOR_ALL,      ///< Every running child
+} actor_strategy_t;
+
+/**
+ * @brief Supervision state of an actor
+ *
+ * Owned by the framework once passed to actor_supervise.  The watchdog check
+ * is an ordinary time event posted to the supervisor.
+ */
+typedef struct actor_supervisor_s {
+    time_event_t check;         ///< Posts WATCHDOG_SIG to the supervisor
+    uint8_t strategy;           ///< One of actor_strategy_t
+    uint32_t restarts;          ///< Children restarted so far
+} actor_supervisor_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Make an actor the supervisor of its children
+ *
+ * When a child fails (actor_fail) or hangs (actor_set_watchdog) the
+ * supervisor restarts it, or all of its children, according to the strategy.
+ * Failed children are restarted with actor_restart, so they handle QUIT_SIG
+ * and then INIT_SIG again on the same task and queue.  Hung children marked
+ * with actor_set_killable are killed and their task is created again on the
+ * next check, reusing the storage they were started with; other hung
+ * children are restarted like failed ones once their dispatch returns.  The
+ * supervisor's dispatch handler still receives CHILD_EXIT_SIG for every exit;
+ * WATCHDOG_SIG is consumed.
+ *
+ * Call it before the supervisor is started or from its dispatch handler.
+ *
+ * @param me Supervising actor
+ * @param sup Storage for the supervision state; must outlive the actor
+ * @param strategy One of actor_strategy_t
+ * @param period Ticks between watchdog checks; 0 to only handle actor_fail
+ */
+void actor_supervise(actor_t * const me, actor_supervisor_t * const sup, actor_strategy_t strategy,
+                     uint32_t period);
+
+/**
+ * @brief Watch an actor's dispatches for hangs
+ *
+ * An actor is hung once a single dispatch has run for longer than `timeout`.
+ * Its supervisor notices it on the next check, so the detection delay is up
+ * to `timeout` plus the check period.  The hang is reported with
+ * ACTOR_EXIT_HUNG; the actor is only killed if actor_set_killable allows it.
+ *
+ * @param me Child of a supervisor
+ * @param timeout Longest dispatch in ticks; 0 stops watching
+ */
+void actor_set_watchdog(actor_t * const me, uint32_t timeout);
+
+/**
+ * @brief Let the supervisor kill the actor's task when it hangs
+ *
+ * Killing deletes the task in the middle of its dispatch: any mutex, pooled
+ * event, peer lock or heap memory the handler holds at that moment is never
+ * released.  Only allow it for actors whose handlers hold none of these
+ * across a point where they can hang.  Pooled actors are never killed.
+ *
+ * @param me Child of a supervisor with its own task
+ * @param killable true to kill the task on a hang; false (the default) to
+ *                 only report it
+ */
+void actor_set_killable(actor_t * const me, bool killable);
+
+/**
+ * @brief Report that an actor failed
+ *
+ * Posts the actor's CHILD_EXIT_SIG with ACTOR_EXIT_FAILED to the urgent lane
+ * of its parent.  Typically called by the actor itself when it detects a
+ * fault it cannot recover from.
+ *
+ * @param me Failed actor
+ */
+void actor_fail(actor_t * const me);
+
+/**
+ * @brief Report that an actor failed from an interrupt or a kernel hook
+ *
+ * Usable from vApplicationStackOverflowHook on ports that let the
+ * application provide it, together with actor_from_task.
+ *
+ * @param me Failed actor
+ * @param woken Set to pdTRUE if a task with higher priority was woken
+ */
+void actor_fail_from_isr(actor_t * const me, BaseType_t * const woken);
+
+/**
+ * @brief Find the actor running on a task
+ *
+ * @param task Task handle, e.g. the one passed to a stack overflow hook
+ * @return Actor whose own task it is or NULL for any other task
+ */
+actor_t *actor_from_task(TaskHandle_t task);
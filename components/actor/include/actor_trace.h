@@ -0,0 +1,112 @@
+/**
+ * @file actor_trace.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for the binary actor event trace recorder
+ * @version 0.1
+ * @date 2024-11-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Marks the start of every frame in a drained trace stream ("ATRC") */
+#define ACTOR_TRACE_MAGIC 0x43525441u
+
+/** Version of the stream format */
+#define ACTOR_TRACE_VERSION 1
+
+/** Actor id used in records not tied to an actor */
+#define ACTOR_TRACE_NO_ACTOR 0xFF
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Kinds of trace records */
+enum ActorTraceType {
+    ACTOR_TRACE_POST,           ///< Message queued for an actor
+    ACTOR_TRACE_DISPATCH_BEGIN, ///< Actor started handling a message
+    ACTOR_TRACE_DISPATCH_END,   ///< Actor finished handling a message
+    ACTOR_TRACE_TIMER,          ///< Time event expired
+    ACTOR_TRACE_DROP,           ///< Message refused or discarded; a refused post follows its POST
+};
+
+/**
+ * @brief One trace record, 8 bytes, little endian on the wire
+ *
+ * Timestamps are deltas of the recording core's cycle counter relative to
+ * the previous record of the same core.
+ */
+typedef struct actor_trace_record_s {
+    uint32_t delta;             ///< Cycles since the previous record on this core
+    uint16_t sig;               ///< Signal concerned
+    uint8_t actor;              ///< Actor id or ACTOR_TRACE_NO_ACTOR
+    uint8_t type;               ///< One of ActorTraceType
+} actor_trace_record_t;
+
+/**
+ * @brief Header preceding each block of records in a drained stream
+ */
+typedef struct actor_trace_frame_s {
+    uint32_t magic;             ///< ACTOR_TRACE_MAGIC
+    uint8_t version;            ///< ACTOR_TRACE_VERSION
+    uint8_t core;               ///< Core that recorded the block
+    uint16_t count;             ///< Number of records following the header
+    uint32_t lost;              ///< Records dropped on this core since the previous frame
+    uint32_t cpu_hz;            ///< Cycle counter frequency
+} actor_trace_frame_t;
+
+/** Sink for drained trace data, e.g. a UART or file writer */
+typedef void (*TraceWriteHandler)(void *ctx, void const *data, size_t len);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_TRACE
+/**
+ * @brief Move buffered trace records to a sink
+ *
+ * Writes one frame per core with pending records.  Recording continues while
+ * draining; records added meanwhile are left for the next call.  Intended to
+ * run from a low-priority task.
+ *
+ * @param write Sink receiving the stream
+ * @param ctx Context passed to the sink
+ * @return Number of records written
+ */
+uint32_t actor_trace_drain(TraceWriteHandler write, void *ctx);
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file event_pool.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for pooled, reference-counted events in the actor framework
+ * @version 0.1
+ * @date 2024-10-14
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdint.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/**
+ * @brief Declare static storage for an event pool
+ *
+ * Each block is large enough to hold one `type_` event and is aligned so that
+ * the free list link can live inside unused blocks.
+ *
+ * @param name_ Name of the storage array
+ * @param type_ Largest event type served by the pool
+ * @param count_ Number of blocks in the pool
+ */
+#define EVENT_POOL_STORAGE(name_, type_, count_) \
+    static union { type_ event; void *next; } name_[count_]
+
+/**
+ * @brief Allocate an event of the given type from the event pools
+ *
+ * @param type_ Event type; must begin with an `actor_msg_t super` member
+ * @param sig_ Signal to assign to the event
+ */
+#define EVENT_NEW(type_, sig_) ((type_ *)event_new(sizeof(type_), (sig_)))
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Register a block of storage as an event pool
+ *
+ * Pools must be registered in ascending order of block size, before any
+ * event is allocated.  `event_new` serves a request from the first pool
+ * whose blocks are large enough.
+ *
+ * @param storage Storage for the pool, usually declared with EVENT_POOL_STORAGE
+ * @param storage_size Size of the storage in bytes
+ * @param block_size Size of a single block in bytes
+ */
+void event_pool_init(void * const storage, uint32_t storage_size, uint16_t block_size);
+
+/**
+ * @brief Allocate a pooled event
+ *
+ * Allocation is O(1) and never touches the heap; it is safe to call from
+ * an ISR.  The event is returned with a reference count of 0 - posting it
+ * hands ownership to the framework, which releases it after the receiving
+ * actor's dispatch handler returns.
+ *
+ * @param size Size of the event in bytes
+ * @param sig Signal to assign to the event
+ * @return Pointer to the new event or NULL if no suitable block is free
+ */
+actor_msg_t *event_new(uint16_t size, signal_t sig);
+
+/**
+ * @brief Take an additional reference to an event
+ *
+ * Has no effect on static events.
+ *
+ * @param msg Event to reference
+ */
+void event_ref(actor_msg_t const * const msg);
+
+/**
+ * @brief Release a reference to an event
+ *
+ * The block is returned to its pool when the last reference is released.
+ * Static events are ignored, so this may be called on any message.  An event
+ * that was allocated but never posted can be released with this call.
+ *
+ * @param msg Event to release
+ */
+void event_gc(actor_msg_t const * const msg);
+
+/**
+ * @brief Get the lowest number of free blocks ever seen in a pool
+ *
+ * @param pool_id Pool number, starting at 1 in registration order
+ * @return Low-water mark of free blocks or 0 for an unknown pool
+ */
+uint16_t event_pool_get_min_free(uint8_t pool_id);
@@ -0,0 +1,165 @@
+/**
+ * @file hsm.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for table-driven hierarchical state machines in the actor framework
+ * @version 0.1
+ * @date 2024-11-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Deepest nesting of states and longest cached entry path */
+#define HSM_MAX_DEPTH CONFIG_ACTOR_HSM_MAX_DEPTH
+
+/** Id used for "above the top-level states" */
+#define HSM_TOP 0xFF
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Forward declaration of the state machine instance */
+typedef struct hsm_s hsm_t;
+
+/** Entry or exit action of a state */
+typedef void (*HsmStateAction)(hsm_t * const me);
+
+/** Action executed by a transition */
+typedef void (*HsmAction)(hsm_t * const me, actor_msg_t const * const msg);
+
+/** Guard deciding whether a transition is taken */
+typedef bool (*HsmGuard)(hsm_t const * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Transition triggered by a signal
+ *
+ * A transition without a target is internal: only its action runs and the
+ * state configuration does not change.
+ */
+typedef struct hsm_transition_s {
+    signal_t sig;                       ///< Triggering signal
+    struct hsm_state_s const *target;   ///< Target state; NULL for an internal transition
+    HsmGuard guard;                     ///< Guard condition; NULL if unconditional
+    HsmAction action;                   ///< Transition action; may be NULL
+} hsm_transition_t;
+
+/**
+ * @brief State of a hierarchical state machine
+ *
+ * States are const and can live in flash.  The transitions of a state are a
+ * contiguous range of the machine's transition table and are tried in order;
+ * unhandled signals propagate to the parent state.
+ */
+typedef struct hsm_state_s {
+    struct hsm_state_s const *parent;   ///< Enclosing state; NULL at the top level
+    struct hsm_state_s const *initial;  ///< Default direct substate; NULL for leaf states
+    HsmStateAction entry;               ///< Entry action; may be NULL
+    HsmStateAction exit;                ///< Exit action; may be NULL
+    uint16_t first;                     ///< Index of the first transition of the state
+    uint8_t count;                      ///< Number of transitions of the state
+    uint8_t id;                         ///< Index of the state in the machine's state table
+} hsm_state_t;
+
+/** Const description of a state machine */
+typedef struct hsm_def_s {
+    hsm_state_t const * const *states;      ///< All states, indexed by their id
+    hsm_transition_t const *transitions;    ///< Transitions of all states
+    hsm_state_t const *initial;             ///< Top-level initial state
+    uint8_t num_states;                     ///< Number of states
+    uint16_t num_transitions;               ///< Number of transitions
+} hsm_def_t;
+
+/**
+ * @brief Cached path of an external transition
+ *
+ * Computed once by `hsm_init`.  The caller provides one per transition,
+ * usually as a static array.
+ */
+typedef struct hsm_path_s {
+    uint8_t lca;                        ///< Id of the state where exits stop; HSM_TOP for none
+    uint8_t num_entry;                  ///< Number of states to enter
+    uint8_t entry[HSM_MAX_DEPTH];       ///< Ids of the states to enter, outermost first
+} hsm_path_t;
+
+/** State machine instance */
+struct hsm_s {
+    hsm_def_t const *def;               ///< Machine description
+    hsm_path_t *paths;                  ///< Cached transition paths
+    hsm_state_t const *state;           ///< Current leaf state; NULL until INIT_SIG
+    actor_t *actor;                     ///< Actor running the machine
+};
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize a state machine instance
+ *
+ * Precomputes the exit boundary and entry path of every transition so that
+ * taking a transition only walks cached data.  No memory is allocated.
+ *
+ * @param me State machine instance
+ * @param def Machine description
+ * @param paths Storage for `def->num_transitions` cached paths
+ * @param actor Actor running the machine
+ */
+void hsm_init(hsm_t * const me, hsm_def_t const * const def, hsm_path_t * const paths, actor_t *actor);
+
+/**
+ * @brief Dispatch a message to a state machine
+ *
+ * Call this from the actor's DispatchHandler.  INIT_SIG enters the initial
+ * state configuration; other signals are offered to the current leaf state
+ * and then to its ancestors until a transition is taken.  Unhandled signals
+ * are ignored.
+ *
+ * @param me State machine instance
+ * @param msg Message to dispatch
+ */
+void hsm_dispatch(hsm_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Check whether a state is active
+ *
+ * @param me State machine instance
+ * @param state State to check
+ * @return true if `state` is the current leaf state or one of its ancestors
+ */
+bool hsm_is_in(hsm_t const * const me, hsm_state_t const * const state);
@@ -0,0 +1,107 @@
+/**
+ * @file pubsub.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief API for publish-subscribe messaging in the actor framework
+ * @version 0.1
+ * @date 2024-11-11
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Number of 32-bit words in a subscriber bitmap */
+#define PUBSUB_WORDS ((CONFIG_ACTOR_MAX_ACTORS + 31) / 32)
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Set of actors subscribed to one signal, one bit per actor id */
+typedef struct actor_subscr_list_s {
+    uint32_t bits[PUBSUB_WORDS];
+} actor_subscr_list_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the publish-subscribe service
+ *
+ * Must be called once before any actor subscribes.  Only signals below
+ * `max_signal` can be published.
+ *
+ * @param storage Array of `max_signal` subscriber lists
+ * @param max_signal Number of signals that can be published
+ */
+void actor_pubsub_init(actor_subscr_list_t * const storage, signal_t max_signal);
+
+/**
+ * @brief Subscribe an actor to a signal
+ *
+ * @param me Subscribing actor
+ * @param sig Signal to subscribe to
+ */
+void actor_subscribe(actor_t const * const me, signal_t sig);
+
+/**
+ * @brief Unsubscribe an actor from a signal
+ *
+ * @param me Subscribed actor
+ * @param sig Signal to unsubscribe from
+ */
+void actor_unsubscribe(actor_t const * const me, signal_t sig);
+
+/**
+ * @brief Unsubscribe an actor from every signal
+ *
+ * @param me Subscribed actor
+ */
+void actor_unsubscribe_all(actor_t const * const me);
+
+/**
+ * @brief Post a message to every actor subscribed to its signal
+ *
+ * The message is not copied: each subscriber receives a reference, so pooled
+ * messages are returned to their pool after the last subscriber has handled
+ * them.  The cost depends on the number of subscribers, not the number of
+ * actors.  Actors subscribed when the call starts receive the message unless
+ * they unsubscribe or are destroyed before their turn.
+ *
+ * @param msg Message to publish
+ */
+void actor_publish(actor_msg_t const * const msg);
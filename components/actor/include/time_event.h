@@ -33,8 +33,11 @@
 
 #include "actor.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include <sdkconfig.h>
+
 #pragma once
 
 /*******************************************************************************
@@ -44,11 +47,36 @@
  * Type Definitions
  ******************************************************************************/
 
+/**
+ * @brief Time event object
+ *
+ * With the tick back end armed time events are kept in a hierarchical timing
+ * wheel, so the cost of `time_event_tick` depends on the number of timers
+ * expiring rather than the number of timers armed.  With the tickless back end
+ * they are kept in a list sorted by absolute deadline and a single one-shot
+ * esp_timer is programmed for the earliest one.  The links are owned by the
+ * framework.
+ *
+ * A timer with slack may fire up to that much after its expiry, so that
+ * timers with overlapping windows share one wakeup.  Periodic timers are
+ * re-armed against their nominal expiry, so neither slack nor a late post
+ * shifts their phase.
+ */
 typedef struct time_event_s {
-    actor_msg_t super;
-    actor_t *actor;
-    uint32_t timeout;
-    uint32_t interval;
+    actor_msg_t super;              ///< Message posted on expiry
+    actor_t *actor;                 ///< Actor receiving the message
+    struct time_event_s *next;      ///< Next timer in the same list
+    struct time_event_s **pprev;    ///< Link pointing at this timer; NULL when disarmed
+#if CONFIG_ACTOR_TIME_EVENT_TICKLESS
+    int64_t expiry;                 ///< Absolute deadline in microseconds
+    uint64_t interval;              ///< Reload value in microseconds; 0 for one-shot
+    uint64_t slack;                 ///< Time the timer may fire late in microseconds
+#else
+    uint32_t expiry;                ///< Tick on which the timer fires
+    uint32_t interval;              ///< Reload value in ticks; 0 for one-shot
+    uint32_t due;                   ///< Nominal expiry tick; periods count from it
+    uint32_t slack;                 ///< Ticks the timer may fire late
+#endif
 } time_event_t;
 
 /*******************************************************************************
@@ -58,37 +86,160 @@ typedef struct time_event_s {
 /**
  * @brief Constructor for a timer event.
  *
- * This will initialize the current timeout and interval to 0.
+ * This will initialize the timer as disarmed with an interval of 0.  There is
+ * no limit on the number of time events.
  *
- * @param me Timer to register
+ * @param me Timer to initialize
  * @param sig Signal to send to actor upon timer expiration
  * @param actor Actor to send signal to.
  */
 void time_event_ctor(time_event_t * const me, signal_t sig, actor_t *actor);
 
+/**
+ * @brief Initialize the time event service
+ *
+ * Creates the one-shot esp_timer used by the tickless back end and must be
+ * called from a task before any timer is armed.  With the tick back end this
+ * does nothing.
+ */
+void time_event_init(void);
+
 /**
  * @brief Arm the current timer event
  *
+ * Arming an already armed timer restarts it with the new values.
+ *
  * @param me Timer to arm
- * @param timeout Unsigned word integer representing initial timeout value
+ * @param timeout Unsigned word integer representing initial timeout value in
+ *                ticks; 0 leaves the timer disarmed
  * @param interval Unsigned word integer representing the following timeout values
  *                 on timer expiry.
  */
 void time_event_arm(time_event_t *const me, uint32_t timeout, uint32_t interval);
 
+/**
+ * @brief Arm the current timer event with microsecond values
+ *
+ * The tickless back end keeps microsecond resolution.  The tick back end
+ * rounds both values up to whole ticks.
+ *
+ * @param me Timer to arm
+ * @param timeout Initial timeout in microseconds; 0 leaves the timer disarmed
+ * @param interval Following timeout values in microseconds; 0 for one-shot
+ */
+void time_event_arm_us(time_event_t *const me, uint64_t timeout, uint64_t interval);
+
+/**
+ * @brief Allow a timer to fire late so that it can share a wakeup
+ *
+ * The timer then fires on any tick between its expiry and its expiry plus
+ * the slack.  The tick back end picks a tick in that window on which other
+ * timers already fire, or else the tick with the most trailing zero bits, so
+ * that timers armed later tend to pick it too.  The tickless back end wakes
+ * at the earliest end of the overlapping windows and fires every timer whose
+ * window has opened.  Timers firing on the same tick for the same actor are
+ * posted together and drained in one wakeup of the actor.
+ *
+ * Takes effect from the next time the timer is armed or re-armed.  Slack
+ * should stay below the interval of a periodic timer.
+ *
+ * @param me Timer to configure
+ * @param slack Allowed lateness in ticks; 0 by default
+ */
+void time_event_set_slack(time_event_t * const me, uint32_t slack);
+
+/**
+ * @brief Allow a timer to fire late, with a microsecond value
+ *
+ * The tick back end rounds the slack down to whole ticks.
+ *
+ * @param me Timer to configure
+ * @param slack Allowed lateness in microseconds
+ */
+void time_event_set_slack_us(time_event_t * const me, uint64_t slack);
+
 /**
  * @brief Disarm the specified timer
  *
- * Disarms the timer by settign the timeout value to 0.
+ * Removes the timer from the timing wheel.  Disarming a timer that is not
+ * armed has no effect.
  *
  * @param me Specified timer to disarm
+ * @return true if the timer was armed; false if it was not armed, e.g. because
+ *         a one-shot timer already expired and its event may still be queued
  */
-void time_event_disarm(time_event_t *const me);
+bool time_event_disarm(time_event_t *const me);
 
+/**
+ * @brief Check whether the specified timer is armed
+ *
+ * A one-shot timer stops being armed when it expires, before its event is
+ * dispatched; a periodic timer stays armed until it is disarmed.
+ *
+ * @param me Specified timer
+ * @return true if the timer is armed
+ */
+bool time_event_armed(time_event_t const * const me);
+
+/**
+ * @brief Get the time until the earliest armed time event expires
+ *
+ * Used to bound how long the system may sleep.  With the tick back end timers
+ * in the upper wheel levels are only known to the span of their slot, so the
+ * result can be early but is never late.
+ *
+ * @return Microseconds until the next expiry; 0 if one is due on the next tick
+ *         and UINT64_MAX if no time event is armed
+ */
+uint64_t time_event_next_expiry_us(void);
+
+#if CONFIG_ACTOR_TIME_EVENT_TICKLESS
+/**
+ * @brief Get the number of times the tickless back end has woken up
+ *
+ * @return Number of one-shot timer expirations since boot
+ */
+uint32_t time_event_get_wakeups(void);
+#else
 /**
  * @brief Global function to be called on sys tick interrupt
  *
  * In FreeRTOS, this function would be called in `vApplicationTickHook` so
- * that the registered timers are called every system tick.
+ * that the registered timers are called every system tick.  It must only be
+ * called from interrupt context; expired events are posted with
+ * `actor_post_from_isr` and a single yield is requested at the end.
+ */
+void time_event_tick(void);
+
+/**
+ * @brief Account for ticks that elapsed without a call to time_event_tick
+ *
+ * Used after the tick interrupt was stopped, e.g. during light sleep.  The
+ * next call to time_event_tick processes these ticks before its own, so
+ * timers that expired meanwhile fire late rather than drift.
+ *
+ * @param ticks Number of ticks missed
+ */
+void time_event_add_ticks(uint32_t ticks);
+#endif
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+/**
+ * @brief Start the task that posts expired time events
+ *
+ * With CONFIG_ACTOR_TIME_EVENT_DEFERRED the tick hook only records expired
+ * timers in a lock-free ring and this task posts them at task level.  It
+ * should run at a low priority, but above any actor it serves.
+ *
+ * @param prio Priority of the drain task
+ * @param stack_size Stack size of the drain task
+ */
+void time_event_start_drain(uint8_t prio, uint32_t stack_size);
+
+/**
+ * @brief Get the number of expirations dropped because the ring was full
+ *
+ * @return Number of lost expirations since boot
  */
-void time_event_tick(void);
\ No newline at end of file
+uint32_t time_event_get_overruns(void);
+#endif
\ No newline at end of file
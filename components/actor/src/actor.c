@@ -32,46 +32,42 @@
  */
 
 #include "actor.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+#include "actor_power.h"
+#include "actor_sched.h"
+#include "event_pool.h"
+#include "pubsub.h"
 
+#include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <esp_err.h>
 #include <esp_log.h>
+#include <sdkconfig.h>
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
 #define TAG "actor"
 
-#define MAX_CHILDREN 10
+/** Maximum number of actors with an id */
+#define MAX_ACTORS CONFIG_ACTOR_MAX_ACTORS
+
+/** Largest burst drained by the message loop */
+#define BATCH_MAX CONFIG_ACTOR_BATCH_MAX
+
+_Static_assert(sizeof(actor_envelope_t) == ACTOR_QUEUE_ITEM_SIZE,
+               "ACTOR_QUEUE_ITEM_SIZE does not match actor_envelope_t");
 /*******************************************************************************
  * Type Definitions
  ******************************************************************************/
 
-typedef uint16_t actor_id_t;
-
-typedef struct actor_child_s
-{
-    actor_id_t child_id;
-    actor_t *child;
-} actor_child_t;
-
-/**
- * @brief Definition of actor object.
- *
- * Contents are hidden.  Only contents available to the actor are the ones defined
- * on inheritance of the struct.
- *
- */
-struct actor_s {
-    actor_id_t actor_id;
-    TaskHandle_t main_task;     ///< Main actor task that handles incoming messages
-    QueueHandle_t msg_queue;    ///< Message queue to send messages
-    DispatchHandler dispatch;   ///< Dispatch function for handling messages
-    const actor_t *parent;            ///< Reference to the parent; can be NULL
-    actor_child_t *children;
-    uint8_t child_count;
-    // Private actor parameters after this
-};
+/** Lanes of an actor's mailbox */
+typedef enum {
+    LANE_NORMAL,    ///< Back of the queue, outside the urgent reserve
+    LANE_URGENT,    ///< Front of the queue
+} actor_lane_t;
 
 /*******************************************************************************
  * Function Prototypes
@@ -84,83 +80,1377 @@ struct actor_s {
  */
 static void actor_msgloop(void *pdata);
 
+/**
+ * @brief Take whatever else is queued behind a message and dispatch the burst
+ *
+ * Kept out of line so that only actors with batching enabled carry the
+ * burst buffer on their stack.
+ *
+ * @param me Actor with batch_max above 1
+ * @param first Message already received
+ * @return As actor_dispatch_batch
+ */
+static bool actor_receive_batch(actor_t * const me, actor_envelope_t const * const first)
+    __attribute__((noinline));
+
+/**
+ * @brief Hand a burst to the actor's batch handler
+ *
+ * Kept out of line like actor_receive_batch.
+ *
+ * @param me Actor with a batch handler
+ * @param env Envelopes of the burst, none of them reserved signals
+ * @param count Number of envelopes
+ */
+static void actor_dispatch_burst(actor_t * const me, actor_envelope_t const * const env, uint16_t count)
+    __attribute__((noinline));
+
+/**
+ * @brief Create the task of an actor from its saved start parameters
+ *
+ * @param me Actor with a queue
+ */
+static void actor_spawn(actor_t * const me);
+
+/**
+ * @brief Queue QUIT_SIG for a running actor and refuse later posts
+ *
+ * @param me Actor to stop
+ * @param restart Handle INIT_SIG again instead of terminating
+ * @return As actor_stop
+ */
+static esp_err_t actor_quit(actor_t * const me, bool restart);
+
+/**
+ * @brief Tear down or restart an actor that handled QUIT_SIG
+ *
+ * @param me Actor being dispatched
+ */
+static void actor_terminate(actor_t * const me);
+
+/**
+ * @brief Release every queued message once no post is in progress
+ *
+ * @param me Actor that refuses posts
+ */
+static void actor_quiesce(actor_t * const me);
+
+/**
+ * @brief Release deferred messages and clear coalescing state
+ *
+ * @param me Actor whose queue was drained
+ */
+static void actor_reset(actor_t * const me);
+
+/**
+ * @brief Note the start of a dispatch for idle points and the watchdog
+ *
+ * @param me Dispatching actor
+ * @param msg Message being dispatched; NULL for a burst
+ */
+static void actor_watch_begin(actor_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Note the end of a dispatch for idle points and the watchdog
+ *
+ * @param me Dispatching actor
+ */
+static void actor_watch_end(actor_t * const me);
+
+/**
+ * @brief Queue a message for a running actor
+ *
+ * Posts made while the actor is not running are refused.  Posts in progress
+ * are counted, so that teardown can wait for those that passed the check.
+ *
+ * @param me Actor to receive the message
+ * @param msg Message to post
+ * @param lane Mailbox lane
+ * @param woken NULL from task context; the ISR's woken flag otherwise
+ * @return As actor_post
+ */
+static esp_err_t actor_enqueue(actor_t * const me, actor_msg_t const * const msg, actor_lane_t lane,
+                               BaseType_t * const woken);
+
+/**
+ * @brief Queue a message for an actor, applying coalescing and its overflow policy
+ *
+ * @param me Actor to receive the message
+ * @param msg Message to post
+ * @param lane Mailbox lane
+ * @param woken NULL from task context; the ISR's woken flag otherwise
+ * @return As actor_post
+ */
+static esp_err_t actor_deliver(actor_t * const me, actor_msg_t const * const msg, actor_lane_t lane,
+                               BaseType_t * const woken);
+
+/**
+ * @brief Put an envelope in an actor's queue, making room as the policy allows
+ *
+ * @param me Actor to receive the message
+ * @param env Envelope to queue
+ * @param lane Mailbox lane
+ * @param woken NULL from task context; the ISR's woken flag otherwise
+ * @return ESP_OK, ESP_ERR_NO_MEM or ESP_ERR_TIMEOUT
+ */
+static esp_err_t actor_send(actor_t * const me, actor_envelope_t const * const env, actor_lane_t lane,
+                            BaseType_t * const woken);
+
+/**
+ * @brief Try once to put an envelope in an actor's queue without waiting
+ *
+ * @param me Actor to receive the message
+ * @param env Envelope to queue
+ * @param lane Mailbox lane
+ * @param woken NULL from task context; the ISR's woken flag otherwise
+ * @return pdTRUE if the envelope was queued
+ */
+static BaseType_t actor_queue_send(actor_t * const me, actor_envelope_t const * const env,
+                                   actor_lane_t lane, BaseType_t * const woken);
+
+/**
+ * @brief Discard the oldest normal message of an actor
+ *
+ * @param me Actor whose queue is full
+ * @param woken NULL from task context; the ISR's woken flag otherwise
+ * @return true if a message was discarded
+ */
+static bool actor_drop_oldest(actor_t * const me, BaseType_t * const woken);
+
+/**
+ * @brief Report a refused or discarded message and release it
+ *
+ * @param me Receiving actor
+ * @param msg Message that will not be dispatched
+ */
+static void actor_overflow(actor_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Take one credit from an actor
+ *
+ * @param me Receiving actor
+ * @return true if a credit was available
+ */
+static bool actor_take_credit(actor_t * const me);
+
+/**
+ * @brief Find the coalescing state of a signal
+ *
+ * @param me Actor
+ * @param sig Signal
+ * @return Coalescing state or NULL if the signal is not coalesced
+ */
+static actor_coalesce_t *actor_coalesce_find(actor_t * const me, signal_t sig);
+
+/**
+ * @brief Take the merge count of a message about to be dispatched
+ *
+ * Clears the queued flag so that posts made from now on are queued again.
+ *
+ * @param me Dispatching actor
+ * @param sig Signal of the message
+ * @return Posts merged into the message
+ */
+static uint16_t actor_coalesce_take(actor_t * const me, signal_t sig);
+
+/**
+ * @brief Allocate a zeroed actor object
+ *
+ * @return New actor object or NULL if none is available
+ */
+static actor_t *actor_alloc(void);
+
+/**
+ * @brief Return an actor object if actor_alloc allocated it
+ *
+ * @param me Actor object
+ */
+static void actor_free(actor_t * const me);
+
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 
+/** Constructed actors indexed by actor id */
+static actor_t *l_registry[MAX_ACTORS];
+
+/** Number of actor ids handed out */
+static uint16_t l_num_actors = 0;
+
+/** Ids below l_num_actors released by actor_dtor */
+static uint16_t l_num_free_ids = 0;
+
+/** Protects the registry */
+ACTOR_PORT_LOCK(l_registry_lock);
+
+/** Protects the coalescing state of all actors */
+ACTOR_PORT_LOCK(l_mailbox_lock);
+
+#if CONFIG_ACTOR_STATIC_ALLOCATION
+/** Actor objects handed out by actor_alloc, each starting a cache line */
+static struct {
+    struct actor_s actor;
+} __attribute__((aligned(ACTOR_HOT_SIZE))) l_actor_pool[MAX_ACTORS];
+
+/** Number of objects taken from l_actor_pool */
+static uint16_t l_actor_pool_used = 0;
+
+/** Objects given back by actor_dtor, linked through next_ready */
+static actor_t *l_actor_free = NULL;
+#endif
+
+/** Dispatches in progress on any core, including handlers that are blocked */
+static uint32_t l_dispatches = 0;
+
+/** Message handled by an actor before it terminates or restarts */
+static actor_msg_t const l_quit_msg = { .sig = QUIT_SIG };
+
+/** Initialization message queued for a restarted pooled actor */
+static actor_msg_t const l_init_msg = { .sig = INIT_SIG };
+
 /*******************************************************************************
  * Function Definitions
  ******************************************************************************/
 
 // Described in .h
-void actor_ctor(actor_t const * parent, actor_t **me, DispatchHandler dispatch)
+void actor_ctor(actor_t * parent, actor_t **me, DispatchHandler dispatch)
 {
-    if (*me ==NULL)
+    bool const owned = (*me == NULL);
+    if (owned)
     {
-        *me = (actor_t *)malloc(sizeof(actor_t));
+        *me = actor_alloc();
         if (*me == NULL)
         {
             ESP_LOGE(TAG, "Unable to create actor");
             return;
         }
-        // Clear allocated memory to avoid garbage values
+    }
+    else
+    {
+        // Embedded in the caller's object, whose memory may not be cleared
         memset(*me, 0, sizeof(actor_t));
     }
     (*me)->parent = parent;
     (*me)->dispatch = dispatch;
-    (*me)->child_count = 0;
+    (*me)->core = ACTOR_NO_AFFINITY;
+    (*me)->first_child = NULL;
+    (*me)->next_sibling = NULL;
+    (*me)->batch = NULL;
+    (*me)->batch_max = 1;
+    (*me)->urgent_reserve = 0;
+    (*me)->num_coalesce = 0;
+    (*me)->overflow = ACTOR_OVERFLOW_DROP_NEWEST;
+    (*me)->block_ticks = 0;
+    (*me)->credits = 0;
+    (*me)->on_overflow = NULL;
+    (*me)->deferred = NULL;
+    (*me)->defer_length = 0;
+    (*me)->defer_head = 0;
+    (*me)->defer_count = 0;
+    (*me)->main_task = NULL;
+    (*me)->msg_queue = NULL;
+    (*me)->state = ACTOR_STATE_STOPPED;
+    (*me)->restart = false;
+    (*me)->respawn = false;
+    (*me)->owned = owned;
+    (*me)->posting = 0;
+    (*me)->storage = NULL;
+    (*me)->exit_msg = (actor_exit_t){ .super = { .sig = CHILD_EXIT_SIG }, .child = *me };
+    (*me)->supervisor = NULL;
+    (*me)->watchdog = 0;
+    (*me)->killable = false;
+    (*me)->dispatching = false;
+    (*me)->current = NULL;
+    (*me)->awake = false;
+#if CONFIG_ACTOR_RECORD
+    (*me)->recorded = false;
+#endif
+#if CONFIG_ACTOR_SIZING
+    (*me)->queue_peak = 0;
+#endif
+
+    // Hand out a free actor id and link the actor to its parent
+    ACTOR_PORT_ENTER(&l_registry_lock);
+    actor_id_t id = l_num_actors;
+    if (l_num_free_ids > 0)
+    {
+        // Reuse the id of a destroyed actor
+        id = 0;
+        while (l_registry[id] != NULL)
+        {
+            id++;
+        }
+        l_num_free_ids--;
+    }
+    else if (l_num_actors < MAX_ACTORS)
+    {
+        l_num_actors++;
+    }
+    else
+    {
+        ACTOR_PORT_EXIT(&l_registry_lock);
+        ESP_LOGE(TAG, "Too many actors, raise CONFIG_ACTOR_MAX_ACTORS");
+        actor_free(*me);
+        if (owned)
+        {
+            *me = NULL;
+        }
+        return;
+    }
+    (*me)->actor_id = id;
+    l_registry[id] = *me;
+
+    if (parent != NULL)
+    {
+        actor_t **link = &parent->first_child;
+        while (*link != NULL)
+        {
+            link = &(*link)->next_sibling;
+        }
+        *link = *me;
+    }
+    ACTOR_PORT_EXIT(&l_registry_lock);
 }
 
 // Described in .h
 void actor_start(actor_t *const me, uint8_t prio, uint32_t queue_length, uint32_t stack_size)
 {
     ESP_LOGI(TAG, "Starting actor at %p with dispatch function %p", me, me->dispatch);
-    me->msg_queue = xQueueCreate(queue_length, sizeof(actor_msg_t *));
+    actor_sizing_resize(me, &queue_length, &stack_size);
+    me->pooled = false;
+    me->queue_length = queue_length;
+    me->task_prio = prio;
+    me->stack_size = stack_size;
+    me->storage = NULL;
+    me->msg_queue = xQueueCreate(queue_length, sizeof(actor_envelope_t));
     ESP_LOGI(TAG, "Queue assigned");
 
-    xTaskCreate(actor_msgloop, NULL, stack_size, me, prio, &me->main_task);
+    actor_spawn(me);
     ESP_LOGI(TAG, "Task created");
 }
 
-// Dsecribed in .h
-void actor_post(actor_t *const me, actor_msg_t const * const msg)
+// Described in .h
+void actor_set_batch(actor_t * const me, uint16_t max_batch, BatchHandler batch)
+{
+    assert(max_batch >= 1 && max_batch <= BATCH_MAX);
+
+    me->batch_max = max_batch;
+    me->batch = batch;
+}
+
+// Described in .h
+void actor_start_static(actor_t *const me, uint8_t prio, actor_storage_t const * const storage)
 {
-    xQueueSend(me->msg_queue, msg, 0);
+    assert(storage->stack != NULL);
+
+    ESP_LOGI(TAG, "Starting static actor at %p with dispatch function %p", me, me->dispatch);
+    me->pooled = false;
+    me->queue_length = storage->queue_length;
+    me->task_prio = prio;
+    me->storage = storage;
+    me->msg_queue = xQueueCreateStatic(storage->queue_length, sizeof(actor_envelope_t),
+                                       storage->queue_buffer, storage->queue);
+    actor_spawn(me);
 }
 
-void actor_add_child(actor_t * const me, actor_t type, DispatchHandler dispatch)
+// Described above
+static void actor_spawn(actor_t * const me)
 {
-    if (me->child_count >= MAX_CHILDREN)
+    __atomic_store_n(&me->state, ACTOR_STATE_RUNNING, __ATOMIC_SEQ_CST);
+
+    if (me->storage == NULL)
     {
-        ESP_LOGE(TAG, "Unable to add child.");
-        return;
+        xTaskCreatePinnedToCore(actor_msgloop, NULL, me->stack_size, me, me->task_prio, &me->main_task,
+                                me->core);
+    }
+    else
+    {
+        me->main_task = xTaskCreateStaticPinnedToCore(actor_msgloop, NULL, me->storage->stack_size, me,
+                                                      me->task_prio, me->storage->stack, me->storage->tcb,
+                                                      me->core);
     }
+}
+
+// Described in .h
+esp_err_t actor_stop(actor_t * const me)
+{
+    return actor_quit(me, false);
+}
+
+// Described in .h
+esp_err_t actor_restart(actor_t * const me)
+{
+    return actor_quit(me, true);
+}
+
+// Described in .h
+bool actor_is_running(actor_t const * const me)
+{
+    return __atomic_load_n(&me->state, __ATOMIC_ACQUIRE) == ACTOR_STATE_RUNNING;
+}
 
-    actor_ctor(me, &me->children[me->child_count].child, dispatch);
+// Described in .h
+bool actor_is_stopped(actor_t const * const me)
+{
+    return __atomic_load_n(&me->state, __ATOMIC_ACQUIRE) == ACTOR_STATE_STOPPED;
 }
 
+// Described in .h
+void actor_dtor(actor_t * const me)
+{
+    // The task or worker touches the actor until it reports it stopped
+    while (!actor_is_stopped(me))
+    {
+        vTaskDelay(1);
+    }
+
+    actor_unsubscribe_all(me);
+
+    ACTOR_PORT_ENTER(&l_registry_lock);
+    l_registry[me->actor_id] = NULL;
+    l_num_free_ids++;
+
+    if (me->parent != NULL)
+    {
+        actor_t **link = &me->parent->first_child;
+        while (*link != me)
+        {
+            link = &(*link)->next_sibling;
+        }
+        *link = me->next_sibling;
+    }
+
+    actor_t *child = me->first_child;
+    while (child != NULL)
+    {
+        actor_t * const next = child->next_sibling;
+        child->parent = NULL;
+        child->next_sibling = NULL;
+        child = next;
+    }
+    ACTOR_PORT_EXIT(&l_registry_lock);
+
+    actor_free(me);
+}
 
 // Described above
-static void actor_msgloop(void *pdata)
+static esp_err_t actor_quit(actor_t * const me, bool restart)
 {
-    actor_t *me = (actor_t *)pdata;
+    ACTOR_PORT_ENTER(&l_registry_lock);
+    bool const running = (me->state == ACTOR_STATE_RUNNING);
+    if (running)
+    {
+        me->restart = restart;
+        __atomic_store_n(&me->state, ACTOR_STATE_STOPPING, __ATOMIC_SEQ_CST);
+    }
+    ACTOR_PORT_EXIT(&l_registry_lock);
 
-    ESP_LOGI(TAG, "Starting message loop with actor at %p with dispatch at %p ", me, me->dispatch);
+    if (!running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    // Initialize the actor object
-    static actor_msg_t const initMsg = {INIT_SIG};
+    // Bypasses the state check that now refuses posts
+    esp_err_t const err = actor_deliver(me, &l_quit_msg, LANE_URGENT, NULL);
+    if (err != ESP_OK)
+    {
+        __atomic_store_n(&me->state, ACTOR_STATE_RUNNING, __ATOMIC_SEQ_CST);
+    }
 
-    (me->dispatch)(me, &initMsg);
-    ESP_LOGI(TAG, "Message dispatched");
+    return err;
+}
+
+// Described above
+static void actor_terminate(actor_t * const me)
+{
+    actor_quiesce(me);
+    actor_reset(me);
+    if (me->pooled)
+    {
+        actor_sched_drained(me);
+    }
+
+    // A restarted actor starts without a vote, like a new one
+    actor_power_keep_awake(me, false);
+
+    if (me->restart)
+    {
+        me->restart = false;
+        __atomic_store_n(&me->state, ACTOR_STATE_RUNNING, __ATOMIC_SEQ_CST);
+        if (me->pooled)
+        {
+            // The task message loop handles INIT_SIG itself
+            actor_deliver(me, &l_init_msg, LANE_URGENT, NULL);
+        }
+        return;
+    }
+
+    actor_unsubscribe_all(me);
+    vQueueDelete(me->msg_queue);
+    me->msg_queue = NULL;
+
+    // The message loop or the worker marks the actor stopped once done with it
+    actor_notify_exit(me, ACTOR_EXIT_NORMAL, NULL);
+}
+
+// Described above
+static void actor_quiesce(actor_t * const me)
+{
+    bool idle = false;
 
+    // Draining makes room for posts blocked on a full queue
     while (1)
     {
-        // Begin receiving and handling messages
-        // Wait forever for a message.
-        actor_msg_t msg;
-        esp_err_t err = xQueueReceive(me->msg_queue, &msg, portMAX_DELAY);
+        actor_envelope_t env;
+        while (xQueueReceive(me->msg_queue, &env, 0) == pdTRUE)
+        {
+            actor_channel_discarded(actor_env_msg(&env));
+            event_gc(actor_env_msg(&env));
+        }
+        if (idle)
+        {
+            break;
+        }
+
+        // One more pass for a post that completed after the drain
+        idle = (__atomic_load_n(&me->posting, __ATOMIC_SEQ_CST) == 0);
+        if (!idle)
+        {
+            vTaskDelay(1);
+        }
+    }
+}
+
+// Described above
+static void actor_reset(actor_t * const me)
+{
+    while (me->defer_count > 0)
+    {
+        actor_channel_discarded(me->deferred[me->defer_head]);
+        event_gc(me->deferred[me->defer_head]);
+        me->defer_head = (me->defer_head + 1) % me->defer_length;
+        me->defer_count--;
+    }
+    me->defer_head = 0;
+
+    ACTOR_PORT_ENTER(&l_mailbox_lock);
+    for (uint8_t i = 0; i < me->num_coalesce; i++)
+    {
+        me->coalesce[i].queued = false;
+        me->coalesce[i].merged = 0;
+    }
+    ACTOR_PORT_EXIT(&l_mailbox_lock);
+}
+
+// Described in actor_priv.h
+void actor_kill(actor_t * const me)
+{
+    assert(!me->pooled);
+
+    __atomic_store_n(&me->state, ACTOR_STATE_STOPPING, __ATOMIC_SEQ_CST);
+    vTaskDelete(me->main_task);
+    me->main_task = NULL;
+
+    if (me->dispatching)
+    {
+        // Its dispatch never returns to release the message or end the count
+        if (me->current != NULL)
+        {
+            actor_channel_discarded(me->current);
+            event_gc(me->current);
+        }
+        __atomic_sub_fetch(&l_dispatches, 1, __ATOMIC_SEQ_CST);
+    }
+    me->dispatching = false;
+    me->current = NULL;
+    me->restart = false;
+
+    actor_quiesce(me);
+    actor_reset(me);
+    me->respawn = true;
+}
+
+// Described in actor_priv.h
+void actor_respawn(actor_t * const me)
+{
+    me->respawn = false;
+    actor_spawn(me);
+}
+
+// Described in actor_priv.h
+void actor_notify_exit(actor_t * const me, actor_exit_reason_t reason, BaseType_t * const woken)
+{
+    me->exit_msg.reason = (uint8_t)reason;
+
+    if (me->parent == NULL)
+    {
+        return;
+    }
+
+    if (woken != NULL)
+    {
+        actor_post_urgent_from_isr(me->parent, &me->exit_msg.super, woken);
+    }
+    else
+    {
+        actor_post_urgent(me->parent, &me->exit_msg.super);
+    }
+}
+
+// Described in .h
+void actor_set_affinity(actor_t * const me, BaseType_t core)
+{
+    assert(core == ACTOR_NO_AFFINITY || (core >= 0 && core < ACTOR_PORT_NUM_CORES));
 
-        (me->dispatch)(me, &msg);
+    me->core = core;
+}
+
+// Described in .h
+void actor_topology_start(actor_node_t const * const nodes, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        // Parents are listed first, so their handles are already valid
+        actor_t * const parent = (nodes[i].parent != NULL) ? *nodes[i].parent : NULL;
+        assert(nodes[i].parent == NULL || parent != NULL);
+        actor_ctor(parent, nodes[i].me, nodes[i].dispatch);
+        actor_set_affinity(*nodes[i].me, nodes[i].core);
     }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        actor_node_t const * const node = &nodes[i];
+        if (node->storage->stack != NULL)
+        {
+            actor_start_static(*node->me, node->prio, node->storage);
+        }
+        else
+        {
+            actor_start_pooled_static(*node->me, node->prio, node->storage, 0);
+        }
+    }
+}
+
+// Dsecribed in .h
+esp_err_t actor_post(actor_t *const me, actor_msg_t const * const msg)
+{
+    return actor_enqueue(me, msg, LANE_NORMAL, NULL);
+}
+
+// Described in .h
+esp_err_t actor_post_from_isr(actor_t *const me, actor_msg_t const * const msg, BaseType_t * const woken)
+{
+    return actor_enqueue(me, msg, LANE_NORMAL, woken);
+}
+
+// Described in .h
+esp_err_t actor_post_urgent(actor_t *const me, actor_msg_t const * const msg)
+{
+    return actor_enqueue(me, msg, LANE_URGENT, NULL);
+}
+
+// Described in .h
+esp_err_t actor_post_urgent_from_isr(actor_t *const me, actor_msg_t const * const msg,
+                                     BaseType_t * const woken)
+{
+    return actor_enqueue(me, msg, LANE_URGENT, woken);
+}
+
+// Described in .h
+void actor_set_urgent_reserve(actor_t * const me, uint8_t reserve)
+{
+    me->urgent_reserve = reserve;
+}
+
+// Described in .h
+void actor_defer_init(actor_t * const me, actor_msg_t const ** const storage, uint8_t length)
+{
+    me->deferred = storage;
+    me->defer_length = length;
+    me->defer_head = 0;
+    me->defer_count = 0;
+}
+
+// Described in .h
+esp_err_t actor_defer(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (me->deferred == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (me->defer_count == me->defer_length)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Outlive the release that follows the current dispatch
+    event_ref(msg);
+    me->deferred[(me->defer_head + me->defer_count) % me->defer_length] = msg;
+    me->defer_count++;
+
+    return ESP_OK;
+}
+
+// Described in .h
+bool actor_recall(actor_t * const me)
+{
+    if (me->defer_count == 0)
+    {
+        return false;
+    }
+
+    actor_msg_t const * const msg = me->deferred[me->defer_head];
+    if (actor_post_urgent(me, msg) != ESP_OK)
+    {
+        return false;
+    }
+
+    // The queued reference replaces the one taken by actor_defer
+    me->defer_head = (me->defer_head + 1) % me->defer_length;
+    me->defer_count--;
+    event_gc(msg);
+
+    return true;
+}
+
+// Described in .h
+void actor_set_overflow(actor_t * const me, actor_overflow_t policy, uint32_t limit,
+                        OverflowHandler handler)
+{
+    me->overflow = (uint8_t)policy;
+    me->block_ticks = (policy == ACTOR_OVERFLOW_BLOCK) ? limit : 0;
+    me->on_overflow = handler;
+    __atomic_store_n(&me->credits, (policy == ACTOR_OVERFLOW_CREDITS) ? limit : 0, __ATOMIC_RELEASE);
+}
+
+// Described in .h
+void actor_grant_credits(actor_t * const me, uint32_t credits)
+{
+    __atomic_add_fetch(&me->credits, credits, __ATOMIC_RELEASE);
+}
+
+// Described in .h
+uint32_t actor_get_credits(actor_t const * const me)
+{
+    return __atomic_load_n(&me->credits, __ATOMIC_ACQUIRE);
+}
+
+// Described in .h
+void actor_coalesce(actor_t * const me, signal_t sig)
+{
+    assert(me->num_coalesce < CONFIG_ACTOR_COALESCE_MAX);
+
+    ACTOR_PORT_ENTER(&l_mailbox_lock);
+    actor_coalesce_t * const slot = &me->coalesce[me->num_coalesce];
+    slot->sig = sig;
+    slot->queued = false;
+    slot->merged = 0;
+    me->num_coalesce++;
+    ACTOR_PORT_EXIT(&l_mailbox_lock);
+}
+
+// Described in .h
+uint16_t actor_get_coalesced(actor_t const * const me)
+{
+    return me->merged;
+}
+
+// Described in .h
+void actor_add_child(actor_t * const me, actor_t **child, DispatchHandler dispatch)
+{
+    actor_ctor(me, child, dispatch);
+}
+
+// Described in .h
+BaseType_t actor_get_core(actor_t const * const me)
+{
+    return me->pooled ? actor_worker_core(me->home) : me->core;
+}
+
+// Described in .h
+actor_t *actor_get_parent(actor_t const * const me)
+{
+    return me->parent;
+}
+
+// Described in .h
+actor_t *actor_get_first_child(actor_t const * const me)
+{
+    return me->first_child;
+}
+
+// Described in .h
+actor_t *actor_get_next_sibling(actor_t const * const me)
+{
+    return me->next_sibling;
+}
+
+// Described in .h
+uint16_t actor_get_id(actor_t const * const me)
+{
+    return me->actor_id;
+}
+
+// Described in .h
+actor_t *actor_from_id(uint16_t id)
+{
+    return actor_registry_get(id);
+}
+
+// Described in .h
+uint16_t actor_get_id_limit(void)
+{
+    return __atomic_load_n(&l_num_actors, __ATOMIC_RELAXED);
+}
+
+// Described in actor_priv.h
+actor_t *actor_registry_get(actor_id_t id)
+{
+    return (id < l_num_actors) ? l_registry[id] : NULL;
+}
+
+// Described in actor_priv.h
+bool actor_registry_busy(void)
+{
+    bool busy = (__atomic_load_n(&l_dispatches, __ATOMIC_SEQ_CST) > 0);
+
+    // Queues are only deleted after the state left RUNNING under this lock
+    ACTOR_PORT_ENTER(&l_registry_lock);
+    for (actor_id_t id = 0; id < l_num_actors && !busy; id++)
+    {
+        actor_t * const me = l_registry[id];
+        if (me == NULL)
+        {
+            continue;
+        }
+
+        uint8_t const state = __atomic_load_n(&me->state, __ATOMIC_SEQ_CST);
+        busy = (state == ACTOR_STATE_STOPPING) ||
+               (state == ACTOR_STATE_RUNNING && uxQueueMessagesWaiting(me->msg_queue) > 0);
+    }
+    ACTOR_PORT_EXIT(&l_registry_lock);
+
+    return busy;
+}
+
+// Described in actor_priv.h
+bool actor_dispatch_one(actor_t * const me, actor_envelope_t const * const env)
+{
+    actor_msg_t const * const msg = actor_env_msg(env);
+    signal_t const sig = msg->sig;
+
+#if CONFIG_ACTOR_STATS
+    actor_t * const prev = actor_stats_enter(me);
+    uint32_t const start = ACTOR_PORT_CYCLES();
+    actor_stats_latency(me, ACTOR_PORT_TIME_US() - env->stamp);
+#endif
+
+    me->merged = actor_coalesce_take(me, sig);
+    actor_trace_record(ACTOR_TRACE_DISPATCH_BEGIN, me->actor_id, sig);
+    actor_watch_begin(me, msg);
+    if (sig >= USER_SIG || me->supervisor == NULL || !actor_supervisor_handle(me, msg))
+    {
+        (me->dispatch)(me, msg);
+    }
+    actor_watch_end(me);
+    actor_trace_record(ACTOR_TRACE_DISPATCH_END, me->actor_id, sig);
+
+#if CONFIG_ACTOR_STATS
+    actor_stats_dispatched(me, sig, ACTOR_PORT_CYCLES() - start);
+    actor_stats_leave(prev);
+#endif
+
+    // Release the reference taken when the message was posted.  CHILD_EXIT_SIG
+    // is part of the child, which the handler may have destroyed.
+    if (sig != CHILD_EXIT_SIG)
+    {
+        event_gc(msg);
+    }
+
+    if (sig == QUIT_SIG && me->state == ACTOR_STATE_STOPPING)
+    {
+        actor_terminate(me);
+        return false;
+    }
+
+    return true;
+}
+
+// Described in actor_priv.h
+bool actor_dispatch_batch(actor_t * const me, actor_envelope_t const * const env, uint16_t count)
+{
+    bool reserved = false;
+    for (uint16_t i = 0; i < count && me->batch != NULL; i++)
+    {
+        reserved |= (actor_env_msg(&env[i])->sig < USER_SIG);
+    }
+
+    if (me->batch == NULL || reserved)
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if (!actor_dispatch_one(me, &env[i]))
+            {
+                // Queued before QUIT_SIG took effect; drained like the rest
+                for (i++; i < count; i++)
+                {
+                    event_gc(actor_env_msg(&env[i]));
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    actor_dispatch_burst(me, env, count);
+
+    return true;
+}
+
+// Described above
+static void actor_dispatch_burst(actor_t * const me, actor_envelope_t const * const env, uint16_t count)
+{
+    actor_msg_t const *msgs[BATCH_MAX];
+    uint16_t merged = 0;
+
+#if CONFIG_ACTOR_STATS
+    actor_t * const prev = actor_stats_enter(me);
+    uint32_t const start = ACTOR_PORT_CYCLES();
+    uint32_t const now = ACTOR_PORT_TIME_US();
+#endif
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        msgs[i] = actor_env_msg(&env[i]);
+        merged += actor_coalesce_take(me, msgs[i]->sig);
+#if CONFIG_ACTOR_STATS
+        actor_stats_latency(me, now - env[i].stamp);
+#endif
+    }
+
+    me->merged = merged;
+    actor_trace_record(ACTOR_TRACE_DISPATCH_BEGIN, me->actor_id, msgs[0]->sig);
+    actor_watch_begin(me, NULL);
+    (me->batch)(me, msgs, count);
+    actor_watch_end(me);
+    actor_trace_record(ACTOR_TRACE_DISPATCH_END, me->actor_id, msgs[0]->sig);
+
+#if CONFIG_ACTOR_STATS
+    // Share the cost of the burst evenly between its messages
+    uint32_t const cycles = (ACTOR_PORT_CYCLES() - start) / count;
+#endif
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+#if CONFIG_ACTOR_STATS
+        actor_stats_dispatched(me, msgs[i]->sig, cycles);
+#endif
+        event_gc(msgs[i]);
+    }
+
+#if CONFIG_ACTOR_STATS
+    actor_stats_leave(prev);
+#endif
+}
+
+// Described above
+static void actor_watch_begin(actor_t * const me, actor_msg_t const * const msg)
+{
+    __atomic_add_fetch(&l_dispatches, 1, __ATOMIC_SEQ_CST);
+    if (me->watchdog != 0)
+    {
+        me->current = msg;
+        me->dispatch_start = xTaskGetTickCount();
+        __atomic_store_n(&me->dispatching, true, __ATOMIC_RELEASE);
+    }
+}
+
+// Described above
+static void actor_watch_end(actor_t * const me)
+{
+    if (me->watchdog != 0)
+    {
+        __atomic_store_n(&me->dispatching, false, __ATOMIC_RELEASE);
+    }
+    __atomic_sub_fetch(&l_dispatches, 1, __ATOMIC_SEQ_CST);
+}
+
+// Described above
+static esp_err_t actor_enqueue(actor_t * const me, actor_msg_t const * const msg, actor_lane_t lane,
+                               BaseType_t * const woken)
+{
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+
+    __atomic_add_fetch(&me->posting, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&me->state, __ATOMIC_SEQ_CST) == ACTOR_STATE_RUNNING)
+    {
+        err = actor_deliver(me, msg, lane, woken);
+    }
+    else
+    {
+        // Released like any refused post
+        event_ref(msg);
+        event_gc(msg);
+    }
+    __atomic_sub_fetch(&me->posting, 1, __ATOMIC_SEQ_CST);
+
+    return err;
+}
+
+// Described above
+static esp_err_t actor_deliver(actor_t * const me, actor_msg_t const * const msg, actor_lane_t lane,
+                               BaseType_t * const woken)
+{
+    actor_envelope_t env = { .msg = msg };
+    if (lane == LANE_URGENT)
+    {
+        env.msg = (actor_msg_t const *)((uintptr_t)msg | ACTOR_ENV_URGENT);
+    }
+    actor_stats_stamp(&env);
+
+    // The queued reference keeps pooled messages alive until dispatch
+    event_ref(msg);
+
+    // Credits pace normal traffic only; urgent messages are control traffic
+    bool const credited = (lane == LANE_NORMAL && me->overflow == ACTOR_OVERFLOW_CREDITS);
+    if (credited && !actor_take_credit(me))
+    {
+        actor_overflow(me, msg);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Merged posts are recorded too; the message may be freed once merged or queued
+    actor_record_capture_t capture;
+    actor_record_capture(me, msg, lane == LANE_URGENT, &capture);
+
+    // Merge into a queued message with the same signal
+    actor_coalesce_t * const slot = actor_coalesce_find(me, msg->sig);
+    if (slot != NULL)
+    {
+        ACTOR_PORT_ENTER(&l_mailbox_lock);
+        bool const merged = slot->queued;
+        if (merged)
+        {
+            slot->merged++;
+        }
+        slot->queued = true;
+        ACTOR_PORT_EXIT(&l_mailbox_lock);
+
+        if (merged)
+        {
+            if (credited)
+            {
+                actor_grant_credits(me, 1);
+            }
+            actor_record_commit(me, &capture);
+            event_gc(msg);
+            return ESP_OK;
+        }
+    }
+
+    actor_stats_posting(me, woken != NULL);
+    actor_sizing_posting(me, woken != NULL);
+    // Before queuing, so the post never appears after the dispatch it caused
+    actor_trace_record(ACTOR_TRACE_POST, me->actor_id, msg->sig);
+
+    esp_err_t const err = actor_send(me, &env, lane, woken);
+    if (err != ESP_OK)
+    {
+        if (slot != NULL)
+        {
+            ACTOR_PORT_ENTER(&l_mailbox_lock);
+            slot->queued = false;
+            ACTOR_PORT_EXIT(&l_mailbox_lock);
+        }
+        if (credited)
+        {
+            actor_grant_credits(me, 1);
+        }
+        actor_overflow(me, msg);
+        return err;
+    }
+
+    actor_stats_posted(me);
+    actor_stats_sender(me, woken != NULL);
+    actor_record_commit(me, &capture);
+    if (me->pooled)
+    {
+        actor_sched_ready(me, woken);
+    }
+
+    return ESP_OK;
+}
+
+// Described above
+static esp_err_t actor_send(actor_t * const me, actor_envelope_t const * const env, actor_lane_t lane,
+                            BaseType_t * const woken)
+{
+    if (me->overflow == ACTOR_OVERFLOW_BLOCK && woken == NULL)
+    {
+        BaseType_t const sent = (lane == LANE_URGENT)
+                                    ? xQueueSendToFront(me->msg_queue, env, me->block_ticks)
+                                    : xQueueSend(me->msg_queue, env, me->block_ticks);
+        return (sent == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+    }
+
+    while (1)
+    {
+        // Normal messages leave the reserved slots to the urgent lane
+        bool const room = lane == LANE_URGENT || me->urgent_reserve == 0 ||
+                          (uxQueueMessagesWaitingFromISR(me->msg_queue) + me->urgent_reserve <
+                           me->queue_length);
+        if (room && actor_queue_send(me, env, lane, woken) == pdTRUE)
+        {
+            return ESP_OK;
+        }
+
+        if (me->overflow != ACTOR_OVERFLOW_DROP_OLDEST || !actor_drop_oldest(me, woken))
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+}
+
+// Described above
+static BaseType_t actor_queue_send(actor_t * const me, actor_envelope_t const * const env,
+                                   actor_lane_t lane, BaseType_t * const woken)
+{
+    if (lane == LANE_URGENT && me->overflow == ACTOR_OVERFLOW_DROP_OLDEST)
+    {
+        // Serialized with actor_drop_oldest, which relies on a normal message
+        // at the head meaning there is no urgent one behind it
+        BaseType_t task_woken = pdFALSE;
+        ACTOR_PORT_ENTER(&l_mailbox_lock);
+        BaseType_t const sent =
+            xQueueSendToFrontFromISR(me->msg_queue, env, (woken != NULL) ? woken : &task_woken);
+        ACTOR_PORT_EXIT(&l_mailbox_lock);
+        if (task_woken == pdTRUE)
+        {
+            taskYIELD();
+        }
+        return sent;
+    }
+
+    if (woken == NULL)
+    {
+        return (lane == LANE_URGENT) ? xQueueSendToFront(me->msg_queue, env, 0)
+                                     : xQueueSend(me->msg_queue, env, 0);
+    }
+
+    return (lane == LANE_URGENT) ? xQueueSendToFrontFromISR(me->msg_queue, env, woken)
+                                 : xQueueSendFromISR(me->msg_queue, env, woken);
+}
+
+// Described above
+static bool actor_drop_oldest(actor_t * const me, BaseType_t * const woken)
+{
+    actor_envelope_t old;
+    BaseType_t got = pdFALSE;
+    BaseType_t task_woken = pdFALSE;
+
+    // Urgent messages are queued at the front, so the head is only normal when
+    // none is queued.  Urgent posts take the lock too, so none can slip in
+    // between the check and the removal; the consumer only takes messages out.
+    ACTOR_PORT_ENTER(&l_mailbox_lock);
+    if (xQueuePeekFromISR(me->msg_queue, &old) == pdTRUE && ((uintptr_t)old.msg & ACTOR_ENV_URGENT) == 0)
+    {
+        got = xQueueReceiveFromISR(me->msg_queue, &old, (woken != NULL) ? woken : &task_woken);
+    }
+    ACTOR_PORT_EXIT(&l_mailbox_lock);
+    if (task_woken == pdTRUE)
+    {
+        taskYIELD();
+    }
+
+    if (got != pdTRUE)
+    {
+        // Empty, or only urgent messages, which are never discarded
+        return false;
+    }
+
+    actor_msg_t const * const msg = actor_env_msg(&old);
+    actor_coalesce_take(me, msg->sig);
+    actor_overflow(me, msg);
+
+    return true;
+}
+
+// Described above
+static void actor_overflow(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (me->on_overflow != NULL)
+    {
+        (me->on_overflow)(me, msg);
+    }
+
+    actor_channel_discarded(msg);
+    actor_stats_dropped(me);
+    actor_trace_record(ACTOR_TRACE_DROP, me->actor_id, msg->sig);
+    event_gc(msg);
+}
+
+// Described above
+static bool actor_take_credit(actor_t * const me)
+{
+    uint32_t credits = __atomic_load_n(&me->credits, __ATOMIC_RELAXED);
+
+    do
+    {
+        if (credits == 0)
+        {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&me->credits, &credits, credits - 1, true,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    return true;
+}
+
+// Described above
+static actor_coalesce_t *actor_coalesce_find(actor_t * const me, signal_t sig)
+{
+    for (uint8_t i = 0; i < me->num_coalesce; i++)
+    {
+        if (me->coalesce[i].sig == sig)
+        {
+            return &me->coalesce[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Described above
+static uint16_t actor_coalesce_take(actor_t * const me, signal_t sig)
+{
+    actor_coalesce_t * const slot = actor_coalesce_find(me, sig);
+    uint16_t merged = 0;
+
+    if (slot != NULL)
+    {
+        ACTOR_PORT_ENTER(&l_mailbox_lock);
+        merged = slot->merged;
+        slot->merged = 0;
+        slot->queued = false;
+        ACTOR_PORT_EXIT(&l_mailbox_lock);
+    }
+
+    return merged;
+}
+
+// Described above
+static actor_t *actor_alloc(void)
+{
+#if CONFIG_ACTOR_STATIC_ALLOCATION
+    actor_t *me = NULL;
+
+    ACTOR_PORT_ENTER(&l_registry_lock);
+    if (l_actor_free != NULL)
+    {
+        me = l_actor_free;
+        l_actor_free = me->next_ready;
+    }
+    else if (l_actor_pool_used < MAX_ACTORS)
+    {
+        me = &l_actor_pool[l_actor_pool_used++].actor;
+    }
+    ACTOR_PORT_EXIT(&l_registry_lock);
+
+    if (me != NULL)
+    {
+        // Objects given back keep the values of their previous actor
+        memset(me, 0, sizeof(actor_t));
+    }
+
+    return me;
+#else
+    actor_t * const me = (actor_t *)malloc(sizeof(actor_t));
+    if (me != NULL)
+    {
+        // Clear allocated memory to avoid garbage values
+        memset(me, 0, sizeof(actor_t));
+    }
+
+    return me;
+#endif
+}
+
+// Described above
+static void actor_free(actor_t * const me)
+{
+    if (!me->owned)
+    {
+        return;
+    }
+
+#if CONFIG_ACTOR_STATIC_ALLOCATION
+    ACTOR_PORT_ENTER(&l_registry_lock);
+    me->next_ready = l_actor_free;
+    l_actor_free = me;
+    ACTOR_PORT_EXIT(&l_registry_lock);
+#else
+    free(me);
+#endif
+}
+
+// Described above
+static void actor_msgloop(void *pdata)
+{
+    actor_t *me = (actor_t *)pdata;
+
+    ESP_LOGI(TAG, "Starting message loop with actor at %p with dispatch at %p ", me, me->dispatch);
+
+    // Initialize the actor object
+    static actor_msg_t const initMsg = {INIT_SIG};
+
+    (me->dispatch)(me, &initMsg);
+    ESP_LOGI(TAG, "Message dispatched");
+
+    while (1)
+    {
+        // Begin receiving and handling messages
+        // Wait forever for a message.
+        actor_envelope_t env;
+        if (xQueueReceive(me->msg_queue, &env, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+
+        bool const running = (me->batch_max > 1) ? actor_receive_batch(me, &env)
+                                                  : actor_dispatch_batch(me, &env, 1);
+        if (running)
+        {
+            continue;
+        }
+
+        if (me->msg_queue == NULL)
+        {
+            break;
+        }
+
+        // Restarted on the same task and queue
+        (me->dispatch)(me, &initMsg);
+    }
+
+    // The actor belongs to its owner from here on
+    me->main_task = NULL;
+    __atomic_store_n(&me->state, ACTOR_STATE_STOPPED, __ATOMIC_SEQ_CST);
+    vTaskDelete(NULL);
+}
+
+// Described above
+static bool actor_receive_batch(actor_t * const me, actor_envelope_t const * const first)
+{
+    actor_envelope_t env[BATCH_MAX];
+    env[0] = *first;
+
+    // Take whatever else is already queued without blocking again
+    uint16_t count = 1;
+    while (count < me->batch_max && xQueueReceive(me->msg_queue, &env[count], 0) == pdTRUE)
+    {
+        count++;
+    }
+
+    return actor_dispatch_batch(me, env, count);
 }
 
@@ -0,0 +1,227 @@
+/**
+ * @file actor_channel.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Zero-copy byte channels streaming into an actor
+ * @version 0.1
+ * @date 2025-01-13
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_channel.h"
+#include "actor_priv.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Publish committed bytes and notify the consumer if it is not already
+ *
+ * @param me Channel
+ * @param len Bytes committed
+ * @param woken NULL from a task; the woken flag of the interrupt otherwise
+ * @return ESP_OK, or the error of posting the notification
+ */
+static esp_err_t actor_channel_publish(actor_channel_t * const me, size_t len, BaseType_t * const woken);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Constructed channels, to recognize their notifications when discarded */
+static actor_channel_t *l_channels = NULL;
+
+/** Protects the list of channels */
+ACTOR_PORT_LOCK(l_channel_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_channel_ctor(actor_channel_t * const me, uint8_t * const buffer, uint32_t size, actor_t * const consumer,
+                        signal_t sig)
+{
+    assert(size != 0 && (size & (size - 1)) == 0);
+
+    me->super.sig = sig;
+    me->super.pool_id = 0;
+    me->super.ref_count = 0;
+    me->consumer = consumer;
+    me->buffer = buffer;
+    me->size = size;
+    me->head = 0;
+    me->tail = 0;
+    me->pending = false;
+    me->notifications = 0;
+    me->stalls = 0;
+
+    ACTOR_PORT_ENTER(&l_channel_lock);
+    actor_channel_t *c = l_channels;
+    while (c != NULL && c != me)
+    {
+        c = c->next;
+    }
+    if (c == NULL)
+    {
+        me->next = l_channels;
+        l_channels = me;
+    }
+    ACTOR_PORT_EXIT(&l_channel_lock);
+}
+
+// Described in .h
+size_t actor_channel_acquire(actor_channel_t * const me, uint8_t **data)
+{
+    uint32_t const head = me->head;
+    uint32_t const tail = __atomic_load_n(&me->tail, __ATOMIC_ACQUIRE);
+    uint32_t const offset = head & (me->size - 1);
+    uint32_t const free = me->size - (head - tail);
+    uint32_t const to_end = me->size - offset;
+
+    if (free == 0)
+    {
+        me->stalls++;
+    }
+    *data = &me->buffer[offset];
+
+    return (free < to_end) ? free : to_end;
+}
+
+// Described in .h
+esp_err_t actor_channel_commit(actor_channel_t * const me, size_t len)
+{
+    return actor_channel_publish(me, len, NULL);
+}
+
+// Described in .h
+esp_err_t actor_channel_commit_from_isr(actor_channel_t * const me, size_t len, BaseType_t * const woken)
+{
+    return actor_channel_publish(me, len, woken);
+}
+
+// Described in .h
+size_t actor_channel_write(actor_channel_t * const me, void const *data, size_t len, BaseType_t * const woken)
+{
+    uint8_t const *src = data;
+    size_t written = 0;
+
+    // At most two spans: up to the end of the ring, then from its start
+    for (uint8_t i = 0; i < 2 && written < len; i++)
+    {
+        uint8_t *dst = NULL;
+        size_t n = actor_channel_acquire(me, &dst);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n > len - written)
+        {
+            n = len - written;
+        }
+        memcpy(dst, src + written, n);
+        written += n;
+        actor_channel_publish(me, n, woken);
+    }
+
+    return written;
+}
+
+// Described in .h
+size_t actor_channel_peek(actor_channel_t * const me, actor_channel_span_t * const span)
+{
+    // Cleared before looking, so a commit racing with the read notifies again
+    __atomic_store_n(&me->pending, false, __ATOMIC_SEQ_CST);
+
+    uint32_t const tail = me->tail;
+    uint32_t const head = __atomic_load_n(&me->head, __ATOMIC_ACQUIRE);
+    uint32_t const offset = tail & (me->size - 1);
+    uint32_t const used = head - tail;
+    uint32_t const to_end = me->size - offset;
+
+    span->data[0] = &me->buffer[offset];
+    span->len[0] = (used < to_end) ? used : to_end;
+    span->data[1] = me->buffer;
+    span->len[1] = used - span->len[0];
+
+    return used;
+}
+
+// Described in .h
+void actor_channel_release(actor_channel_t * const me, size_t len)
+{
+    assert(len <= me->head - me->tail);
+
+    __atomic_store_n(&me->tail, me->tail + (uint32_t)len, __ATOMIC_RELEASE);
+}
+
+// Described in actor_priv.h
+void actor_channel_discarded(actor_msg_t const * const msg)
+{
+    if (msg->pool_id != 0)
+    {
+        // Channels are static messages
+        return;
+    }
+
+    ACTOR_PORT_ENTER(&l_channel_lock);
+    for (actor_channel_t *c = l_channels; c != NULL; c = c->next)
+    {
+        if (&c->super == msg)
+        {
+            __atomic_store_n(&c->pending, false, __ATOMIC_SEQ_CST);
+            break;
+        }
+    }
+    ACTOR_PORT_EXIT(&l_channel_lock);
+}
+
+// Described above
+static esp_err_t actor_channel_publish(actor_channel_t * const me, size_t len, BaseType_t * const woken)
+{
+    assert(len <= me->size - (me->head - __atomic_load_n(&me->tail, __ATOMIC_ACQUIRE)));
+
+    __atomic_store_n(&me->head, me->head + (uint32_t)len, __ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&me->pending, true, __ATOMIC_SEQ_CST))
+    {
+        return ESP_OK;
+    }
+
+    me->notifications++;
+    esp_err_t const err = (woken != NULL) ? actor_post_from_isr(me->consumer, &me->super, woken)
+                                          : actor_post(me->consumer, &me->super);
+    if (err != ESP_OK)
+    {
+        // Let the next commit try again
+        __atomic_store_n(&me->pending, false, __ATOMIC_SEQ_CST);
+    }
+
+    return err;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file actor_port.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Port layer for the actor framework
+ * @version 0.1
+ * @date 2024-10-14
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_cpu.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_PORT_POSIX
+/*
+ * FreeRTOS POSIX port used by the host build.  It simulates a single core and
+ * runs the tick hook with the critical nesting already raised, so the plain
+ * task-level critical section is safe from both contexts.
+ */
+
+/** Declare a lock protecting framework state */
+#define ACTOR_PORT_LOCK(name_) static uint8_t name_ __attribute__((unused))
+
+/** Enter a critical section; usable from both task and ISR context */
+#define ACTOR_PORT_ENTER(lock_) do { (void)(lock_); taskENTER_CRITICAL(); } while (0)
+
+/** Exit a critical section entered with ACTOR_PORT_ENTER */
+#define ACTOR_PORT_EXIT(lock_) do { (void)(lock_); taskEXIT_CRITICAL(); } while (0)
+
+/** Mask interrupts on the current core; returns the previous state */
+#define ACTOR_PORT_IRQ_MASK() (taskENTER_CRITICAL(), 0u)
+
+/** Restore the interrupt state returned by ACTOR_PORT_IRQ_MASK */
+#define ACTOR_PORT_IRQ_UNMASK(state_) do { (void)(state_); taskEXIT_CRITICAL(); } while (0)
+
+/** Bytes per unit of task stack size; vanilla FreeRTOS counts words */
+#define ACTOR_PORT_STACK_UNIT sizeof(StackType_t)
+
+/** Whether a core runs its idle task; the simulated core running the caller does */
+#define ACTOR_PORT_CORE_IDLE(core_) ((void)(core_), true)
+#else
+/** Declare a lock protecting framework state */
+#define ACTOR_PORT_LOCK(name_) static portMUX_TYPE name_ = portMUX_INITIALIZER_UNLOCKED
+
+/** Enter a critical section; usable from both task and ISR context */
+#define ACTOR_PORT_ENTER(lock_) portENTER_CRITICAL_SAFE(lock_)
+
+/** Exit a critical section entered with ACTOR_PORT_ENTER */
+#define ACTOR_PORT_EXIT(lock_) portEXIT_CRITICAL_SAFE(lock_)
+
+/** Mask interrupts on the current core; returns the previous state */
+#define ACTOR_PORT_IRQ_MASK() portSET_INTERRUPT_MASK_FROM_ISR()
+
+/** Restore the interrupt state returned by ACTOR_PORT_IRQ_MASK */
+#define ACTOR_PORT_IRQ_UNMASK(state_) portCLEAR_INTERRUPT_MASK_FROM_ISR(state_)
+
+/** Bytes per unit of task stack size; ESP-IDF counts bytes */
+#define ACTOR_PORT_STACK_UNIT 1u
+
+/** Whether a core runs its idle task */
+#define ACTOR_PORT_CORE_IDLE(core_) \
+    (xTaskGetCurrentTaskHandleForCore(core_) == xTaskGetIdleTaskHandleForCore(core_))
+#endif
+
+/** Number of cores */
+#define ACTOR_PORT_NUM_CORES portNUM_PROCESSORS
+
+/** Core the caller runs on; stable while interrupts are masked */
+#define ACTOR_PORT_CORE_ID() ((uint8_t)xPortGetCoreID())
+
+/** Free-running CPU cycle counter of the current core */
+#define ACTOR_PORT_CYCLES() ((uint32_t)esp_cpu_get_cycle_count())
+
+/** Frequency of ACTOR_PORT_CYCLES in Hz */
+#define ACTOR_PORT_CYCLES_HZ() (esp_rom_get_cpu_ticks_per_us() * 1000000u)
+
+/** System-wide microsecond timestamp, comparable across cores */
+#define ACTOR_PORT_TIME_US() ((uint32_t)esp_timer_get_time())
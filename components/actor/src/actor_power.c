@@ -0,0 +1,250 @@
+/**
+ * @file actor_power.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Idle point detection and sleep budgeting for actors
+ * @version 0.1
+ * @date 2024-12-23
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_power.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+#include "time_event.h"
+
+#include <stddef.h>
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+
+#if !CONFIG_ACTOR_PORT_POSIX
+#include <esp_sleep.h>
+#endif
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "actor_power"
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Sleep if nothing keeps the system awake; called with l_idling held
+ *
+ * @param sleep Function putting the system to sleep
+ * @return true if the system slept
+ */
+static bool actor_power_try_sleep(ActorPowerSleep sleep);
+
+/**
+ * @brief Check that every other core runs its idle task
+ *
+ * @return true if no other core runs a task
+ */
+static bool actor_power_cores_idle(void);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Function putting the system to sleep; NULL when disabled */
+static ActorPowerSleep l_sleep = NULL;
+
+/** Shortest sleep worth taking */
+static uint64_t l_min_sleep_us = 0;
+
+/** Number of actors voting to stay awake */
+static uint16_t l_votes = 0;
+
+/** Idle point counters; only written by the idle task holding l_idling */
+static actor_power_stats_t l_stats;
+
+/** Set while one core's idle task runs actor_power_idle */
+static bool l_idling = false;
+
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+/** Time slept that did not add up to a whole tick yet */
+static uint64_t l_slept_rem_us = 0;
+#endif
+
+/** Protects the votes */
+ACTOR_PORT_LOCK(l_vote_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_power_init(ActorPowerSleep sleep, uint64_t min_sleep_us)
+{
+    l_min_sleep_us = min_sleep_us;
+    l_stats = (actor_power_stats_t){ 0 };
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    l_slept_rem_us = 0;
+#endif
+    __atomic_store_n(&l_sleep, sleep, __ATOMIC_RELEASE);
+}
+
+// Described in .h
+bool actor_power_idle(void)
+{
+    ActorPowerSleep const sleep = __atomic_load_n(&l_sleep, __ATOMIC_ACQUIRE);
+    if (sleep == NULL)
+    {
+        return false;
+    }
+
+    // The idle task of one core at a time decides for the whole system
+    if (__atomic_exchange_n(&l_idling, true, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+
+    bool const slept = actor_power_try_sleep(sleep);
+    __atomic_store_n(&l_idling, false, __ATOMIC_RELEASE);
+
+    return slept;
+}
+
+// Described above
+static bool actor_power_try_sleep(ActorPowerSleep sleep)
+{
+    if (__atomic_load_n(&l_votes, __ATOMIC_RELAXED) > 0)
+    {
+        l_stats.vetoed++;
+        return false;
+    }
+
+    if (actor_registry_busy() || !actor_power_cores_idle())
+    {
+        l_stats.busy++;
+        return false;
+    }
+
+    uint64_t const budget = time_event_next_expiry_us();
+    if (budget < l_min_sleep_us)
+    {
+        l_stats.too_short++;
+        return false;
+    }
+
+    uint64_t const slept = sleep(budget);
+#if CONFIG_ACTOR_TIME_EVENT_TICK
+    // Keep the part of a tick left over, or the ticks fall behind every sleep
+    uint64_t const tick_us = (uint64_t)portTICK_PERIOD_MS * 1000;
+    uint64_t const total = l_slept_rem_us + slept;
+    time_event_add_ticks((uint32_t)(total / tick_us));
+    l_slept_rem_us = total % tick_us;
+#endif
+
+    l_stats.sleeps++;
+    l_stats.slept_us += slept;
+
+    return true;
+}
+
+// Described above
+static bool actor_power_cores_idle(void)
+{
+    for (uint8_t core = 0; core < ACTOR_PORT_NUM_CORES; core++)
+    {
+        // Tasks that dequeued a message but did not start its dispatch yet
+        // keep their core out of its idle task
+        if (core != ACTOR_PORT_CORE_ID() && !ACTOR_PORT_CORE_IDLE(core))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Described in .h
+uint64_t actor_power_budget_us(void)
+{
+    if (__atomic_load_n(&l_votes, __ATOMIC_RELAXED) > 0 || actor_registry_busy())
+    {
+        return 0;
+    }
+
+    return time_event_next_expiry_us();
+}
+
+// Described in .h
+void actor_power_keep_awake(actor_t * const me, bool awake)
+{
+    ACTOR_PORT_ENTER(&l_vote_lock);
+    if (me->awake != awake)
+    {
+        me->awake = awake;
+        if (awake)
+        {
+            l_votes++;
+        }
+        else
+        {
+            l_votes--;
+        }
+    }
+    ACTOR_PORT_EXIT(&l_vote_lock);
+}
+
+// Described in .h
+void actor_power_get_stats(actor_power_stats_t * const stats)
+{
+    *stats = l_stats;
+}
+
+#if !CONFIG_ACTOR_PORT_POSIX
+// Described in .h
+uint64_t actor_power_light_sleep(uint64_t budget_us)
+{
+    if (budget_us == UINT64_MAX)
+    {
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+    }
+    else
+    {
+        esp_sleep_enable_timer_wakeup(budget_us);
+    }
+
+    int64_t const start = esp_timer_get_time();
+    if (esp_light_sleep_start() != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Light sleep rejected");
+        return 0;
+    }
+
+    return (uint64_t)(esp_timer_get_time() - start);
+}
+#endif
@@ -0,0 +1,544 @@
+/**
+ * @file actor_priv.h
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Private definitions shared by the actor framework sources
+ * @version 0.1
+ * @date 2024-10-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor.h"
+#include "actor_port.h"
+#include "actor_stats.h"
+#include "actor_supervisor.h"
+#include "actor_trace.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+#pragma once
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Tag in actor_envelope_t.msg marking urgent messages */
+#define ACTOR_ENV_URGENT ((uintptr_t)1u)
+
+/** Bytes at the start of an actor object holding the fields of every post and dispatch */
+#define ACTOR_HOT_SIZE 64
+
+_Static_assert(_Alignof(actor_msg_t) >= 2, "Envelope tag needs 2-byte aligned messages");
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+typedef uint16_t actor_id_t;
+
+/** Lifecycle of an actor */
+typedef enum {
+    ACTOR_STATE_STOPPED,        ///< Constructed or stopped; no task or queue
+    ACTOR_STATE_RUNNING,        ///< Accepting messages
+    ACTOR_STATE_STOPPING,       ///< QUIT_SIG queued; posts are refused
+} actor_state_t;
+
+/** Item stored in an actor's message queue */
+typedef struct actor_envelope_s {
+    actor_msg_t const *msg;     ///< Queued message; tagged with ACTOR_ENV_URGENT
+#if CONFIG_ACTOR_STATS
+    uint32_t stamp;             ///< Time the message was queued in microseconds
+#endif
+} actor_envelope_t;
+
+/** Coalescing state of one signal */
+typedef struct actor_coalesce_s {
+    signal_t sig;               ///< Coalesced signal
+    bool queued;                ///< A message with the signal is queued
+    uint16_t merged;            ///< Posts merged into the queued message
+} actor_coalesce_t;
+
+/**
+ * @brief Definition of actor object.
+ *
+ * Contents are hidden.  Only contents available to the actor are the ones defined
+ * on inheritance of the struct, see actor_object_t.
+ *
+ * Fields read by every post and dispatch come first and fit in
+ * ACTOR_HOT_SIZE bytes; the rest is only read on start, stop, configuration
+ * or overload.  A message touches one cache line of the actor when the
+ * object is aligned to ACTOR_HOT_SIZE, as the objects of the static pool
+ * are.  Heap objects and embedded actor_object_t are only 8-byte aligned,
+ * so their hot fields may straddle two lines unless the storage is aligned.
+ */
+struct actor_s {
+    QueueHandle_t msg_queue;    ///< Message queue to send messages
+    DispatchHandler dispatch;   ///< Dispatch function for handling messages
+    BatchHandler batch;         ///< Optional handler for a burst of messages
+    actor_supervisor_t *supervisor;  ///< Set by actor_supervise; NULL otherwise
+    uint32_t posting;           ///< Posts in progress; teardown waits for them
+    uint32_t queue_length;      ///< Capacity of msg_queue
+    uint32_t credits;           ///< Normal posts left under ACTOR_OVERFLOW_CREDITS
+    uint32_t block_ticks;       ///< Longest wait of ACTOR_OVERFLOW_BLOCK
+    uint32_t watchdog;          ///< Longest dispatch in ticks; 0 when not watched
+    actor_id_t actor_id;        ///< Index of the actor in the registry
+    uint16_t batch_max;         ///< Messages drained per wakeup
+    uint16_t merged;            ///< Posts merged into the message being dispatched
+    uint8_t state;              ///< One of actor_state_t
+    uint8_t overflow;           ///< One of actor_overflow_t
+    uint8_t urgent_reserve;     ///< Queue slots kept for urgent messages
+    uint8_t num_coalesce;       ///< Entries used in coalesce
+    bool pooled;                ///< Run by the shared worker pool instead of main_task
+    bool scheduled;             ///< Pooled actor is in a ready list or being dispatched
+    // End of the hot fields
+    actor_coalesce_t coalesce[CONFIG_ACTOR_COALESCE_MAX];  ///< Coalesced signals
+    uint8_t prio;               ///< Pooled priority level
+    uint8_t home;               ///< Worker whose ready set holds the actor
+    uint16_t pending;           ///< Pooled messages queued but not yet dispatched
+    actor_t *next_ready;        ///< Next actor in the same ready list
+    TaskHandle_t main_task;     ///< Main actor task that handles incoming messages
+    BaseType_t core;            ///< Core the task is pinned to or ACTOR_NO_AFFINITY
+    actor_t *parent;            ///< Reference to the parent; can be NULL
+    actor_t *first_child;       ///< First child in construction order
+    actor_t *next_sibling;      ///< Next child of the same parent
+    OverflowHandler on_overflow;  ///< Called for refused or discarded messages
+    actor_msg_t const **deferred;  ///< Ring of deferred messages
+    uint8_t defer_length;       ///< Capacity of deferred
+    uint8_t defer_head;         ///< Oldest deferred message
+    uint8_t defer_count;        ///< Messages deferred
+    uint8_t task_prio;          ///< Priority the task was started with
+    bool restart;               ///< QUIT_SIG restarts the actor instead of terminating it
+    bool respawn;               ///< Task was killed; the supervisor creates it again
+    bool owned;                 ///< Object was allocated by actor_ctor
+    bool dispatching;           ///< A watched dispatch is in progress
+    bool killable;              ///< The supervisor may delete the task when it hangs
+    bool awake;                 ///< Votes to keep the system out of light sleep
+#if CONFIG_ACTOR_RECORD
+    bool recorded;              ///< Messages queued for the actor are recorded
+#endif
+#if CONFIG_ACTOR_SIZING
+    uint16_t queue_peak;        ///< Most messages waiting in the queue at once
+#endif
+    uint32_t stack_size;        ///< Stack size the task was started with
+    TickType_t dispatch_start;  ///< Tick the watched dispatch in progress started
+    actor_storage_t const *storage;  ///< Storage the task was started with; NULL on the heap
+    actor_msg_t const *current; ///< Message of the watched dispatch in progress
+    actor_exit_t exit_msg;      ///< CHILD_EXIT_SIG posted to the parent
+#if CONFIG_ACTOR_STATS
+    actor_stats_t stats;        ///< Runtime statistics
+#endif
+    // Private actor parameters after this
+};
+
+_Static_assert(offsetof(struct actor_s, coalesce) <= ACTOR_HOT_SIZE, "Hot actor fields span two cache lines");
+_Static_assert(sizeof(struct actor_s) <= sizeof(actor_object_t), "ACTOR_OBJECT_SIZE is too small");
+_Static_assert(sizeof(actor_object_t) - sizeof(struct actor_s) <= 2 * sizeof(void *),
+               "ACTOR_OBJECT_SIZE is too large");
+_Static_assert(_Alignof(struct actor_s) <= _Alignof(actor_object_t), "actor_object_t is underaligned");
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Get the message of a queue item without its tag
+ *
+ * @param env Envelope received from an actor's queue
+ * @return Queued message
+ */
+static inline actor_msg_t const *actor_env_msg(actor_envelope_t const * const env)
+{
+    return (actor_msg_t const *)((uintptr_t)env->msg & ~ACTOR_ENV_URGENT);
+}
+
+/**
+ * @brief Get the core a worker of the shared pool is pinned to
+ *
+ * @param worker Worker index
+ * @return Core of the worker
+ */
+static inline BaseType_t actor_worker_core(uint8_t worker)
+{
+    return worker % ACTOR_PORT_NUM_CORES;
+}
+
+/**
+ * @brief Dispatch one queued message and release it
+ *
+ * Shared by the task-per-actor message loop and the worker pool.  Once
+ * QUIT_SIG has been handled the actor is torn down or restarted.
+ *
+ * @param me Actor owning the message
+ * @param env Envelope received from the actor's queue
+ * @return false if the message was QUIT_SIG
+ */
+bool actor_dispatch_one(actor_t * const me, actor_envelope_t const * const env);
+
+/**
+ * @brief Dispatch a burst of queued messages and release them
+ *
+ * Hands the burst to the actor's batch handler if it has one, otherwise
+ * dispatches the messages one by one.  Messages after QUIT_SIG are released
+ * without being dispatched.
+ *
+ * @param me Actor owning the messages
+ * @param env Envelopes received from the actor's queue, oldest first
+ * @param count Number of envelopes
+ * @return false if the burst held QUIT_SIG
+ */
+bool actor_dispatch_batch(actor_t * const me, actor_envelope_t const * const env, uint16_t count);
+
+/**
+ * @brief Kill the task of a hung actor
+ *
+ * Deletes the task without waiting for its dispatch to return, releases the
+ * queued messages and marks the actor for actor_respawn.  Heap memory,
+ * mutexes, pooled events and locks the dispatch handler held are lost, so
+ * the supervisor only kills actors marked with actor_set_killable.
+ *
+ * @param me Running actor with its own task
+ */
+void actor_kill(actor_t * const me);
+
+/**
+ * @brief Create the task of a killed actor again
+ *
+ * Reuses the queue and, for actors started with actor_start_static, the
+ * stack and TCB.  Call it some time after actor_kill so that the kernel has
+ * finished deleting the old task.
+ *
+ * @param me Actor killed with actor_kill
+ */
+void actor_respawn(actor_t * const me);
+
+/**
+ * @brief Post an actor's CHILD_EXIT_SIG to the urgent lane of its parent
+ *
+ * @param me Actor that terminated or failed
+ * @param reason One of actor_exit_reason_t
+ * @param woken NULL from task context; the ISR's woken flag otherwise
+ */
+void actor_notify_exit(actor_t * const me, actor_exit_reason_t reason, BaseType_t * const woken);
+
+/**
+ * @brief Let the supervisor of an actor handle a framework message
+ *
+ * @param me Actor that called actor_supervise
+ * @param msg Message with a reserved signal
+ * @return true if the message was consumed and must not be dispatched
+ */
+bool actor_supervisor_handle(actor_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Look up an actor by id
+ *
+ * @param id Actor id assigned by actor_ctor
+ * @return Actor with the given id or NULL if no such actor exists
+ */
+actor_t *actor_registry_get(actor_id_t id);
+
+/**
+ * @brief Check whether any actor is dispatching or has messages queued
+ *
+ * Used at idle points, so it scans the registry rather than keeping a count
+ * on the post path.  Dispatches are counted, so a handler blocked inside its
+ * dispatch, or running on another core, keeps the system busy.
+ *
+ * @return true if a dispatch is in progress or a message is waiting
+ */
+bool actor_registry_busy(void);
+
+/**
+ * @brief Mark a pooled actor as having one more message to dispatch
+ *
+ * Called after a message was queued for a pooled actor.  Puts the actor in
+ * its worker's ready set if it is not already scheduled and wakes a worker.
+ *
+ * @param me Pooled actor that received a message
+ * @param woken NULL from task context; from an ISR, set to pdTRUE if a
+ *              worker with higher priority was woken
+ */
+void actor_sched_ready(actor_t * const me, BaseType_t * const woken);
+
+/**
+ * @brief Forget the messages counted for a pooled actor that was drained
+ *
+ * Called on the worker dispatching QUIT_SIG, after the queue was emptied.
+ * The actor leaves the ready sets once that dispatch completes.
+ *
+ * @param me Pooled actor being dispatched
+ */
+void actor_sched_drained(actor_t * const me);
+
+/**
+ * @brief Note that a message is released without being dispatched
+ *
+ * Called when drop-oldest, a refused post, a stop or a restart discards a
+ * message.  If it is the notification of a channel, the channel is no longer
+ * pending, so its next commit notifies the consumer again.
+ *
+ * @param msg Discarded message
+ */
+void actor_channel_discarded(actor_msg_t const * const msg);
+
+#if CONFIG_ACTOR_STATS
+/**
+ * @brief Record the time a message is queued
+ *
+ * @param env Envelope about to be queued
+ */
+static inline void actor_stats_stamp(actor_envelope_t * const env)
+{
+    env->stamp = ACTOR_PORT_TIME_US();
+}
+
+/**
+ * @brief Track the queue depth with a message about to be queued
+ *
+ * The depth is sampled from the queue rather than derived from the counters,
+ * since messages discarded by drop-oldest or released on stop are never
+ * dispatched.  Read before queuing, like actor_sizing_posting, because a
+ * stopping actor may delete its queue as soon as the message is in.
+ *
+ * @param me Receiving actor
+ * @param from_isr Called from an interrupt
+ */
+static inline void actor_stats_posting(actor_t * const me, bool from_isr)
+{
+    UBaseType_t depth = from_isr ? uxQueueMessagesWaitingFromISR(me->msg_queue)
+                                 : uxQueueMessagesWaiting(me->msg_queue);
+    depth = (depth < me->queue_length) ? depth + 1 : me->queue_length;
+    if (depth > me->stats.queue_hwm)
+    {
+        me->stats.queue_hwm = depth;
+    }
+}
+
+/**
+ * @brief Account for a message that was queued
+ *
+ * @param me Receiving actor
+ */
+static inline void actor_stats_posted(actor_t * const me)
+{
+    __atomic_add_fetch(&me->stats.posted, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Account for a message that did not fit in the queue
+ *
+ * @param me Receiving actor
+ */
+static inline void actor_stats_dropped(actor_t * const me)
+{
+    __atomic_add_fetch(&me->stats.dropped, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Record the time a message spent queued
+ *
+ * @param me Receiving actor
+ * @param latency_us Time from post to start of dispatch
+ */
+void actor_stats_latency(actor_t * const me, uint32_t latency_us);
+
+/**
+ * @brief Account for a completed dispatch
+ *
+ * @param me Dispatching actor
+ * @param sig Signal of the dispatched message
+ * @param cycles Cycles spent in the dispatch function
+ */
+void actor_stats_dispatched(actor_t * const me, signal_t sig, uint32_t cycles);
+
+/**
+ * @brief Account for the sender of a message that was queued
+ *
+ * @param me Receiving actor
+ * @param from_isr The message was posted from an interrupt
+ */
+void actor_stats_sender(actor_t * const me, bool from_isr);
+
+/**
+ * @brief Make an actor the one dispatching on the current task
+ *
+ * Lets actor_stats_sender attribute posts made by the dispatch handler.  Kept
+ * in a thread local storage pointer, so it follows the task when it is
+ * preempted, time sliced or moved to another core.
+ *
+ * @param me Actor about to dispatch
+ * @return Actor that was dispatching before, to pass to actor_stats_leave
+ */
+actor_t *actor_stats_enter(actor_t * const me);
+
+/**
+ * @brief Restore the actor dispatching on the current task
+ *
+ * @param prev Value returned by the matching actor_stats_enter
+ */
+void actor_stats_leave(actor_t * const prev);
+#else
+static inline void actor_stats_stamp(actor_envelope_t * const env) { (void)env; }
+static inline void actor_stats_posting(actor_t * const me, bool from_isr) { (void)me; (void)from_isr; }
+static inline void actor_stats_posted(actor_t * const me) { (void)me; }
+static inline void actor_stats_dropped(actor_t * const me) { (void)me; }
+static inline void actor_stats_sender(actor_t * const me, bool from_isr) { (void)me; (void)from_isr; }
+#endif
+
+#if CONFIG_ACTOR_SIZING
+/**
+ * @brief Track the deepest the actor's queue gets with a message about to be queued
+ *
+ * Read before queuing because a stopping actor may delete its queue as soon
+ * as the message is in.  A post that finds the queue full counts as filling
+ * it.
+ *
+ * @param me Receiving actor
+ * @param from_isr true when posted from an interrupt
+ */
+static inline void actor_sizing_posting(actor_t * const me, bool from_isr)
+{
+    UBaseType_t depth = from_isr ? uxQueueMessagesWaitingFromISR(me->msg_queue)
+                                 : uxQueueMessagesWaiting(me->msg_queue);
+    depth = (depth < me->queue_length) ? depth + 1 : me->queue_length;
+    if (depth > me->queue_peak)
+    {
+        me->queue_peak = (uint16_t)depth;
+    }
+}
+
+/**
+ * @brief Replace the sizes an actor is started with by its applied entry
+ *
+ * @param me Actor being started
+ * @param queue_length Queue length, replaced if the actor has an entry
+ * @param stack_size Stack size, replaced if the actor has an entry; NULL for
+ *                   pooled actors
+ */
+void actor_sizing_resize(actor_t const * const me, uint32_t * const queue_length, uint32_t * const stack_size);
+#else
+static inline void actor_sizing_posting(actor_t * const me, bool from_isr) { (void)me; (void)from_isr; }
+
+static inline void actor_sizing_resize(actor_t const * const me, uint32_t * const queue_length,
+                                       uint32_t * const stack_size)
+{
+    (void)me;
+    (void)queue_length;
+    (void)stack_size;
+}
+#endif
+
+/**
+ * @brief Write an unsigned LEB128 varint
+ *
+ * @param buf Destination
+ * @param size Room in buf
+ * @param value Value to write
+ * @return Bytes written; 0 if buf is too small
+ */
+size_t actor_varint_put(uint8_t * const buf, size_t size, uint64_t value);
+
+/**
+ * @brief Read an unsigned LEB128 varint
+ *
+ * @param buf Source
+ * @param len Bytes available in buf
+ * @param value Set to the value read
+ * @return Bytes read; 0 if the varint is truncated or too long
+ */
+size_t actor_varint_get(uint8_t const * const buf, size_t len, uint64_t * const value);
+
+#if CONFIG_ACTOR_TRACE
+/**
+ * @brief Append a record to the current core's trace buffer
+ *
+ * @param type One of ActorTraceType
+ * @param actor Id of the actor concerned
+ * @param sig Signal concerned
+ */
+void actor_trace_record(uint8_t type, actor_id_t actor, signal_t sig);
+#else
+static inline void actor_trace_record(uint8_t type, actor_id_t actor, signal_t sig)
+{
+    (void)type;
+    (void)actor;
+    (void)sig;
+}
+#endif
+
+#if CONFIG_ACTOR_RECORD
+/** A message encoded before it is queued; appended to the recording once queued */
+typedef struct {
+    uint16_t len;               ///< Bytes used in data; 0 if the message is not recorded
+    uint8_t flags;              ///< ACTOR_RECORD_* flags of the record
+    uint8_t data[CONFIG_ACTOR_RECORD_MAX_MESSAGE];  ///< Encoded message
+} actor_record_capture_t;
+
+/**
+ * @brief Encode a message about to be queued for a recorded actor
+ *
+ * Done before queuing because a pooled event may be dispatched and freed as
+ * soon as it is queued.
+ *
+ * @param me Receiving actor
+ * @param msg Message to be queued
+ * @param urgent The message goes to the urgent lane
+ * @param cap Filled with the encoded message
+ */
+void actor_record_capture(actor_t const * const me, actor_msg_t const * const msg, bool urgent,
+                          actor_record_capture_t * const cap);
+
+/**
+ * @brief Append a captured message to the recording once it was queued
+ *
+ * @param me Receiving actor
+ * @param cap Message captured by actor_record_capture
+ */
+void actor_record_commit(actor_t const * const me, actor_record_capture_t const * const cap);
+#else
+typedef struct {
+    uint8_t len;
+} actor_record_capture_t;
+
+static inline void actor_record_capture(actor_t const * const me, actor_msg_t const * const msg, bool urgent,
+                                        actor_record_capture_t * const cap)
+{
+    (void)me;
+    (void)msg;
+    (void)urgent;
+    (void)cap;
+}
+
+static inline void actor_record_commit(actor_t const * const me, actor_record_capture_t const * const cap)
+{
+    (void)me;
+    (void)cap;
+}
+#endif
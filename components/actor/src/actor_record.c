@@ -0,0 +1,377 @@
+/**
+ * @file actor_record.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Recording of queued messages and their replay
+ * @version 0.1
+ * @date 2024-12-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_record.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+#include "actor_remote.h"
+
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "actor_record"
+
+#if CONFIG_ACTOR_RECORD
+/** Size of the record buffer; must be a power of two */
+#define RECORD_SIZE CONFIG_ACTOR_RECORD_BUFFER_SIZE
+
+#define RECORD_MASK (RECORD_SIZE - 1)
+
+_Static_assert((RECORD_SIZE & RECORD_MASK) == 0, "Record buffer size must be a power of two");
+#endif
+
+/** Longest record header: four varints of at most 32 bits */
+#define RECORD_HEADER_MAX 20
+
+/** Ticks a flat-out replay waits for a free event before skipping a message */
+#define REPLAY_EVENT_WAIT 100
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Decode one recorded message into a pooled event
+ *
+ * @param buf Encoded message
+ * @param len Length of the encoded message
+ * @param msg Set to the new event, or NULL
+ * @return As actor_schema_decode
+ */
+static esp_err_t actor_replay_decode(uint8_t const * const buf, size_t len, actor_msg_t **msg);
+
+/**
+ * @brief Wait until a recorded time is reached
+ *
+ * @param start Time the replay started in microseconds
+ * @param at Offset of the record in microseconds
+ */
+static void actor_replay_wait(int64_t start, uint64_t at);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_RECORD
+/** Encoded records waiting to be drained */
+static uint8_t l_buffer[RECORD_SIZE];
+
+/** Next byte to write */
+static uint32_t l_head = 0;
+
+/** Next byte to drain */
+static uint32_t l_tail = 0;
+
+/** Records written and not yet drained */
+static uint32_t l_pending = 0;
+
+/** Records dropped because the buffer was full */
+static uint32_t l_lost = 0;
+
+/** Time of the previous record in microseconds */
+static uint32_t l_last = 0;
+
+/** Set once the first record is written; it starts the recording at 0 */
+static bool l_started = false;
+
+/** Protects the record buffer */
+ACTOR_PORT_LOCK(l_record_lock);
+#endif
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+#if CONFIG_ACTOR_RECORD
+// Described in .h
+void actor_record_enable(actor_t * const me, bool enable)
+{
+    __atomic_store_n(&me->recorded, enable, __ATOMIC_RELAXED);
+}
+
+// Described in actor_priv.h
+void actor_record_capture(actor_t const * const me, actor_msg_t const * const msg, bool urgent,
+                          actor_record_capture_t * const cap)
+{
+    cap->len = 0;
+    if (!__atomic_load_n(&me->recorded, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    cap->flags = urgent ? ACTOR_RECORD_URGENT : 0;
+    size_t len = actor_schema_encode(msg, cap->data, sizeof(cap->data));
+    if (len == 0)
+    {
+        // No schema, or too large to capture: keep the signal at least
+        len = actor_varint_put(cap->data, sizeof(cap->data), msg->sig);
+        cap->flags |= ACTOR_RECORD_SIGNAL_ONLY;
+    }
+    cap->len = (uint16_t)len;
+}
+
+// Described in actor_priv.h
+void actor_record_commit(actor_t const * const me, actor_record_capture_t const * const cap)
+{
+    if (cap->len == 0)
+    {
+        return;
+    }
+
+    uint8_t header[RECORD_HEADER_MAX];
+
+    ACTOR_PORT_ENTER(&l_record_lock);
+    uint32_t const now = ACTOR_PORT_TIME_US();
+    size_t n = actor_varint_put(header, sizeof(header), l_started ? now - l_last : 0);
+    n += actor_varint_put(header + n, sizeof(header) - n, me->actor_id);
+    n += actor_varint_put(header + n, sizeof(header) - n, cap->flags);
+    n += actor_varint_put(header + n, sizeof(header) - n, cap->len);
+
+    uint32_t const len = (uint32_t)n + cap->len;
+    if (RECORD_SIZE - (l_head - l_tail) < len)
+    {
+        l_lost++;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < len; i++)
+        {
+            uint8_t const byte = (i < n) ? header[i] : cap->data[i - n];
+            l_buffer[(l_head + i) & RECORD_MASK] = byte;
+        }
+        l_head += len;
+        l_pending++;
+        l_last = now;
+        l_started = true;
+    }
+    ACTOR_PORT_EXIT(&l_record_lock);
+}
+
+// Described in .h
+uint32_t actor_record_drain(RecordWriteHandler write, void *ctx)
+{
+    ACTOR_PORT_ENTER(&l_record_lock);
+    uint32_t const tail = l_tail;
+    uint32_t const head = l_head;
+    uint32_t const count = l_pending;
+    uint32_t const lost = l_lost;
+    l_pending = 0;
+    l_lost = 0;
+    ACTOR_PORT_EXIT(&l_record_lock);
+
+    if (head == tail && lost == 0)
+    {
+        return 0;
+    }
+
+    actor_record_frame_t const frame = {
+        .magic = ACTOR_RECORD_MAGIC,
+        .version = ACTOR_RECORD_VERSION,
+        .reserved = 0,
+        .count = (uint16_t)count,
+        .lost = lost,
+        .len = head - tail,
+    };
+    write(ctx, &frame, sizeof(frame));
+
+    // Bytes between tail and head are not touched by writers until released
+    uint32_t const start = tail & RECORD_MASK;
+    uint32_t const to_end = RECORD_SIZE - start;
+    if (head - tail > to_end)
+    {
+        write(ctx, &l_buffer[start], to_end);
+        write(ctx, &l_buffer[0], head - tail - to_end);
+    }
+    else if (head != tail)
+    {
+        write(ctx, &l_buffer[start], head - tail);
+    }
+
+    ACTOR_PORT_ENTER(&l_record_lock);
+    l_tail = head;
+    ACTOR_PORT_EXIT(&l_record_lock);
+
+    return count;
+}
+#endif
+
+// Described in .h
+esp_err_t actor_replay(uint8_t const * const data, size_t len, actor_t * const actors[], uint16_t num_actors,
+                       actor_replay_mode_t mode, actor_replay_stats_t * const stats)
+{
+    actor_replay_stats_t result = { 0 };
+    esp_err_t err = ESP_OK;
+    int64_t const start = esp_timer_get_time();
+    size_t pos = 0;
+
+    while (pos < len && err == ESP_OK)
+    {
+        actor_record_frame_t frame;
+        if (len - pos < sizeof(frame))
+        {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        memcpy(&frame, data + pos, sizeof(frame));
+        pos += sizeof(frame);
+        if (frame.magic != ACTOR_RECORD_MAGIC || frame.version != ACTOR_RECORD_VERSION)
+        {
+            err = ESP_ERR_INVALID_VERSION;
+            break;
+        }
+        if (len - pos < frame.len)
+        {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+
+        size_t const end = pos + frame.len;
+        while (pos < end)
+        {
+            // Delta, actor id, flags and message length
+            uint64_t field[4] = { 0 };
+            size_t used = 0;
+            for (uint8_t f = 0; f < 4 && (f == 0 || used != 0); f++)
+            {
+                size_t const n = actor_varint_get(data + pos + used, end - pos - used, &field[f]);
+                used = (n != 0) ? used + n : 0;
+            }
+            uint64_t const id = field[1];
+            uint64_t const size = field[3];
+            if (used == 0 || end - pos - used < size)
+            {
+                err = ESP_ERR_INVALID_SIZE;
+                break;
+            }
+            uint8_t const * const msg_buf = data + pos + used;
+            pos += used + size;
+
+            result.records++;
+            result.span_us += field[0];
+            if (field[2] & ACTOR_RECORD_SIGNAL_ONLY)
+            {
+                // Posting the bare signal would hand the handler a truncated message
+                result.uncaptured++;
+                continue;
+            }
+            if (mode == ACTOR_REPLAY_RECORDED)
+            {
+                actor_replay_wait(start, result.span_us);
+            }
+
+            actor_t *target = NULL;
+            if (actors == NULL)
+            {
+                target = (id <= UINT16_MAX) ? actor_registry_get((actor_id_t)id) : NULL;
+            }
+            else if (id < num_actors)
+            {
+                target = actors[id];
+            }
+            actor_msg_t *msg = NULL;
+            esp_err_t decoded = ESP_ERR_NOT_FOUND;
+            if (target != NULL)
+            {
+                // A flat-out replay can outrun the actors freeing events
+                decoded = actor_replay_decode(msg_buf, size, &msg);
+                for (uint32_t wait = 0; decoded == ESP_ERR_NO_MEM && wait < REPLAY_EVENT_WAIT; wait++)
+                {
+                    vTaskDelay(1);
+                    decoded = actor_replay_decode(msg_buf, size, &msg);
+                }
+            }
+            if (decoded != ESP_OK)
+            {
+                result.skipped++;
+                continue;
+            }
+
+            // A refused post releases the event
+            esp_err_t const posted = (field[2] & ACTOR_RECORD_URGENT) ? actor_post_urgent(target, msg)
+                                                                      : actor_post(target, msg);
+            if (posted == ESP_OK)
+            {
+                result.posted++;
+            }
+            else
+            {
+                result.refused++;
+            }
+        }
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Replay stopped at byte %u: error 0x%x", (unsigned)pos, err);
+    }
+    if (stats != NULL)
+    {
+        *stats = result;
+    }
+
+    return err;
+}
+
+// Described above
+static esp_err_t actor_replay_decode(uint8_t const * const buf, size_t len, actor_msg_t **msg)
+{
+    size_t used = 0;
+
+    // Without the schema on this node the payload cannot be restored either
+    return actor_schema_decode(buf, len, msg, &used);
+}
+
+// Described above
+static void actor_replay_wait(int64_t start, uint64_t at)
+{
+    int64_t const ahead = start + (int64_t)at - esp_timer_get_time();
+    int64_t const tick_us = (int64_t)portTICK_PERIOD_MS * 1000;
+
+    if (ahead >= tick_us)
+    {
+        vTaskDelay((TickType_t)(ahead / tick_us));
+    }
+}
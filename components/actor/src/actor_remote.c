@@ -0,0 +1,632 @@
+/**
+ * @file actor_remote.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for posting messages to actors on other nodes
+ * @version 0.1
+ * @date 2024-12-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_remote.h"
+#include "actor_port.h"
+#include "actor_priv.h"
+#include "event_pool.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "actor_remote"
+
+/** Maximum number of proxies */
+#define MAX_PROXIES CONFIG_ACTOR_REMOTE_MAX_PROXIES
+
+/** Largest burst a proxy packs into frames at once */
+#define BATCH_MAX CONFIG_ACTOR_BATCH_MAX
+
+/** Offset of the destination index in a frame */
+#define FRAME_ADDRESS 1
+
+/** Offset of the message count in a frame */
+#define FRAME_COUNT 2
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Look up the schema of a signal
+ *
+ * @param sig Signal
+ * @return Registered schema or NULL
+ */
+static actor_schema_t const *actor_schema_find(uint64_t sig);
+
+/**
+ * @brief Read an integer member as unsigned
+ *
+ * @param src Member
+ * @param size Size of the member: 1, 2, 4 or 8
+ * @return Value of the member
+ */
+static uint64_t actor_field_load(uint8_t const * const src, uint8_t size);
+
+/**
+ * @brief Write the low bytes of a value to an integer member
+ *
+ * @param dst Member
+ * @param size Size of the member: 1, 2, 4 or 8
+ * @param value Value to write
+ */
+static void actor_field_store(uint8_t * const dst, uint8_t size, uint64_t value);
+
+/**
+ * @brief Find the proxy of an actor
+ *
+ * @param me Actor constructed by actor_proxy_ctor
+ * @return Proxy
+ */
+static actor_proxy_t *actor_proxy_find(actor_t const * const me);
+
+/**
+ * @brief Dispatch handler of proxies; sends each message in its own frame
+ */
+static void actor_proxy_dispatch(actor_t * const me, actor_msg_t const * const msg);
+
+/**
+ * @brief Batch handler of proxies; packs the burst into frames
+ */
+static void actor_proxy_batch(actor_t * const me, actor_msg_t const * const msgs[], uint16_t count);
+
+/**
+ * @brief Append a message to the frame being built, sending it first if full
+ *
+ * @param proxy Proxy
+ * @param msg Message to send
+ */
+static void actor_proxy_add(actor_proxy_t * const proxy, actor_msg_t const * const msg);
+
+/**
+ * @brief Send the frame being built, if it holds any message
+ *
+ * @param proxy Proxy
+ */
+static void actor_proxy_flush(actor_proxy_t * const proxy);
+
+/**
+ * @brief Send function of the loopback transport
+ */
+static esp_err_t actor_loopback_send(actor_transport_t const * const me, uint8_t const * const frame,
+                                     size_t len);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Schema per signal */
+static actor_schema_t const **l_schemas = NULL;
+
+/** Number of signals with a schema slot */
+static signal_t l_max_signal = 0;
+
+/** Constructed proxies */
+static actor_proxy_t *l_proxies[MAX_PROXIES];
+
+/** Number of entries used in l_proxies */
+static uint8_t l_num_proxies = 0;
+
+/** Protects l_proxies */
+ACTOR_PORT_LOCK(l_proxy_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_schema_init(actor_schema_t const ** const storage, signal_t max_signal)
+{
+    memset(storage, 0, sizeof(actor_schema_t const *) * max_signal);
+    l_schemas = storage;
+    l_max_signal = max_signal;
+}
+
+// Described in .h
+void actor_schema_register(actor_schema_t const * const schema)
+{
+    assert(schema->sig < l_max_signal);
+    assert(schema->size >= sizeof(actor_msg_t));
+
+    l_schemas[schema->sig] = schema;
+}
+
+// Described in .h
+size_t actor_schema_encode(actor_msg_t const * const msg, uint8_t * const buf, size_t size)
+{
+    actor_schema_t const * const schema = actor_schema_find(msg->sig);
+    if (schema == NULL)
+    {
+        return 0;
+    }
+
+    uint8_t const * const src = (uint8_t const *)msg;
+    size_t pos = actor_varint_put(buf, size, msg->sig);
+    if (pos == 0)
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < schema->num_fields; i++)
+    {
+        actor_field_t const * const field = &schema->fields[i];
+        uint8_t const * const member = src + field->offset;
+        uint64_t const value = (field->kind != ACTOR_FIELD_RAW) ? actor_field_load(member, field->size) : 0;
+        size_t n = 0;
+
+        switch (field->kind)
+        {
+            case ACTOR_FIELD_UINT:
+                n = actor_varint_put(buf + pos, size - pos, value);
+                break;
+
+            case ACTOR_FIELD_INT:
+            {
+                // Sign-extend, then zigzag so that small magnitudes stay short
+                uint8_t const shift = 64 - 8 * field->size;
+                int64_t const sval = (int64_t)(value << shift) >> shift;
+                n = actor_varint_put(buf + pos, size - pos, ((uint64_t)sval << 1) ^ (uint64_t)(sval >> 63));
+                break;
+            }
+
+            default:
+                if (size - pos >= field->size)
+                {
+                    memcpy(buf + pos, member, field->size);
+                    n = field->size;
+                }
+                break;
+        }
+
+        if (n == 0)
+        {
+            return 0;
+        }
+        pos += n;
+    }
+
+    return pos;
+}
+
+// Described in .h
+esp_err_t actor_schema_decode(uint8_t const * const buf, size_t len, actor_msg_t **msg,
+                              size_t * const used)
+{
+    *msg = NULL;
+    *used = 0;
+
+    uint64_t sig = 0;
+    size_t pos = actor_varint_get(buf, len, &sig);
+    if (pos == 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    actor_schema_t const * const schema = actor_schema_find(sig);
+    if (schema == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Decode straight into the event; without one, only measure the message
+    actor_msg_t * const out = event_new(schema->size, (signal_t)sig);
+    uint8_t * const dst = (uint8_t *)out;
+    if (out != NULL)
+    {
+        memset(dst + sizeof(actor_msg_t), 0, schema->size - sizeof(actor_msg_t));
+    }
+
+    for (uint8_t i = 0; i < schema->num_fields; i++)
+    {
+        actor_field_t const * const field = &schema->fields[i];
+        uint64_t value = 0;
+        size_t n = 0;
+
+        if (field->kind == ACTOR_FIELD_RAW)
+        {
+            if (len - pos >= field->size)
+            {
+                n = field->size;
+                if (out != NULL)
+                {
+                    memcpy(dst + field->offset, buf + pos, field->size);
+                }
+            }
+        }
+        else
+        {
+            n = actor_varint_get(buf + pos, len - pos, &value);
+            if (field->kind == ACTOR_FIELD_INT)
+            {
+                value = (value >> 1) ^ (0 - (value & 1));
+            }
+            if (n != 0 && out != NULL)
+            {
+                actor_field_store(dst + field->offset, field->size, value);
+            }
+        }
+
+        if (n == 0)
+        {
+            if (out != NULL)
+            {
+                event_gc(out);
+            }
+            return ESP_ERR_INVALID_SIZE;
+        }
+        pos += n;
+    }
+
+    *used = pos;
+    *msg = out;
+
+    return (out != NULL) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+// Described in .h
+void actor_endpoint_ctor(actor_endpoint_t * const me, actor_t * const *exports, uint8_t num_exports)
+{
+    me->exports = exports;
+    me->num_exports = num_exports;
+    me->frames = 0;
+    me->messages = 0;
+    me->errors = 0;
+}
+
+// Described in .h
+esp_err_t actor_endpoint_receive(actor_endpoint_t * const me, uint8_t const * const frame, size_t len)
+{
+    me->frames++;
+
+    if (len < ACTOR_FRAME_HEADER || frame[0] != ACTOR_FRAME_VERSION)
+    {
+        me->errors++;
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (frame[FRAME_ADDRESS] >= me->num_exports)
+    {
+        me->errors++;
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    actor_t * const dest = me->exports[frame[FRAME_ADDRESS]];
+    uint8_t const count = frame[FRAME_COUNT];
+    esp_err_t result = ESP_OK;
+    size_t pos = ACTOR_FRAME_HEADER;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        actor_msg_t *msg = NULL;
+        size_t used = 0;
+        esp_err_t err = actor_schema_decode(frame + pos, len - pos, &msg, &used);
+        if (err == ESP_OK)
+        {
+            // A refused post releases the event
+            err = actor_post(dest, msg);
+        }
+
+        if (err == ESP_OK)
+        {
+            me->messages++;
+        }
+        else
+        {
+            me->errors++;
+            result = (result == ESP_OK) ? err : result;
+        }
+
+        if (used == 0)
+        {
+            // The rest of the frame cannot be located
+            me->errors += count - i - 1;
+            break;
+        }
+        pos += used;
+    }
+
+    return result;
+}
+
+// Described in .h
+void actor_proxy_ctor(actor_proxy_t * const proxy, actor_t *parent, actor_t **me,
+                      actor_transport_t const * const transport, uint8_t address,
+                      uint8_t * const frame, uint16_t frame_size)
+{
+    assert(frame_size > ACTOR_FRAME_HEADER);
+
+    proxy->transport = transport;
+    proxy->address = address;
+    proxy->frame = frame;
+    proxy->frame_size = frame_size;
+    proxy->frame_len = 0;
+    proxy->frames = 0;
+    proxy->messages = 0;
+    proxy->dropped = 0;
+
+    actor_ctor(parent, me, actor_proxy_dispatch);
+    proxy->actor = *me;
+    if (*me == NULL)
+    {
+        return;
+    }
+    actor_set_batch(*me, BATCH_MAX, actor_proxy_batch);
+
+    ACTOR_PORT_ENTER(&l_proxy_lock);
+    assert(l_num_proxies < MAX_PROXIES);
+    l_proxies[l_num_proxies] = proxy;
+    l_num_proxies++;
+    ACTOR_PORT_EXIT(&l_proxy_lock);
+}
+
+// Described in .h
+void actor_loopback_ctor(actor_loopback_t * const me, actor_endpoint_t * const peer)
+{
+    me->super.send = actor_loopback_send;
+    me->peer = peer;
+}
+
+// Described above
+static actor_schema_t const *actor_schema_find(uint64_t sig)
+{
+    return (sig < l_max_signal) ? l_schemas[sig] : NULL;
+}
+
+// Described in actor_priv.h
+size_t actor_varint_put(uint8_t * const buf, size_t size, uint64_t value)
+{
+    size_t n = 0;
+
+    do
+    {
+        if (n == size)
+        {
+            return 0;
+        }
+        uint8_t const byte = value & 0x7f;
+        value >>= 7;
+        buf[n++] = byte | ((value != 0) ? 0x80 : 0);
+    } while (value != 0);
+
+    return n;
+}
+
+// Described in actor_priv.h
+size_t actor_varint_get(uint8_t const * const buf, size_t len, uint64_t * const value)
+{
+    uint64_t result = 0;
+
+    for (size_t n = 0; n < len && n < 10; n++)
+    {
+        result |= (uint64_t)(buf[n] & 0x7f) << (7 * n);
+        if ((buf[n] & 0x80) == 0)
+        {
+            *value = result;
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
+
+// Described above
+static uint64_t actor_field_load(uint8_t const * const src, uint8_t size)
+{
+    switch (size)
+    {
+        case 1:
+            return *src;
+
+        case 2:
+        {
+            uint16_t value;
+            memcpy(&value, src, sizeof(value));
+            return value;
+        }
+
+        case 4:
+        {
+            uint32_t value;
+            memcpy(&value, src, sizeof(value));
+            return value;
+        }
+
+        default:
+        {
+            uint64_t value;
+            memcpy(&value, src, sizeof(value));
+            return value;
+        }
+    }
+}
+
+// Described above
+static void actor_field_store(uint8_t * const dst, uint8_t size, uint64_t value)
+{
+    switch (size)
+    {
+        case 1:
+            *dst = (uint8_t)value;
+            break;
+
+        case 2:
+        {
+            uint16_t const narrow = (uint16_t)value;
+            memcpy(dst, &narrow, sizeof(narrow));
+            break;
+        }
+
+        case 4:
+        {
+            uint32_t const narrow = (uint32_t)value;
+            memcpy(dst, &narrow, sizeof(narrow));
+            break;
+        }
+
+        default:
+            memcpy(dst, &value, sizeof(value));
+            break;
+    }
+}
+
+// Described above
+static actor_proxy_t *actor_proxy_find(actor_t const * const me)
+{
+    actor_proxy_t *proxy = NULL;
+
+    ACTOR_PORT_ENTER(&l_proxy_lock);
+    for (uint8_t i = 0; i < l_num_proxies && proxy == NULL; i++)
+    {
+        if (l_proxies[i]->actor == me)
+        {
+            proxy = l_proxies[i];
+        }
+    }
+    ACTOR_PORT_EXIT(&l_proxy_lock);
+
+    assert(proxy != NULL);
+    return proxy;
+}
+
+// Described above
+static void actor_proxy_dispatch(actor_t * const me, actor_msg_t const * const msg)
+{
+    // Lifecycle signals are the proxy's own
+    if (msg->sig < USER_SIG)
+    {
+        return;
+    }
+
+    actor_proxy_t * const proxy = actor_proxy_find(me);
+    actor_proxy_add(proxy, msg);
+    actor_proxy_flush(proxy);
+}
+
+// Described above
+static void actor_proxy_batch(actor_t * const me, actor_msg_t const * const msgs[], uint16_t count)
+{
+    actor_proxy_t * const proxy = actor_proxy_find(me);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        actor_proxy_add(proxy, msgs[i]);
+    }
+    actor_proxy_flush(proxy);
+}
+
+// Described above
+static void actor_proxy_add(actor_proxy_t * const proxy, actor_msg_t const * const msg)
+{
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        if (proxy->frame_len == 0)
+        {
+            proxy->frame[0] = ACTOR_FRAME_VERSION;
+            proxy->frame[FRAME_ADDRESS] = proxy->address;
+            proxy->frame[FRAME_COUNT] = 0;
+            proxy->frame_len = ACTOR_FRAME_HEADER;
+        }
+
+        size_t const n = actor_schema_encode(msg, proxy->frame + proxy->frame_len,
+                                             proxy->frame_size - proxy->frame_len);
+        if (n != 0)
+        {
+            proxy->frame_len += n;
+            proxy->frame[FRAME_COUNT]++;
+            if (proxy->frame[FRAME_COUNT] == UINT8_MAX)
+            {
+                actor_proxy_flush(proxy);
+            }
+            return;
+        }
+
+        if (proxy->frame[FRAME_COUNT] == 0)
+        {
+            // No schema, or larger than an empty frame
+            break;
+        }
+
+        // Full; send what is there and retry in an empty frame
+        actor_proxy_flush(proxy);
+    }
+
+    ESP_LOGW(TAG, "Dropped signal %u for remote actor %u", msg->sig, proxy->address);
+    proxy->dropped++;
+}
+
+// Described above
+static void actor_proxy_flush(actor_proxy_t * const proxy)
+{
+    if (proxy->frame_len == 0)
+    {
+        return;
+    }
+
+    uint8_t const count = proxy->frame[FRAME_COUNT];
+    if (count != 0)
+    {
+        if ((proxy->transport->send)(proxy->transport, proxy->frame, proxy->frame_len) == ESP_OK)
+        {
+            proxy->frames++;
+            proxy->messages += count;
+        }
+        else
+        {
+            proxy->dropped += count;
+        }
+    }
+
+    proxy->frame_len = 0;
+}
+
+// Described above
+static esp_err_t actor_loopback_send(actor_transport_t const * const me, uint8_t const * const frame,
+                                     size_t len)
+{
+    actor_loopback_t const * const loopback = (actor_loopback_t const *)me;
+
+    // Errors belong to the receiving side, as on a real link
+    actor_endpoint_receive(loopback->peer, frame, len);
+
+    return ESP_OK;
+}
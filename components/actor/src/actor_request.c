@@ -0,0 +1,319 @@
+/**
+ * @file actor_request.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for request/reply messaging between actors and tasks
+ * @version 0.1
+ * @date 2024-12-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_request.h"
+#include "actor_port.h"
+#include "event_pool.h"
+
+#include <stddef.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Task blocked in actor_call, waiting for a reply */
+typedef struct actor_future_s {
+    TaskHandle_t task;              ///< Waiting task
+    uint32_t corr_id;               ///< Correlation id of the request
+    actor_reply_t const *reply;     ///< Reply once delivered
+    struct actor_future_s *next;    ///< Next waiting task
+} actor_future_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Allocate a correlation id
+ *
+ * @return New id; never 0
+ */
+static uint32_t actor_request_new_id(void);
+
+/**
+ * @brief Remove a future from the list of waiting tasks
+ *
+ * Must be called with the future lock held.
+ *
+ * @param future Future to remove; ignored if not in the list
+ */
+static void actor_future_unlink(actor_future_t const * const future);
+
+/**
+ * @brief Forget the outstanding request of a pending request
+ *
+ * @param me Pending request
+ */
+static void actor_pending_finish(actor_pending_t * const me);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Last correlation id handed out */
+static uint32_t l_corr_id = 0;
+
+/** Tasks blocked in actor_call */
+static actor_future_t *l_futures = NULL;
+
+/** Protects the list of waiting tasks */
+ACTOR_PORT_LOCK(l_future_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+esp_err_t actor_request(actor_t * const server, actor_request_t * const req, actor_t * const reply_to)
+{
+    req->corr_id = actor_request_new_id();
+    req->reply_to = reply_to;
+
+    return actor_post(server, &req->super);
+}
+
+// Described in .h
+esp_err_t actor_reply(actor_request_t const * const req, actor_reply_t * const reply)
+{
+    reply->corr_id = req->corr_id;
+    if (req->reply_to != NULL)
+    {
+        return actor_post(req->reply_to, &reply->super);
+    }
+
+    // The reference is handed to the waiting task, which releases it
+    event_ref(&reply->super);
+
+    TaskHandle_t task = NULL;
+    ACTOR_PORT_ENTER(&l_future_lock);
+    for (actor_future_t *f = l_futures; f != NULL; f = f->next)
+    {
+        if (f->corr_id == reply->corr_id)
+        {
+            f->reply = reply;
+            task = f->task;
+            actor_future_unlink(f);
+            break;
+        }
+    }
+    ACTOR_PORT_EXIT(&l_future_lock);
+
+    if (task == NULL)
+    {
+        // The caller timed out
+        event_gc(&reply->super);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    xTaskNotifyGive(task);
+    return ESP_OK;
+}
+
+// Described in .h
+esp_err_t actor_call(actor_t * const server, actor_request_t * const req,
+                     actor_reply_t const ** const reply, TickType_t timeout)
+{
+    actor_future_t future = {
+        .task = xTaskGetCurrentTaskHandle(),
+        .corr_id = actor_request_new_id(),
+        .reply = NULL,
+        .next = NULL,
+    };
+
+    req->corr_id = future.corr_id;
+    req->reply_to = NULL;
+
+    ACTOR_PORT_ENTER(&l_future_lock);
+    future.next = l_futures;
+    l_futures = &future;
+    ACTOR_PORT_EXIT(&l_future_lock);
+
+    esp_err_t const err = actor_post(server, &req->super);
+    if (err != ESP_OK)
+    {
+        ACTOR_PORT_ENTER(&l_future_lock);
+        actor_future_unlink(&future);
+        ACTOR_PORT_EXIT(&l_future_lock);
+        return err;
+    }
+
+    TickType_t const start = xTaskGetTickCount();
+    while (1)
+    {
+        TickType_t const elapsed = xTaskGetTickCount() - start;
+
+        ACTOR_PORT_ENTER(&l_future_lock);
+        actor_reply_t const * const r = future.reply;
+        bool const expired = (r == NULL && timeout != portMAX_DELAY && elapsed >= timeout);
+        if (expired)
+        {
+            // Stop actor_reply from touching the future once this returns
+            actor_future_unlink(&future);
+        }
+        ACTOR_PORT_EXIT(&l_future_lock);
+
+        if (r != NULL)
+        {
+            *reply = r;
+            return ESP_OK;
+        }
+        if (expired)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+
+        // Notifications left over from earlier calls only cause another pass
+        ulTaskNotifyTake(pdTRUE, (timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - elapsed);
+    }
+}
+
+// Described in .h
+void actor_pending_ctor(actor_pending_t * const me, signal_t timeout_sig, actor_t * const requester)
+{
+    time_event_ctor(&me->timeout, timeout_sig, requester);
+    me->corr_id = 0;
+    me->timed = false;
+}
+
+// Described in .h
+esp_err_t actor_pending_request(actor_pending_t * const me, actor_t * const server,
+                                actor_request_t * const req, uint32_t timeout)
+{
+    actor_pending_finish(me);
+
+    // Set up before posting: a higher priority server may reply right away
+    me->corr_id = actor_request_new_id();
+    me->timed = (timeout > 0);
+    req->corr_id = me->corr_id;
+    req->reply_to = me->timeout.actor;
+    if (me->timed)
+    {
+        time_event_arm(&me->timeout, timeout, 0);
+    }
+
+    esp_err_t const err = actor_post(server, &req->super);
+    if (err != ESP_OK)
+    {
+        actor_pending_finish(me);
+    }
+
+    return err;
+}
+
+// Described in .h
+bool actor_pending_reply(actor_pending_t * const me, actor_msg_t const * const msg)
+{
+    actor_reply_t const * const reply = (actor_reply_t const *)msg;
+
+    if (me->corr_id == 0 || reply->corr_id != me->corr_id)
+    {
+        return false;
+    }
+
+    actor_pending_finish(me);
+    return true;
+}
+
+// Described in .h
+bool actor_pending_timeout(actor_pending_t * const me, actor_msg_t const * const msg)
+{
+    if (msg != &me->timeout.super)
+    {
+        return false;
+    }
+
+    // Every request posts the same event, so an expiry left queued by a
+    // finished request is told apart by state rather than counted: it only
+    // matches if the outstanding request is timed and its timer has expired
+    // too, in which case that request did time out
+    if (me->corr_id == 0 || !me->timed || time_event_armed(&me->timeout))
+    {
+        return false;
+    }
+
+    me->corr_id = 0;
+    me->timed = false;
+    return true;
+}
+
+// Described in .h
+bool actor_pending_busy(actor_pending_t const * const me)
+{
+    return me->corr_id != 0;
+}
+
+// Described above
+static uint32_t actor_request_new_id(void)
+{
+    uint32_t id;
+
+    do
+    {
+        id = __atomic_add_fetch(&l_corr_id, 1, __ATOMIC_RELAXED);
+    } while (id == 0);
+
+    return id;
+}
+
+// Described above
+static void actor_future_unlink(actor_future_t const * const future)
+{
+    for (actor_future_t **link = &l_futures; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == future)
+        {
+            *link = future->next;
+            break;
+        }
+    }
+}
+
+// Described above
+static void actor_pending_finish(actor_pending_t * const me)
+{
+    if (me->corr_id != 0 && me->timed)
+    {
+        // An expiry already on its way is ignored by actor_pending_timeout
+        time_event_disarm(&me->timeout);
+    }
+
+    me->corr_id = 0;
+    me->timed = false;
+}
@@ -0,0 +1,388 @@
+/**
+ * @file actor_sched.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for the shared worker pool scheduler
+ * @version 0.1
+ * @date 2024-10-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_sched.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "actor_sched"
+
+/** Number of worker tasks */
+#define NUM_WORKERS CONFIG_ACTOR_SCHED_WORKERS
+
+/** Number of pooled priority levels */
+#define NUM_LEVELS CONFIG_ACTOR_SCHED_PRIO_LEVELS
+
+_Static_assert(NUM_LEVELS <= 32, "Ready set is a 32-bit bitmap");
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Worker task and the ready set it owns */
+typedef struct worker_s {
+    TaskHandle_t task;              ///< Worker task
+    uint32_t ready_set;             ///< Bit n set when level n has ready actors
+    actor_t *head[NUM_LEVELS];      ///< First ready actor per level
+    actor_t *tail[NUM_LEVELS];      ///< Last ready actor per level
+    bool idle;                      ///< Worker is waiting for a notification
+} worker_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Append an actor to its home worker's ready list
+ *
+ * Must be called with the scheduler lock held.
+ *
+ * @param me Actor to append
+ */
+static void actor_sched_push(actor_t * const me);
+
+/**
+ * @brief Remove the highest priority ready actor from a worker
+ *
+ * Must be called with the scheduler lock held.
+ *
+ * @param w Worker to take from
+ * @return Ready actor or NULL if the worker's ready set is empty
+ */
+static actor_t *actor_sched_pop(worker_t * const w);
+
+/**
+ * @brief Attach a started queue to an actor and make it runnable on the pool
+ *
+ * @param me Actor to start
+ * @param prio Priority level
+ * @param queue Message queue of the actor
+ * @param queue_length Capacity of the queue
+ * @param home Worker whose ready set holds the actor
+ */
+static void actor_sched_attach(actor_t *const me, uint8_t prio, QueueHandle_t queue,
+                               uint32_t queue_length, uint8_t home);
+
+/**
+ * @brief Take a ready actor from another worker
+ *
+ * Workers on the same core as the thief are tried before those on other
+ * cores: a cross-core steal runs the actor away from its usual core.  Must be
+ * called with the scheduler lock held.
+ *
+ * @param thief Worker whose own ready set is empty
+ * @return Ready actor or NULL if every ready set is empty
+ */
+static actor_t *actor_sched_steal(uint8_t thief);
+
+/**
+ * @brief Find an idle worker to wake
+ *
+ * Prefers `home`, then the workers on the same core.  Must be called with the
+ * scheduler lock held.
+ *
+ * @param home Preferred worker
+ * @return Idle worker or NULL if every worker is busy
+ */
+static worker_t *actor_sched_idle(uint8_t home);
+
+/**
+ * @brief Main loop of a worker task
+ *
+ * @param pdata Worker owning the task
+ */
+static void actor_sched_worker(void *pdata);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Worker tasks */
+static worker_t l_workers[NUM_WORKERS];
+
+/** Protects the ready sets and the scheduling state of pooled actors */
+ACTOR_PORT_LOCK(l_sched_lock);
+
+/** Initialization message queued for every pooled actor */
+static actor_msg_t const l_init_msg = {INIT_SIG};
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_sched_start(uint8_t task_prio, uint32_t stack_size)
+{
+    for (uint8_t i = 0; i < NUM_WORKERS; i++)
+    {
+        worker_t * const w = &l_workers[i];
+        w->idle = false;
+        xTaskCreatePinnedToCore(actor_sched_worker, "actor_worker", stack_size, w, task_prio,
+                                &w->task, actor_worker_core(i));
+    }
+    ESP_LOGI(TAG, "Started %d workers", NUM_WORKERS);
+}
+
+// Described in .h
+void actor_start_pooled(actor_t *const me, uint8_t prio, uint32_t queue_length, uint8_t home)
+{
+    actor_sizing_resize(me, &queue_length, NULL);
+    actor_sched_attach(me, prio, xQueueCreate(queue_length, sizeof(actor_envelope_t)),
+                       queue_length, home);
+}
+
+// Described in .h
+void actor_start_pooled_static(actor_t *const me, uint8_t prio, actor_storage_t const * const storage,
+                               uint8_t home)
+{
+    actor_sched_attach(me, prio,
+                       xQueueCreateStatic(storage->queue_length, sizeof(actor_envelope_t),
+                                          storage->queue_buffer, storage->queue),
+                       storage->queue_length, home);
+}
+
+// Described above
+static void actor_sched_attach(actor_t *const me, uint8_t prio, QueueHandle_t queue,
+                               uint32_t queue_length, uint8_t home)
+{
+    assert(prio < NUM_LEVELS);
+    assert(home < NUM_WORKERS);
+
+    ESP_LOGI(TAG, "Starting pooled actor at %p with dispatch function %p", me, me->dispatch);
+    me->main_task = NULL;
+    me->msg_queue = queue;
+    me->queue_length = queue_length;
+    me->prio = prio;
+    me->home = home;
+    me->pending = 0;
+    me->scheduled = false;
+    me->next_ready = NULL;
+    me->pooled = true;
+    __atomic_store_n(&me->state, ACTOR_STATE_RUNNING, __ATOMIC_SEQ_CST);
+
+    // Initialize on a worker, like any other message
+    actor_post(me, &l_init_msg);
+}
+
+// Described in actor_priv.h
+void actor_sched_ready(actor_t * const me, BaseType_t * const woken)
+{
+    worker_t *wake = NULL;
+
+    ACTOR_PORT_ENTER(&l_sched_lock);
+    me->pending++;
+    if (!me->scheduled)
+    {
+        me->scheduled = true;
+        actor_sched_push(me);
+
+        // Prefer the home worker, then an idle worker on the same core
+        wake = actor_sched_idle(me->home);
+        if (wake != NULL)
+        {
+            wake->idle = false;
+        }
+    }
+    ACTOR_PORT_EXIT(&l_sched_lock);
+
+    if (wake == NULL)
+    {
+        return;
+    }
+
+    if (woken != NULL)
+    {
+        vTaskNotifyGiveFromISR(wake->task, woken);
+    }
+    else
+    {
+        xTaskNotifyGive(wake->task);
+    }
+}
+
+// Described in actor_priv.h
+void actor_sched_drained(actor_t * const me)
+{
+    // Only the message being dispatched is left to account for
+    ACTOR_PORT_ENTER(&l_sched_lock);
+    me->pending = 1;
+    ACTOR_PORT_EXIT(&l_sched_lock);
+}
+
+// Described above
+static actor_t *actor_sched_steal(uint8_t thief)
+{
+    BaseType_t const core = actor_worker_core(thief);
+
+    for (uint8_t pass = 0; pass < 2; pass++)
+    {
+        for (uint8_t i = 0; i < NUM_WORKERS; i++)
+        {
+            if ((actor_worker_core(i) == core) == (pass == 0))
+            {
+                actor_t * const me = actor_sched_pop(&l_workers[i]);
+                if (me != NULL)
+                {
+                    return me;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Described above
+static worker_t *actor_sched_idle(uint8_t home)
+{
+    BaseType_t const core = actor_worker_core(home);
+
+    if (l_workers[home].idle)
+    {
+        return &l_workers[home];
+    }
+
+    for (uint8_t pass = 0; pass < 2; pass++)
+    {
+        for (uint8_t i = 0; i < NUM_WORKERS; i++)
+        {
+            if (l_workers[i].idle && (actor_worker_core(i) == core) == (pass == 0))
+            {
+                return &l_workers[i];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Described above
+static void actor_sched_push(actor_t * const me)
+{
+    worker_t * const w = &l_workers[me->home];
+
+    me->next_ready = NULL;
+    if (w->head[me->prio] == NULL)
+    {
+        w->head[me->prio] = me;
+        w->ready_set |= (uint32_t)1 << me->prio;
+    }
+    else
+    {
+        w->tail[me->prio]->next_ready = me;
+    }
+    w->tail[me->prio] = me;
+}
+
+// Described above
+static actor_t *actor_sched_pop(worker_t * const w)
+{
+    if (w->ready_set == 0)
+    {
+        return NULL;
+    }
+
+    uint8_t const level = 31 - __builtin_clz(w->ready_set);
+    actor_t * const me = w->head[level];
+    w->head[level] = me->next_ready;
+    if (w->head[level] == NULL)
+    {
+        w->ready_set &= ~((uint32_t)1 << level);
+    }
+    me->next_ready = NULL;
+
+    return me;
+}
+
+// Described above
+static void actor_sched_worker(void *pdata)
+{
+    worker_t * const w = (worker_t *)pdata;
+    uint8_t const index = (uint8_t)(w - l_workers);
+
+    while (1)
+    {
+        ACTOR_PORT_ENTER(&l_sched_lock);
+        actor_t *me = actor_sched_pop(w);
+        if (me == NULL)
+        {
+            // Own ready set is empty; steal from the other workers
+            me = actor_sched_steal(index);
+        }
+        if (me == NULL)
+        {
+            w->idle = true;
+        }
+        ACTOR_PORT_EXIT(&l_sched_lock);
+
+        if (me == NULL)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Run one message to completion
+        actor_envelope_t env;
+        if (xQueueReceive(me->msg_queue, &env, 0) == pdTRUE)
+        {
+            actor_dispatch_one(me, &env);
+        }
+
+        ACTOR_PORT_ENTER(&l_sched_lock);
+        me->pending--;
+        if (me->pending > 0)
+        {
+            // Back of its level, so equal priority actors take turns
+            actor_sched_push(me);
+        }
+        else
+        {
+            me->scheduled = false;
+        }
+        if (me->msg_queue == NULL)
+        {
+            // Terminated; the actor belongs to its owner from here on
+            __atomic_store_n(&me->state, ACTOR_STATE_STOPPED, __ATOMIC_SEQ_CST);
+        }
+        ACTOR_PORT_EXIT(&l_sched_lock);
+    }
+}
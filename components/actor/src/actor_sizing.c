@@ -0,0 +1,292 @@
+/**
+ * @file actor_sizing.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Stack and queue sizing from measured use
+ * @version 0.1
+ * @date 2025-01-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_sizing.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <esp_log.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "actor_sizing"
+
+/** Margin added to measured use, in percent */
+#define MARGIN CONFIG_ACTOR_SIZING_MARGIN
+
+/** Recommended stacks are rounded up to this many bytes */
+#define STACK_ALIGN 64u
+
+/** STACK_ALIGN in the unit of stack sizes */
+#define STACK_ALIGN_UNITS ((STACK_ALIGN + ACTOR_PORT_STACK_UNIT - 1) / ACTOR_PORT_STACK_UNIT)
+
+/** Longest line of the generated header */
+#define LINE_SIZE 160
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Add the margin to a measured use
+ *
+ * @param used Measured use
+ * @return used plus MARGIN percent, rounded up
+ */
+static uint32_t actor_sizing_add_margin(uint32_t used);
+
+/**
+ * @brief Find the applied entry of an actor
+ *
+ * @param id Id of the actor
+ * @return Entry or NULL if the actor has none
+ */
+static actor_size_t const *actor_sizing_find(actor_id_t id);
+
+/**
+ * @brief Format a line and pass it to the sink
+ *
+ * @param write Sink
+ * @param ctx Context passed to the sink
+ * @param fmt printf format of the line
+ */
+static void actor_sizing_printf(SizingWriteHandler write, void *ctx, char const *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Sizes applied at start */
+static actor_size_t const *l_table = NULL;
+
+/** Number of entries in l_table */
+static uint16_t l_table_count = 0;
+
+/** Protects l_table and l_table_count */
+ACTOR_PORT_LOCK(l_sizing_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_sizing_measure(actor_t const * const me, actor_size_t * const size)
+{
+    uint16_t const peak = __atomic_load_n(&me->queue_peak, __ATOMIC_RELAXED);
+    size->id = me->actor_id;
+    size->queue_peak = peak;
+    if (peak >= me->queue_length)
+    {
+        // A full queue may have needed more; keep what it had
+        size->queue_length = (uint16_t)me->queue_length;
+    }
+    else
+    {
+        size->queue_length = (uint16_t)actor_sizing_add_margin(peak > 0 ? peak : 1);
+    }
+
+    uint32_t const stack_size = (me->storage != NULL) ? me->storage->stack_size : me->stack_size;
+    TaskHandle_t const task = me->main_task;
+    if (me->pooled)
+    {
+        // Pooled actors run on the workers' stacks
+        size->stack_used = 0;
+        size->stack_size = 0;
+    }
+    else if (actor_is_running(me) && task != NULL)
+    {
+        size->stack_used = stack_size - uxTaskGetStackHighWaterMark(task);
+        uint32_t const stack = actor_sizing_add_margin(size->stack_used);
+        size->stack_size = (stack + STACK_ALIGN_UNITS - 1) / STACK_ALIGN_UNITS * STACK_ALIGN_UNITS;
+    }
+    else
+    {
+        size->stack_used = 0;
+        size->stack_size = stack_size;
+    }
+}
+
+// Described in .h
+void actor_sizing_reset(actor_t * const me)
+{
+    __atomic_store_n(&me->queue_peak, 0, __ATOMIC_RELAXED);
+}
+
+// Described in .h
+uint16_t actor_sizing_emit(SizingWriteHandler write, void *ctx)
+{
+    uint32_t emitted[(CONFIG_ACTOR_MAX_ACTORS + 31) / 32] = { 0 };
+    uint16_t count = 0;
+
+    actor_sizing_printf(write, ctx, "/*\n * Actor sizes measured with a %u%% margin by actor_sizing_emit.\n",
+                        (unsigned)MARGIN);
+    actor_sizing_printf(write, ctx, " * Ids follow the order the actors are constructed in.\n */\n");
+    actor_sizing_printf(write, ctx, "#pragma once\n\n#include \"actor_sizing.h\"\n\n");
+
+    // One entry per actor, each measured once, then the table of entries
+    for (actor_id_t id = 0; id < CONFIG_ACTOR_MAX_ACTORS; id++)
+    {
+        actor_t const * const actor = actor_registry_get(id);
+        if (actor == NULL)
+        {
+            continue;
+        }
+
+        actor_size_t size;
+        actor_sizing_measure(actor, &size);
+        actor_sizing_printf(write, ctx, "#define ACTOR_SIZE_%u_QUEUE_LENGTH %u\n", id, size.queue_length);
+        actor_sizing_printf(write, ctx, "#define ACTOR_SIZE_%u_STACK_SIZE %lu\n", id,
+                            (unsigned long)size.stack_size);
+        actor_sizing_printf(write, ctx,
+                            "#define ACTOR_SIZE_%u { .id = %u, .queue_length = %u, .stack_size = %lu, "
+                            ".queue_peak = %u, .stack_used = %lu }\n\n",
+                            id, id, size.queue_length, (unsigned long)size.stack_size, size.queue_peak,
+                            (unsigned long)size.stack_used);
+        emitted[id / 32] |= 1u << (id % 32);
+        count++;
+    }
+
+    actor_sizing_printf(write, ctx, "#define ACTOR_SIZES_COUNT %u\n\n#define ACTOR_SIZES_INIT { \\\n", count);
+    for (actor_id_t id = 0; id < CONFIG_ACTOR_MAX_ACTORS; id++)
+    {
+        if (emitted[id / 32] & (1u << (id % 32)))
+        {
+            actor_sizing_printf(write, ctx, "    ACTOR_SIZE_%u, \\\n", id);
+        }
+    }
+    actor_sizing_printf(write, ctx, "}\n");
+
+    return count;
+}
+
+// Described in .h
+void actor_sizing_apply(actor_size_t const * const table, uint16_t count)
+{
+    ACTOR_PORT_ENTER(&l_sizing_lock);
+    l_table = table;
+    l_table_count = (table != NULL) ? count : 0;
+    ACTOR_PORT_EXIT(&l_sizing_lock);
+}
+
+// Described in .h
+uint16_t actor_sizing_check(SizingAlarmHandler alarm)
+{
+    uint16_t over = 0;
+
+    for (actor_id_t id = 0; id < CONFIG_ACTOR_MAX_ACTORS; id++)
+    {
+        actor_t * const actor = actor_registry_get(id);
+        actor_size_t const * const profiled = actor_sizing_find(id);
+        if (actor == NULL || profiled == NULL || !actor_is_running(actor))
+        {
+            continue;
+        }
+
+        actor_size_t now;
+        actor_sizing_measure(actor, &now);
+        if (now.stack_used > profiled->stack_used || now.queue_peak > profiled->queue_peak)
+        {
+            ESP_LOGW(TAG, "Actor %u over its profile: stack %lu/%lu, queue %u/%u", id,
+                     (unsigned long)now.stack_used, (unsigned long)profiled->stack_used, now.queue_peak,
+                     profiled->queue_peak);
+            over++;
+            if (alarm != NULL)
+            {
+                alarm(actor, profiled, &now);
+            }
+        }
+    }
+
+    return over;
+}
+
+// Described in actor_priv.h
+void actor_sizing_resize(actor_t const * const me, uint32_t * const queue_length, uint32_t * const stack_size)
+{
+    actor_size_t const * const size = actor_sizing_find(me->actor_id);
+    if (size == NULL)
+    {
+        return;
+    }
+
+    *queue_length = size->queue_length;
+    if (stack_size != NULL && size->stack_size != 0)
+    {
+        *stack_size = size->stack_size;
+    }
+}
+
+// Described above
+static uint32_t actor_sizing_add_margin(uint32_t used)
+{
+    return used + (used * MARGIN + 99) / 100;
+}
+
+// Described above
+static actor_size_t const *actor_sizing_find(actor_id_t id)
+{
+    actor_size_t const *found = NULL;
+
+    ACTOR_PORT_ENTER(&l_sizing_lock);
+    for (uint16_t i = 0; i < l_table_count && found == NULL; i++)
+    {
+        if (l_table[i].id == id)
+        {
+            found = &l_table[i];
+        }
+    }
+    ACTOR_PORT_EXIT(&l_sizing_lock);
+
+    return found;
+}
+
+// Described above
+static void actor_sizing_printf(SizingWriteHandler write, void *ctx, char const *fmt, ...)
+{
+    char line[LINE_SIZE];
+    va_list args;
+
+    va_start(args, fmt);
+    int const len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (len > 0)
+    {
+        write(ctx, line, ((size_t)len < sizeof(line)) ? (size_t)len : sizeof(line) - 1);
+    }
+}
@@ -0,0 +1,308 @@
+/**
+ * @file actor_stats.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for per-actor runtime statistics
+ * @version 0.1
+ * @date 2024-11-18
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_stats.h"
+#include "actor_priv.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <esp_log.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "actor_stats"
+
+#define MAX_SIGNALS CONFIG_ACTOR_STATS_MAX_SIGNALS
+
+#define MAX_ACTORS CONFIG_ACTOR_MAX_ACTORS
+
+/** A sender with 1/PLACEMENT_SHARE of an actor's messages is placed with it */
+#define PLACEMENT_SHARE 4
+
+/** Thread local storage slot holding the actor a task is dispatching */
+#define TLS_INDEX CONFIG_ACTOR_STATS_TLS_INDEX
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Find the group of an actor during placement
+ *
+ * @param i Index of the actor in the list being placed
+ * @return Index of the actor representing the group
+ */
+static uint16_t actor_stats_group(uint16_t i);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Protects the sender tables of all actors */
+ACTOR_PORT_LOCK(l_peer_lock);
+
+/** Group of each actor being placed; a union-find forest */
+static uint16_t l_group[MAX_ACTORS];
+
+/** Dispatch cycles of each group being placed */
+static uint64_t l_load[MAX_ACTORS];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_stats_get(actor_t const * const me, actor_stats_t * const stats)
+{
+    memcpy(stats, &me->stats, sizeof(*stats));
+}
+
+// Described in .h
+void actor_stats_reset(actor_t * const me)
+{
+    memset(&me->stats, 0, sizeof(me->stats));
+}
+
+// Described in .h
+void actor_stats_dump(actor_t const * const me)
+{
+    actor_stats_t stats;
+    actor_stats_get(me, &stats);
+
+    ESP_LOGI(TAG, "actor %u: posted %lu dropped %lu dispatched %lu queue hwm %lu cpu %llu cycles",
+             me->actor_id, (unsigned long)stats.posted, (unsigned long)stats.dropped,
+             (unsigned long)stats.dispatched, (unsigned long)stats.queue_hwm,
+             (unsigned long long)stats.cpu_cycles);
+
+    for (uint8_t i = 0; i < ACTOR_STATS_BUCKETS; i++)
+    {
+        if (stats.latency[i] != 0)
+        {
+            ESP_LOGI(TAG, "  latency < %lu us: %lu", 1UL << i, (unsigned long)stats.latency[i]);
+        }
+    }
+
+    for (uint16_t sig = 0; sig < MAX_SIGNALS; sig++)
+    {
+        if (stats.max_dispatch[sig] != 0)
+        {
+            ESP_LOGI(TAG, "  signal %u: worst dispatch %lu cycles", sig,
+                     (unsigned long)stats.max_dispatch[sig]);
+        }
+    }
+
+    for (uint8_t core = 0; core < ACTOR_PORT_NUM_CORES; core++)
+    {
+        ESP_LOGI(TAG, "  from core %u: %lu", core, (unsigned long)stats.from_core[core]);
+    }
+
+    for (uint8_t i = 0; i < ACTOR_STATS_PEERS; i++)
+    {
+        if (stats.peers[i].posts != 0)
+        {
+            ESP_LOGI(TAG, "  from actor %u: %lu", stats.peers[i].id,
+                     (unsigned long)stats.peers[i].posts);
+        }
+    }
+}
+
+// Described in .h
+void actor_stats_suggest_placement(actor_t * const actors[], BaseType_t cores[], uint16_t count)
+{
+    uint64_t core_load[ACTOR_PORT_NUM_CORES] = { 0 };
+
+    assert(count <= MAX_ACTORS);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        l_group[i] = i;
+        l_load[i] = 0;
+        cores[i] = ACTOR_NO_AFFINITY;
+    }
+
+    // Group every actor with its heavy senders
+    for (uint16_t i = 0; i < count; i++)
+    {
+        actor_stats_t const * const stats = &actors[i]->stats;
+        for (uint8_t k = 0; k < ACTOR_STATS_PEERS; k++)
+        {
+            actor_peer_t const peer = stats->peers[k];
+            if (peer.posts == 0 || (uint64_t)peer.posts * PLACEMENT_SHARE < stats->posted)
+            {
+                continue;
+            }
+
+            for (uint16_t j = 0; j < count; j++)
+            {
+                if (actors[j]->actor_id == peer.id)
+                {
+                    l_group[actor_stats_group(j)] = actor_stats_group(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Idle actors count for a cycle so that they are spread as well
+    for (uint16_t i = 0; i < count; i++)
+    {
+        l_load[actor_stats_group(i)] += actors[i]->stats.cpu_cycles + 1;
+    }
+
+    // Heaviest group first, onto the least loaded core
+    while (1)
+    {
+        uint16_t best = count;
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if (l_group[i] == i && cores[i] == ACTOR_NO_AFFINITY &&
+                (best == count || l_load[i] > l_load[best]))
+            {
+                best = i;
+            }
+        }
+        if (best == count)
+        {
+            break;
+        }
+
+        uint8_t idlest = 0;
+        for (uint8_t core = 1; core < ACTOR_PORT_NUM_CORES; core++)
+        {
+            if (core_load[core] < core_load[idlest])
+            {
+                idlest = core;
+            }
+        }
+        cores[best] = idlest;
+        core_load[idlest] += l_load[best];
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        cores[i] = cores[actor_stats_group(i)];
+    }
+}
+
+// Described above
+static uint16_t actor_stats_group(uint16_t i)
+{
+    while (l_group[i] != i)
+    {
+        // Path halving keeps the trees flat
+        l_group[i] = l_group[l_group[i]];
+        i = l_group[i];
+    }
+
+    return i;
+}
+
+// Described in actor_priv.h
+void actor_stats_latency(actor_t * const me, uint32_t latency_us)
+{
+    uint8_t bucket = (latency_us == 0) ? 0 : (uint8_t)(32 - __builtin_clz(latency_us));
+    if (bucket >= ACTOR_STATS_BUCKETS)
+    {
+        bucket = ACTOR_STATS_BUCKETS - 1;
+    }
+    me->stats.latency[bucket]++;
+}
+
+// Described in actor_priv.h
+void actor_stats_dispatched(actor_t * const me, signal_t sig, uint32_t cycles)
+{
+    __atomic_add_fetch(&me->stats.dispatched, 1, __ATOMIC_RELAXED);
+    me->stats.cpu_cycles += cycles;
+
+    uint16_t const slot = (sig < MAX_SIGNALS) ? sig : MAX_SIGNALS - 1;
+    if (cycles > me->stats.max_dispatch[slot])
+    {
+        me->stats.max_dispatch[slot] = cycles;
+    }
+}
+
+// Described in actor_priv.h
+void actor_stats_sender(actor_t * const me, bool from_isr)
+{
+    uint8_t const core = ACTOR_PORT_CORE_ID();
+    __atomic_add_fetch(&me->stats.from_core[core], 1, __ATOMIC_RELAXED);
+
+    actor_t const * const sender =
+        from_isr ? NULL : pvTaskGetThreadLocalStoragePointer(NULL, TLS_INDEX);
+    if (sender == NULL || sender == me)
+    {
+        return;
+    }
+
+    ACTOR_PORT_ENTER(&l_peer_lock);
+    actor_peer_t *slot = &me->stats.peers[0];
+    for (uint8_t i = 0; i < ACTOR_STATS_PEERS; i++)
+    {
+        actor_peer_t * const peer = &me->stats.peers[i];
+        if (peer->posts != 0 && peer->id == sender->actor_id)
+        {
+            slot = peer;
+            break;
+        }
+        if (peer->posts < slot->posts)
+        {
+            slot = peer;
+        }
+    }
+    // An unknown sender takes over the least busy entry and its count
+    slot->id = sender->actor_id;
+    slot->posts++;
+    ACTOR_PORT_EXIT(&l_peer_lock);
+}
+
+// Described in actor_priv.h
+actor_t *actor_stats_enter(actor_t * const me)
+{
+    // Only the task itself reads or writes its slot, so no lock is needed
+    actor_t * const prev = pvTaskGetThreadLocalStoragePointer(NULL, TLS_INDEX);
+    vTaskSetThreadLocalStoragePointer(NULL, TLS_INDEX, me);
+
+    return prev;
+}
+
+// Described in actor_priv.h
+void actor_stats_leave(actor_t * const prev)
+{
+    vTaskSetThreadLocalStoragePointer(NULL, TLS_INDEX, prev);
+}
@@ -0,0 +1,207 @@
+/**
+ * @file actor_supervisor.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for supervising child actors and restarting them on failure
+ * @version 0.1
+ * @date 2024-12-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_supervisor.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+
+#include <stddef.h>
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "actor_supervisor"
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Look for hung children and create killed ones again
+ *
+ * @param me Supervisor
+ */
+static void actor_supervisor_check(actor_t * const me);
+
+/**
+ * @brief Restart children after one of them failed, as the strategy says
+ *
+ * @param me Supervisor
+ * @param failed Child that failed or hung
+ */
+static void actor_supervisor_recover(actor_t * const me, actor_t * const failed);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_supervise(actor_t * const me, actor_supervisor_t * const sup, actor_strategy_t strategy,
+                     uint32_t period)
+{
+    sup->strategy = (uint8_t)strategy;
+    sup->restarts = 0;
+    time_event_ctor(&sup->check, WATCHDOG_SIG, me);
+    me->supervisor = sup;
+
+    time_event_arm(&sup->check, period, period);
+}
+
+// Described in .h
+void actor_set_watchdog(actor_t * const me, uint32_t timeout)
+{
+    me->watchdog = timeout;
+}
+
+// Described in .h
+void actor_set_killable(actor_t * const me, bool killable)
+{
+    me->killable = killable;
+}
+
+// Described in .h
+void actor_fail(actor_t * const me)
+{
+    actor_notify_exit(me, ACTOR_EXIT_FAILED, NULL);
+}
+
+// Described in .h
+void actor_fail_from_isr(actor_t * const me, BaseType_t * const woken)
+{
+    actor_notify_exit(me, ACTOR_EXIT_FAILED, woken);
+}
+
+// Described in .h
+actor_t *actor_from_task(TaskHandle_t task)
+{
+    for (actor_id_t id = 0; id < CONFIG_ACTOR_MAX_ACTORS; id++)
+    {
+        actor_t * const me = actor_registry_get(id);
+        if (me != NULL && !me->pooled && me->main_task == task)
+        {
+            return me;
+        }
+    }
+
+    return NULL;
+}
+
+// Described in actor_priv.h
+bool actor_supervisor_handle(actor_t * const me, actor_msg_t const * const msg)
+{
+    if (msg == &me->supervisor->check.super)
+    {
+        actor_supervisor_check(me);
+        return true;
+    }
+
+    if (msg->sig == CHILD_EXIT_SIG)
+    {
+        actor_exit_t const * const exit = (actor_exit_t const *)msg;
+        if (exit->reason != ACTOR_EXIT_NORMAL && exit->child->parent == me)
+        {
+            actor_supervisor_recover(me, exit->child);
+        }
+    }
+
+    // The dispatch handler sees every exit
+    return false;
+}
+
+// Described above
+static void actor_supervisor_check(actor_t * const me)
+{
+    TickType_t const now = xTaskGetTickCount();
+
+    for (actor_t *child = me->first_child; child != NULL; child = child->next_sibling)
+    {
+        if (child->respawn)
+        {
+            // Killed on an earlier check; the kernel is done with its task by now
+            actor_respawn(child);
+            me->supervisor->restarts++;
+            continue;
+        }
+
+        if (child->watchdog == 0 || !__atomic_load_n(&child->dispatching, __ATOMIC_ACQUIRE) ||
+            (TickType_t)(now - child->dispatch_start) < child->watchdog)
+        {
+            continue;
+        }
+
+        if (child->pooled || !child->killable)
+        {
+            // Workers and unkillable tasks keep their dispatch; report it once and
+            // restart them through their queue
+            ESP_LOGE(TAG, "Actor %u hung", child->actor_id);
+            __atomic_store_n(&child->dispatching, false, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Killing hung actor %u", child->actor_id);
+            actor_kill(child);
+        }
+        actor_notify_exit(child, ACTOR_EXIT_HUNG, NULL);
+    }
+}
+
+// Described above
+static void actor_supervisor_recover(actor_t * const me, actor_t * const failed)
+{
+    actor_supervisor_t * const sup = me->supervisor;
+
+    for (actor_t *child = me->first_child; child != NULL; child = child->next_sibling)
+    {
+        if (child != failed && sup->strategy == ACTOR_RESTART_ONE_FOR_ONE)
+        {
+            continue;
+        }
+
+        // Killed children are created again by the next check instead
+        if (actor_restart(child) == ESP_OK)
+        {
+            sup->restarts++;
+        }
+    }
+}
@@ -0,0 +1,150 @@
+/**
+ * @file actor_trace.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for the binary actor event trace recorder
+ * @version 0.1
+ * @date 2024-11-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "actor_trace.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Records per core; must be a power of two */
+#define TRACE_RECORDS CONFIG_ACTOR_TRACE_BUFFER_RECORDS
+
+#define TRACE_MASK (TRACE_RECORDS - 1)
+
+_Static_assert((TRACE_RECORDS & TRACE_MASK) == 0, "Trace buffer size must be a power of two");
+
+/** Records written per frame while draining */
+#define DRAIN_CHUNK 64
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Trace buffer owned by one core */
+typedef struct trace_ring_s {
+    uint32_t head;              ///< Next record to write; owned by the core
+    uint32_t tail;              ///< Next record to drain; owned by the drainer
+    uint32_t last;              ///< Cycle count of the previous record
+    uint32_t lost;              ///< Records dropped since the last frame
+    actor_trace_record_t records[TRACE_RECORDS];
+} trace_ring_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** One ring per core, so recording never contends across cores */
+static trace_ring_t l_rings[ACTOR_PORT_NUM_CORES];
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in actor_priv.h
+void actor_trace_record(uint8_t type, actor_id_t actor, signal_t sig)
+{
+    // With interrupts masked nothing else can write this core's ring
+    uint32_t const irq = ACTOR_PORT_IRQ_MASK();
+    trace_ring_t * const ring = &l_rings[ACTOR_PORT_CORE_ID()];
+    uint32_t const now = ACTOR_PORT_CYCLES();
+    uint32_t const head = ring->head;
+
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= TRACE_RECORDS)
+    {
+        ring->lost++;
+    }
+    else
+    {
+        actor_trace_record_t * const r = &ring->records[head & TRACE_MASK];
+        r->delta = now - ring->last;
+        r->sig = sig;
+        r->actor = (actor < ACTOR_TRACE_NO_ACTOR) ? (uint8_t)actor : ACTOR_TRACE_NO_ACTOR;
+        r->type = type;
+        ring->last = now;
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    ACTOR_PORT_IRQ_UNMASK(irq);
+}
+
+// Described in .h
+uint32_t actor_trace_drain(TraceWriteHandler write, void *ctx)
+{
+    uint32_t total = 0;
+
+    for (uint8_t core = 0; core < ACTOR_PORT_NUM_CORES; core++)
+    {
+        trace_ring_t * const ring = &l_rings[core];
+        uint32_t tail = ring->tail;
+        uint32_t const head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        while (tail != head)
+        {
+            // Never cross the end of the ring within one frame
+            uint32_t count = head - tail;
+            uint32_t const to_end = TRACE_RECORDS - (tail & TRACE_MASK);
+            if (count > to_end)
+            {
+                count = to_end;
+            }
+            if (count > DRAIN_CHUNK)
+            {
+                count = DRAIN_CHUNK;
+            }
+
+            actor_trace_frame_t const frame = {
+                .magic = ACTOR_TRACE_MAGIC,
+                .version = ACTOR_TRACE_VERSION,
+                .core = core,
+                .count = (uint16_t)count,
+                .lost = __atomic_exchange_n(&ring->lost, 0, __ATOMIC_RELAXED),
+                .cpu_hz = ACTOR_PORT_CYCLES_HZ(),
+            };
+            write(ctx, &frame, sizeof(frame));
+            write(ctx, &ring->records[tail & TRACE_MASK], count * sizeof(actor_trace_record_t));
+
+            tail += count;
+            total += count;
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+        }
+    }
+
+    return total;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file event_pool.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for pooled, reference-counted events
+ * @version 0.1
+ * @date 2024-10-14
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "event_pool.h"
+#include "actor_port.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <sdkconfig.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Maximum number of event pools */
+#define MAX_NUMBER_POOLS CONFIG_ACTOR_MAX_EVENT_POOLS
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/** Link stored in the first bytes of every free block */
+typedef struct free_block_s {
+    struct free_block_s *next;
+} free_block_t;
+
+/** Fixed block-size event pool */
+typedef struct event_pool_s {
+    free_block_t *free_list;    ///< Head of the list of free blocks
+    uint16_t block_size;        ///< Size of each block in bytes
+    uint16_t num_free;          ///< Number of blocks currently free
+    uint16_t min_free;          ///< Low-water mark of free blocks
+} event_pool_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Registered pools in ascending block size */
+static event_pool_t l_pool[MAX_NUMBER_POOLS];
+
+/** Number of registered pools */
+static uint8_t l_num_pools = 0;
+
+/** Protects the free lists and event reference counts */
+ACTOR_PORT_LOCK(l_pool_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void event_pool_init(void * const storage, uint32_t storage_size, uint16_t block_size)
+{
+    assert(l_num_pools < MAX_NUMBER_POOLS);
+    assert(block_size >= sizeof(free_block_t));
+    // Pools are searched in order, so they must be registered smallest first
+    assert(l_num_pools == 0 || l_pool[l_num_pools - 1].block_size < block_size);
+
+    event_pool_t * const pool = &l_pool[l_num_pools];
+    uint16_t const num_blocks = (uint16_t)(storage_size / block_size);
+
+    // Thread every block onto the free list
+    pool->free_list = NULL;
+    uint8_t *block = (uint8_t *)storage + (uint32_t)(num_blocks - 1) * block_size;
+    for (uint16_t i = 0; i < num_blocks; i++)
+    {
+        free_block_t * const fb = (free_block_t *)block;
+        fb->next = pool->free_list;
+        pool->free_list = fb;
+        block -= block_size;
+    }
+
+    pool->block_size = block_size;
+    pool->num_free = num_blocks;
+    pool->min_free = num_blocks;
+    l_num_pools++;
+}
+
+// Described in .h
+actor_msg_t *event_new(uint16_t size, signal_t sig)
+{
+    // Find the smallest pool that can hold the event
+    uint8_t pool_num = 0;
+    while (pool_num < l_num_pools && l_pool[pool_num].block_size < size)
+    {
+        pool_num++;
+    }
+
+    if (pool_num == l_num_pools)
+    {
+        // No pool is large enough for this event
+        return NULL;
+    }
+
+    event_pool_t * const pool = &l_pool[pool_num];
+
+    ACTOR_PORT_ENTER(&l_pool_lock);
+    free_block_t * const fb = pool->free_list;
+    if (fb != NULL)
+    {
+        pool->free_list = fb->next;
+        pool->num_free--;
+        if (pool->num_free < pool->min_free)
+        {
+            pool->min_free = pool->num_free;
+        }
+    }
+    ACTOR_PORT_EXIT(&l_pool_lock);
+
+    if (fb == NULL)
+    {
+        return NULL;
+    }
+
+    actor_msg_t * const msg = (actor_msg_t *)fb;
+    msg->sig = sig;
+    msg->pool_id = pool_num + 1;
+    msg->ref_count = 0;
+
+    return msg;
+}
+
+// Described in .h
+void event_ref(actor_msg_t const * const msg)
+{
+    if (msg->pool_id == 0)
+    {
+        // Static events are not reference counted
+        return;
+    }
+
+    ACTOR_PORT_ENTER(&l_pool_lock);
+    assert(msg->ref_count < UINT16_MAX);
+    ((actor_msg_t *)msg)->ref_count++;
+    ACTOR_PORT_EXIT(&l_pool_lock);
+}
+
+// Described in .h
+void event_gc(actor_msg_t const * const msg)
+{
+    if (msg->pool_id == 0)
+    {
+        // Static events are never returned to a pool
+        return;
+    }
+
+    assert(msg->pool_id <= l_num_pools);
+    event_pool_t * const pool = &l_pool[msg->pool_id - 1];
+    actor_msg_t * const m = (actor_msg_t *)msg;
+
+    ACTOR_PORT_ENTER(&l_pool_lock);
+    if (m->ref_count > 1)
+    {
+        // Other references remain
+        m->ref_count--;
+    }
+    else
+    {
+        // Last reference - give the block back
+        free_block_t * const fb = (free_block_t *)m;
+        fb->next = pool->free_list;
+        pool->free_list = fb;
+        pool->num_free++;
+    }
+    ACTOR_PORT_EXIT(&l_pool_lock);
+}
+
+// Described in .h
+uint16_t event_pool_get_min_free(uint8_t pool_id)
+{
+    if (pool_id == 0 || pool_id > l_num_pools)
+    {
+        return 0;
+    }
+
+    return l_pool[pool_id - 1].min_free;
+}
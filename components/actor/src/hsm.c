@@ -0,0 +1,253 @@
+/**
+ * @file hsm.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for table-driven hierarchical state machines
+ * @version 0.1
+ * @date 2024-11-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "hsm.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Find the state where the exits of a transition stop
+ *
+ * Transitions to the source itself or to one of its ancestors leave and
+ * re-enter the target.  Transitions to a substate of the source do not exit
+ * the source.
+ *
+ * @param source State declaring the transition
+ * @param target Target state
+ * @return Innermost state that stays active or NULL for the top level
+ */
+static hsm_state_t const *hsm_lca(hsm_state_t const *source, hsm_state_t const *target);
+
+/**
+ * @brief Compute the states entered when entering `target` from `lca`
+ *
+ * Includes the initial substates below the target.
+ *
+ * @param path Path to fill in
+ * @param lca Innermost state that stays active or NULL for the top level
+ * @param target Target state
+ */
+static void hsm_build_path(hsm_path_t * const path, hsm_state_t const *lca, hsm_state_t const *target);
+
+/**
+ * @brief Run the entry actions of a cached path and make its last state current
+ *
+ * @param me State machine instance
+ * @param path Cached path
+ */
+static void hsm_enter(hsm_t * const me, hsm_path_t const * const path);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void hsm_init(hsm_t * const me, hsm_def_t const * const def, hsm_path_t * const paths, actor_t *actor)
+{
+    me->def = def;
+    me->paths = paths;
+    me->state = NULL;
+    me->actor = actor;
+
+    for (uint8_t id = 0; id < def->num_states; id++)
+    {
+        hsm_state_t const * const s = def->states[id];
+        assert(s->id == id);
+        assert(s->first + s->count <= def->num_transitions);
+
+        for (uint16_t i = s->first; i < s->first + s->count; i++)
+        {
+            hsm_state_t const * const target = def->transitions[i].target;
+            if (target != NULL)
+            {
+                hsm_build_path(&paths[i], hsm_lca(s, target), target);
+            }
+        }
+    }
+}
+
+// Described in .h
+void hsm_dispatch(hsm_t * const me, actor_msg_t const * const msg)
+{
+    hsm_def_t const * const def = me->def;
+
+    if (msg->sig == INIT_SIG)
+    {
+        // Enter the initial configuration from the top
+        hsm_path_t path;
+        hsm_build_path(&path, NULL, def->initial);
+        hsm_enter(me, &path);
+        return;
+    }
+
+    for (hsm_state_t const *s = me->state; s != NULL; s = s->parent)
+    {
+        for (uint16_t i = s->first; i < s->first + s->count; i++)
+        {
+            hsm_transition_t const * const t = &def->transitions[i];
+            if (t->sig != msg->sig || (t->guard != NULL && !t->guard(me, msg)))
+            {
+                continue;
+            }
+
+            if (t->target == NULL)
+            {
+                // Internal transition
+                if (t->action != NULL)
+                {
+                    t->action(me, msg);
+                }
+                return;
+            }
+
+            // Exit from the current leaf up to the cached boundary
+            hsm_path_t const * const path = &me->paths[i];
+            hsm_state_t const * const lca = (path->lca == HSM_TOP) ? NULL : def->states[path->lca];
+            for (hsm_state_t const *x = me->state; x != lca; x = x->parent)
+            {
+                if (x->exit != NULL)
+                {
+                    x->exit(me);
+                }
+            }
+
+            if (t->action != NULL)
+            {
+                t->action(me, msg);
+            }
+
+            hsm_enter(me, path);
+            return;
+        }
+    }
+}
+
+// Described in .h
+bool hsm_is_in(hsm_t const * const me, hsm_state_t const * const state)
+{
+    for (hsm_state_t const *s = me->state; s != NULL; s = s->parent)
+    {
+        if (s == state)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Described above
+static hsm_state_t const *hsm_lca(hsm_state_t const *source, hsm_state_t const *target)
+{
+    if (source == target)
+    {
+        // Self transition
+        return source->parent;
+    }
+
+    for (hsm_state_t const *a = source; a != NULL; a = a->parent)
+    {
+        for (hsm_state_t const *b = target; b != NULL; b = b->parent)
+        {
+            if (a == b)
+            {
+                return (a == target) ? target->parent : a;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Described above
+static void hsm_build_path(hsm_path_t * const path, hsm_state_t const *lca, hsm_state_t const *target)
+{
+    // Walk up from the target, filling the path from its far end
+    uint8_t depth = 0;
+    for (hsm_state_t const *s = target; s != lca; s = s->parent)
+    {
+        assert(s != NULL);
+        assert(depth < HSM_MAX_DEPTH);
+        path->entry[HSM_MAX_DEPTH - 1 - depth] = s->id;
+        depth++;
+    }
+    for (uint8_t i = 0; i < depth; i++)
+    {
+        path->entry[i] = path->entry[HSM_MAX_DEPTH - depth + i];
+    }
+
+    // Then drill down through the initial substates
+    for (hsm_state_t const *s = target->initial; s != NULL; s = s->initial)
+    {
+        assert(s->parent != NULL);
+        assert(depth < HSM_MAX_DEPTH);
+        path->entry[depth] = s->id;
+        depth++;
+    }
+
+    path->lca = (lca == NULL) ? HSM_TOP : lca->id;
+    path->num_entry = depth;
+}
+
+// Described above
+static void hsm_enter(hsm_t * const me, hsm_path_t const * const path)
+{
+    hsm_def_t const * const def = me->def;
+
+    for (uint8_t i = 0; i < path->num_entry; i++)
+    {
+        hsm_state_t const * const s = def->states[path->entry[i]];
+        if (s->entry != NULL)
+        {
+            s->entry(me);
+        }
+        me->state = s;
+    }
+}
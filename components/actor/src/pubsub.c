@@ -0,0 +1,149 @@
+/**
+ * @file pubsub.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Implementation for publish-subscribe messaging
+ * @version 0.1
+ * @date 2024-11-11
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pubsub.h"
+#include "actor_priv.h"
+#include "actor_port.h"
+#include "event_pool.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Subscriber list per signal */
+static actor_subscr_list_t *l_subscr = NULL;
+
+/** Number of signals with a subscriber list */
+static signal_t l_max_signal = 0;
+
+/** Protects the subscriber lists */
+ACTOR_PORT_LOCK(l_subscr_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void actor_pubsub_init(actor_subscr_list_t * const storage, signal_t max_signal)
+{
+    memset(storage, 0, sizeof(actor_subscr_list_t) * max_signal);
+    l_subscr = storage;
+    l_max_signal = max_signal;
+}
+
+// Described in .h
+void actor_subscribe(actor_t const * const me, signal_t sig)
+{
+    assert(sig < l_max_signal);
+
+    ACTOR_PORT_ENTER(&l_subscr_lock);
+    l_subscr[sig].bits[me->actor_id / 32] |= (uint32_t)1 << (me->actor_id % 32);
+    ACTOR_PORT_EXIT(&l_subscr_lock);
+}
+
+// Described in .h
+void actor_unsubscribe(actor_t const * const me, signal_t sig)
+{
+    assert(sig < l_max_signal);
+
+    ACTOR_PORT_ENTER(&l_subscr_lock);
+    l_subscr[sig].bits[me->actor_id / 32] &= ~((uint32_t)1 << (me->actor_id % 32));
+    ACTOR_PORT_EXIT(&l_subscr_lock);
+}
+
+// Described in .h
+void actor_unsubscribe_all(actor_t const * const me)
+{
+    ACTOR_PORT_ENTER(&l_subscr_lock);
+    for (signal_t sig = 0; sig < l_max_signal; sig++)
+    {
+        l_subscr[sig].bits[me->actor_id / 32] &= ~((uint32_t)1 << (me->actor_id % 32));
+    }
+    ACTOR_PORT_EXIT(&l_subscr_lock);
+}
+
+// Described in .h
+void actor_publish(actor_msg_t const * const msg)
+{
+    assert(msg->sig < l_max_signal);
+
+    // Work on a snapshot so that (un)subscribing during the fan-out is safe
+    ACTOR_PORT_ENTER(&l_subscr_lock);
+    actor_subscr_list_t const subscribers = l_subscr[msg->sig];
+    ACTOR_PORT_EXIT(&l_subscr_lock);
+
+    // Hold a reference so an early subscriber cannot free the message mid fan-out
+    event_ref(msg);
+
+    for (uint8_t word = 0; word < PUBSUB_WORDS; word++)
+    {
+        uint32_t bits = subscribers.bits[word];
+        while (bits != 0)
+        {
+            uint32_t const bit = bits & -bits;
+            actor_id_t const id = (actor_id_t)(word * 32 + __builtin_ctz(bits));
+
+            // The id may have been released and reused since the snapshot;
+            // actor_dtor unsubscribes before releasing it, so a bit still set
+            // belongs to the actor registered under the id now
+            ACTOR_PORT_ENTER(&l_subscr_lock);
+            actor_t * const subscriber =
+                ((l_subscr[msg->sig].bits[word] & bit) != 0) ? actor_registry_get(id) : NULL;
+            ACTOR_PORT_EXIT(&l_subscr_lock);
+
+            if (subscriber != NULL)
+            {
+                actor_post(subscriber, msg);
+            }
+            bits &= ~bit;
+        }
+    }
+
+    event_gc(msg);
+}
@@ -32,15 +32,40 @@
  */
 
 #include "time_event.h"
+#include "actor_port.h"
+#include "actor_priv.h"
 
 #include <assert.h>
+#include <stddef.h>
+
+#include <sdkconfig.h>
 
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
 
-/** Maximum number of time event objects */
-#define MAX_NUMBER_EVENTS 10
+/** Number of bits of the expiry tick resolved by each wheel level */
+#define WHEEL_BITS CONFIG_ACTOR_TIME_WHEEL_BITS
+
+/** Number of levels in the timing wheel */
+#define WHEEL_LEVELS CONFIG_ACTOR_TIME_WHEEL_LEVELS
+
+/** Number of slots per wheel level */
+#define WHEEL_SLOTS (1u << WHEEL_BITS)
+
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+
+/** Longest delay the wheel can hold without re-cascading */
+#define WHEEL_MAX_DELAY ((uint32_t)(((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1))
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+/** Number of entries in the deferred post ring; must be a power of two */
+#define RING_SIZE CONFIG_ACTOR_TIME_EVENT_RING_SIZE
+
+#define RING_MASK (RING_SIZE - 1)
+
+_Static_assert((RING_SIZE & RING_MASK) == 0, "Time event ring size must be a power of two");
+#endif
 
 /*******************************************************************************
  * Type Definitions
@@ -50,15 +75,100 @@
  * Function Prototypes
  ******************************************************************************/
 
+/**
+ * @brief Hand an expired timer's event to its actor
+ *
+ * @param t Expired timer
+ * @param woken Accumulates whether a higher priority task was unblocked
+ */
+static void time_event_fire(time_event_t * const t, BaseType_t * const woken);
+
+/**
+ * @brief Process one tick: cascade if level 0 wrapped and fire expiring timers
+ *
+ * @param woken Accumulates whether a higher priority task was unblocked
+ */
+static void time_event_step(BaseType_t * const woken);
+
+/**
+ * @brief Choose the tick a timer fires on within its slack window
+ *
+ * Must be called with the wheel lock held.
+ *
+ * @param t Timer whose nominal expiry is set
+ * @return Tick between the nominal expiry and the end of the slack window
+ */
+static uint32_t time_event_place(time_event_t const * const t);
+
+/**
+ * @brief Place an armed timer in the wheel slot matching its expiry
+ *
+ * Must be called with the wheel lock held.
+ *
+ * @param t Timer to insert
+ */
+static void time_event_insert(time_event_t * const t);
+
+/**
+ * @brief Remove a timer from whichever slot list holds it
+ *
+ * Must be called with the wheel lock held.
+ *
+ * @param t Timer to remove
+ */
+static void time_event_unlink(time_event_t * const t);
+
+/**
+ * @brief Re-insert all timers of a higher level slot into lower levels
+ *
+ * Must be called with the wheel lock held.
+ *
+ * @param level Wheel level of the slot
+ * @param index Slot index within the level
+ */
+static void time_event_cascade(uint8_t level, uint32_t index);
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+/**
+ * @brief Task that posts the events queued by the tick hook
+ *
+ * @param pdata Unused
+ */
+static void time_event_drain(void *pdata);
+#endif
+
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 
-/** Static array of time event objects */
-static time_event_t *l_time_event[MAX_NUMBER_EVENTS];
+/** Slot lists of the timing wheel */
+static time_event_t *l_wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+/** Next tick to be processed */
+static uint32_t l_now = 0;
+
+/** Ticks the next time_event_tick processes on top of its own */
+static uint32_t l_missed = 0;
+
+/** Protects the wheel against concurrent arm/disarm and tick */
+ACTOR_PORT_LOCK(l_wheel_lock);
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+/** Expired timers waiting to be posted; written only by the tick hook */
+static time_event_t *l_ring[RING_SIZE];
+
+/** Next ring slot to write; owned by the tick hook */
+static uint32_t l_ring_head = 0;
+
+/** Next ring slot to read; owned by the drain task */
+static uint32_t l_ring_tail = 0;
 
-/** Number of registered time event objects */
-static uint8_t l_num_events = 0;
+/** Number of expirations lost because the ring was full */
+static uint32_t l_ring_overruns = 0;
+
+/** Task posting the queued events */
+static TaskHandle_t l_drain_task = NULL;
+#endif
 
 /*******************************************************************************
  * Function Definitions
@@ -68,50 +178,357 @@ static uint8_t l_num_events = 0;
 void time_event_ctor(time_event_t * const me, signal_t sig, actor_t *actor)
 {
     me->super.sig = sig;
+    me->super.pool_id = 0;
+    me->super.ref_count = 0;
     me->actor = actor;
-    me->timeout = 0;
+    me->next = NULL;
+    me->pprev = NULL;
+    me->expiry = 0;
     me->interval = 0;
+    me->due = 0;
+    me->slack = 0;
+}
+
+// Described in .h
+void time_event_init(void)
+{
+    // The tick back end needs no setup
+}
 
-    assert(l_num_events < sizeof(l_time_event)/sizeof(l_time_event[0]));
-    l_time_event[l_num_events] = me;
-    l_num_events++;
+// Described in .h
+void time_event_arm_us(time_event_t *const me, uint64_t timeout, uint64_t interval)
+{
+    uint64_t const tick_us = (uint64_t)portTICK_PERIOD_MS * 1000;
+
+    time_event_arm(me, (uint32_t)((timeout + tick_us - 1) / tick_us),
+                   (uint32_t)((interval + tick_us - 1) / tick_us));
 }
 
 // Described in .h
 void time_event_arm(time_event_t *const me, uint32_t timeout, uint32_t interval)
 {
-    me->timeout = timeout;
+    ACTOR_PORT_ENTER(&l_wheel_lock);
+    time_event_unlink(me);
     me->interval = interval;
+    if (timeout > 0)
+    {
+        // A timeout of 1 expires on the next tick processed
+        me->due = l_now + timeout - 1;
+        me->expiry = time_event_place(me);
+        time_event_insert(me);
+    }
+    ACTOR_PORT_EXIT(&l_wheel_lock);
 }
 
 // Described in .h
-void time_event_disarm(time_event_t *const me)
+void time_event_set_slack(time_event_t * const me, uint32_t slack)
 {
-    me->timeout = 0;
+    ACTOR_PORT_ENTER(&l_wheel_lock);
+    me->slack = slack;
+    ACTOR_PORT_EXIT(&l_wheel_lock);
+}
+
+// Described in .h
+void time_event_set_slack_us(time_event_t * const me, uint64_t slack)
+{
+    time_event_set_slack(me, (uint32_t)(slack / ((uint64_t)portTICK_PERIOD_MS * 1000)));
+}
+
+// Described in .h
+bool time_event_disarm(time_event_t *const me)
+{
+    ACTOR_PORT_ENTER(&l_wheel_lock);
+    bool const armed = (me->pprev != NULL);
+    time_event_unlink(me);
+    ACTOR_PORT_EXIT(&l_wheel_lock);
+
+    return armed;
+}
+
+// Described in .h
+bool time_event_armed(time_event_t const * const me)
+{
+    ACTOR_PORT_ENTER(&l_wheel_lock);
+    bool const armed = (me->pprev != NULL);
+    ACTOR_PORT_EXIT(&l_wheel_lock);
+
+    return armed;
 }
 
 // Described in .h
 void time_event_tick(void)
 {
-    // Loop through all registered timers
-    for (uint8_t current_timer = 0; current_timer < l_num_events; current_timer++)
+    BaseType_t woken = pdFALSE;
+
+    // Catch up with ticks that were not delivered, e.g. during light sleep
+    uint32_t ticks = __atomic_exchange_n(&l_missed, 0, __ATOMIC_RELAXED) + 1;
+    while (ticks-- > 0)
+    {
+        time_event_step(&woken);
+    }
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+    if (l_drain_task != NULL && l_ring_head != l_ring_tail)
+    {
+        // One notification covers every expiry queued this tick
+        vTaskNotifyGiveFromISR(l_drain_task, &woken);
+    }
+#endif
+
+    // Single yield for all posts made during this tick
+    portYIELD_FROM_ISR(woken);
+}
+
+// Described in .h
+void time_event_add_ticks(uint32_t ticks)
+{
+    __atomic_add_fetch(&l_missed, ticks, __ATOMIC_RELAXED);
+}
+
+// Described in .h
+uint64_t time_event_next_expiry_us(void)
+{
+    uint32_t ticks = UINT32_MAX;
+
+    ACTOR_PORT_ENTER(&l_wheel_lock);
+    for (uint8_t level = 0; level < WHEEL_LEVELS; level++)
     {
-        time_event_t * const t = l_time_event[current_timer];
-        assert(t);
+        uint8_t const shift = level * WHEEL_BITS;
+        uint32_t const position = l_now >> shift;
 
-        if (t->timeout > 0)
+        // Level 0 slots hold exactly one tick each; higher slots span several
+        // ticks, so their first tick is only a lower bound
+        for (uint32_t k = (level == 0) ? 0 : 1; k <= WHEEL_SLOTS; k++)
         {
-            // Timer is currently armed
-            if (--t->timeout == 0)
+            if (l_wheel[level][(position + k) & WHEEL_MASK] != NULL)
             {
-                // Timer expired this tick - fire event
-                actor_post(t->actor, &t->super);
+                uint32_t const delay = ((position + k) << shift) - l_now;
+                if (delay < ticks)
+                {
+                    ticks = delay;
+                }
+                break;
+            }
+        }
+    }
+    uint32_t const missed = __atomic_load_n(&l_missed, __ATOMIC_RELAXED);
+    ACTOR_PORT_EXIT(&l_wheel_lock);
 
-                // Rearm if configured for this
-                t->timeout = t->interval;
+    if (ticks == UINT32_MAX)
+    {
+        return UINT64_MAX;
+    }
+
+    // Ticks added but not yet processed have already elapsed
+    ticks = (ticks > missed) ? ticks - missed : 0;
+
+    // A delay of 0 expires on the next tick processed
+    return (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+// Described above
+static void time_event_step(BaseType_t * const woken)
+{
+    ACTOR_PORT_ENTER(&l_wheel_lock);
+    uint32_t const index = l_now & WHEEL_MASK;
+    if (index == 0)
+    {
+        // Level 0 wrapped; pull the next span of timers down from above
+        for (uint8_t level = 1; level < WHEEL_LEVELS; level++)
+        {
+            uint32_t const upper = (l_now >> (level * WHEEL_BITS)) & WHEEL_MASK;
+            time_event_cascade(level, upper);
+            if (upper != 0)
+            {
+                break;
             }
         }
+    }
+
+    // Detach the timers expiring this tick so that posting happens unlocked
+    time_event_t *expired = l_wheel[0][index];
+    l_wheel[0][index] = NULL;
+    if (expired != NULL)
+    {
+        expired->pprev = &expired;
+    }
+    l_now++;
+    ACTOR_PORT_EXIT(&l_wheel_lock);
+
+    while (1)
+    {
+        ACTOR_PORT_ENTER(&l_wheel_lock);
+        time_event_t * const t = expired;
+        if (t != NULL)
+        {
+            time_event_unlink(t);
+            if (t->interval > 0)
+            {
+                // Rearm relative to the nominal expiry, however late this one fired
+                t->due += t->interval;
+                t->expiry = time_event_place(t);
+                time_event_insert(t);
+            }
+        }
+        ACTOR_PORT_EXIT(&l_wheel_lock);
+
+        if (t == NULL)
+        {
+            break;
+        }
+
+        // Timer expired this tick - fire event
+        actor_trace_record(ACTOR_TRACE_TIMER, t->actor->actor_id, t->super.sig);
+        time_event_fire(t, woken);
+    }
+}
+
+// Described above
+static uint32_t time_event_place(time_event_t const * const t)
+{
+    uint32_t const first = ((int32_t)(t->due - l_now) < 0) ? l_now : t->due;
+    uint32_t const last = t->due + t->slack;
+
+    if ((int32_t)(last - first) <= 0)
+    {
+        // No slack, or the whole window has already passed
+        return first;
+    }
+
+    if (last - l_now < WHEEL_SLOTS)
+    {
+        // Join the earliest tick of the window that already fires timers
+        for (uint32_t tick = first; tick != last + 1; tick++)
+        {
+            if (l_wheel[0][tick & WHEEL_MASK] != NULL)
+            {
+                return tick;
+            }
+        }
+    }
+
+    // Clear the low bits in which first and last differ; stays within the window
+    uint32_t const mask = (1u << (31 - __builtin_clz(first ^ last))) - 1;
+
+    return last & ~mask;
+}
+
+// Described above
+static void time_event_insert(time_event_t * const t)
+{
+    uint32_t const delay = t->expiry - l_now;
+    uint32_t position = t->expiry;
+    uint8_t level = 0;
+
+    if (delay > WHEEL_MAX_DELAY)
+    {
+        // Beyond the wheel's reach; park in the furthest slot and re-cascade
+        position = l_now + WHEEL_MAX_DELAY;
+        level = WHEEL_LEVELS - 1;
+    }
+    else
+    {
+        while (level < WHEEL_LEVELS - 1 && delay >= ((uint32_t)1 << ((level + 1) * WHEEL_BITS)))
+        {
+            level++;
+        }
+    }
+
+    time_event_t ** const slot = &l_wheel[level][(position >> (level * WHEEL_BITS)) & WHEEL_MASK];
+    t->next = *slot;
+    if (t->next != NULL)
+    {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = slot;
+    *slot = t;
+}
 
+// Described above
+static void time_event_unlink(time_event_t * const t)
+{
+    if (t->pprev == NULL)
+    {
+        // Not armed
+        return;
     }
 
-}
\ No newline at end of file
+    *t->pprev = t->next;
+    if (t->next != NULL)
+    {
+        t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+// Described above
+static void time_event_cascade(uint8_t level, uint32_t index)
+{
+    time_event_t *t = l_wheel[level][index];
+    l_wheel[level][index] = NULL;
+
+    while (t != NULL)
+    {
+        time_event_t * const next = t->next;
+        time_event_insert(t);
+        t = next;
+    }
+}
+
+#if CONFIG_ACTOR_TIME_EVENT_DEFERRED
+// Described in .h
+void time_event_start_drain(uint8_t prio, uint32_t stack_size)
+{
+    xTaskCreate(time_event_drain, "time_event", stack_size, NULL, prio, &l_drain_task);
+}
+
+// Described in .h
+uint32_t time_event_get_overruns(void)
+{
+    return l_ring_overruns;
+}
+
+// Described above
+static void time_event_fire(time_event_t * const t, BaseType_t * const woken)
+{
+    (void)woken;
+
+    uint32_t const head = l_ring_head;
+    if (head - __atomic_load_n(&l_ring_tail, __ATOMIC_ACQUIRE) >= RING_SIZE)
+    {
+        // Drain task has fallen behind; the expiry is lost
+        l_ring_overruns++;
+        return;
+    }
+
+    l_ring[head & RING_MASK] = t;
+    __atomic_store_n(&l_ring_head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Described above
+static void time_event_drain(void *pdata)
+{
+    (void)pdata;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t tail = l_ring_tail;
+        while (tail != __atomic_load_n(&l_ring_head, __ATOMIC_ACQUIRE))
+        {
+            time_event_t * const t = l_ring[tail & RING_MASK];
+            actor_post(t->actor, &t->super);
+            tail++;
+            __atomic_store_n(&l_ring_tail, tail, __ATOMIC_RELEASE);
+        }
+    }
+}
+#else
+// Described above
+static void time_event_fire(time_event_t * const t, BaseType_t * const woken)
+{
+    actor_post_from_isr(t->actor, &t->super, woken);
+}
+#endif
\ No newline at end of file
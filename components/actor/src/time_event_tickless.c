@@ -0,0 +1,382 @@
+/**
+ * @file time_event_tickless.c
+ * @author Matt Richardson (matt.richardson@msrconsults.com)
+ * @brief Tickless, esp_timer driven implementation for time events
+ * @version 0.1
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 MSR Consulting, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "time_event.h"
+#include "actor_port.h"
+#include "actor_priv.h"
+
+#include <stddef.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define TAG "time_event"
+
+/*******************************************************************************
+ * Type Definitions
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Insert an armed timer into the deadline-sorted list
+ *
+ * Timers with equal deadlines keep arming order.  Must be called with the
+ * list lock held.
+ *
+ * @param t Timer to insert
+ */
+static void time_event_insert(time_event_t * const t);
+
+/**
+ * @brief Remove a timer from the deadline-sorted list
+ *
+ * Must be called with the list lock held.
+ *
+ * @param t Timer to remove
+ */
+static void time_event_unlink(time_event_t * const t);
+
+/**
+ * @brief Get the latest time at which the earliest timers can fire together
+ *
+ * Walks the timers whose expiry comes before the smallest end of a slack
+ * window seen so far.  Must be called with the list lock held.
+ *
+ * @return Absolute time in microseconds; INT64_MAX with no timer armed
+ */
+static int64_t time_event_deadline(void);
+
+/**
+ * @brief Program the one-shot timer for the earliest deadline
+ */
+static void time_event_reprogram(void);
+
+/**
+ * @brief One-shot timer callback posting all expired time events
+ *
+ * @param arg Unused
+ */
+static void time_event_expire(void *arg);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/** Armed timers sorted by ascending deadline */
+static time_event_t *l_head = NULL;
+
+/** Incremented whenever the earliest deadline changes */
+static uint32_t l_generation = 0;
+
+/** Number of one-shot timer expirations */
+static uint32_t l_wakeups = 0;
+
+/** One-shot timer programmed for the earliest deadline */
+static esp_timer_handle_t l_timer = NULL;
+
+/** Protects the deadline list */
+ACTOR_PORT_LOCK(l_list_lock);
+
+/*******************************************************************************
+ * Function Definitions
+ ******************************************************************************/
+
+// Described in .h
+void time_event_ctor(time_event_t * const me, signal_t sig, actor_t *actor)
+{
+    me->super.sig = sig;
+    me->super.pool_id = 0;
+    me->super.ref_count = 0;
+    me->actor = actor;
+    me->next = NULL;
+    me->pprev = NULL;
+    me->expiry = 0;
+    me->interval = 0;
+    me->slack = 0;
+}
+
+// Described in .h
+void time_event_init(void)
+{
+    if (l_timer != NULL)
+    {
+        return;
+    }
+
+    esp_timer_create_args_t const args = {
+        .callback = time_event_expire,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "time_event",
+        .skip_unhandled_events = true,
+    };
+
+    if (esp_timer_create(&args, &l_timer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Unable to create time event timer");
+    }
+}
+
+// Described in .h
+void time_event_arm(time_event_t *const me, uint32_t timeout, uint32_t interval)
+{
+    uint64_t const tick_us = (uint64_t)portTICK_PERIOD_MS * 1000;
+
+    time_event_arm_us(me, timeout * tick_us, interval * tick_us);
+}
+
+// Described in .h
+void time_event_arm_us(time_event_t *const me, uint64_t timeout, uint64_t interval)
+{
+    int64_t const now = esp_timer_get_time();
+
+    ACTOR_PORT_ENTER(&l_list_lock);
+    int64_t const old_deadline = time_event_deadline();
+    time_event_unlink(me);
+    me->interval = interval;
+    if (timeout > 0)
+    {
+        me->expiry = now + (int64_t)timeout;
+        time_event_insert(me);
+    }
+    bool const changed = (time_event_deadline() != old_deadline);
+    if (changed)
+    {
+        l_generation++;
+    }
+    ACTOR_PORT_EXIT(&l_list_lock);
+
+    if (changed)
+    {
+        time_event_reprogram();
+    }
+}
+
+// Described in .h
+void time_event_set_slack(time_event_t * const me, uint32_t slack)
+{
+    time_event_set_slack_us(me, (uint64_t)slack * portTICK_PERIOD_MS * 1000);
+}
+
+// Described in .h
+void time_event_set_slack_us(time_event_t * const me, uint64_t slack)
+{
+    ACTOR_PORT_ENTER(&l_list_lock);
+    me->slack = slack;
+    ACTOR_PORT_EXIT(&l_list_lock);
+}
+
+// Described in .h
+bool time_event_disarm(time_event_t *const me)
+{
+    ACTOR_PORT_ENTER(&l_list_lock);
+    bool const armed = (me->pprev != NULL);
+    int64_t const old_deadline = time_event_deadline();
+    time_event_unlink(me);
+    bool const changed = (time_event_deadline() != old_deadline);
+    if (changed)
+    {
+        l_generation++;
+    }
+    ACTOR_PORT_EXIT(&l_list_lock);
+
+    if (changed)
+    {
+        time_event_reprogram();
+    }
+
+    return armed;
+}
+
+// Described in .h
+bool time_event_armed(time_event_t const * const me)
+{
+    ACTOR_PORT_ENTER(&l_list_lock);
+    bool const armed = (me->pprev != NULL);
+    ACTOR_PORT_EXIT(&l_list_lock);
+
+    return armed;
+}
+
+// Described in .h
+uint64_t time_event_next_expiry_us(void)
+{
+    int64_t const now = esp_timer_get_time();
+
+    ACTOR_PORT_ENTER(&l_list_lock);
+    int64_t const deadline = time_event_deadline();
+    ACTOR_PORT_EXIT(&l_list_lock);
+
+    if (deadline == INT64_MAX)
+    {
+        return UINT64_MAX;
+    }
+
+    return (deadline > now) ? (uint64_t)(deadline - now) : 0;
+}
+
+// Described in .h
+uint32_t time_event_get_wakeups(void)
+{
+    return l_wakeups;
+}
+
+// Described above
+static void time_event_insert(time_event_t * const t)
+{
+    time_event_t **link = &l_head;
+    while (*link != NULL && (*link)->expiry <= t->expiry)
+    {
+        link = &(*link)->next;
+    }
+
+    t->next = *link;
+    if (t->next != NULL)
+    {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = link;
+    *link = t;
+}
+
+// Described above
+static void time_event_unlink(time_event_t * const t)
+{
+    if (t->pprev == NULL)
+    {
+        // Not armed
+        return;
+    }
+
+    *t->pprev = t->next;
+    if (t->next != NULL)
+    {
+        t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+// Described above
+static int64_t time_event_deadline(void)
+{
+    int64_t deadline = INT64_MAX;
+
+    for (time_event_t const *t = l_head; t != NULL && t->expiry <= deadline; t = t->next)
+    {
+        int64_t const last = t->expiry + (int64_t)t->slack;
+        if (last < deadline)
+        {
+            deadline = last;
+        }
+    }
+
+    return deadline;
+}
+
+// Described above
+static void time_event_reprogram(void)
+{
+    uint32_t generation;
+    bool again;
+
+    do
+    {
+        ACTOR_PORT_ENTER(&l_list_lock);
+        int64_t const deadline = time_event_deadline();
+        generation = l_generation;
+        ACTOR_PORT_EXIT(&l_list_lock);
+
+        esp_timer_stop(l_timer);
+        if (deadline != INT64_MAX)
+        {
+            int64_t const delay = deadline - esp_timer_get_time();
+            esp_timer_start_once(l_timer, (delay > 0) ? (uint64_t)delay : 0);
+        }
+
+        // A concurrent arm may have moved the earliest deadline meanwhile
+        ACTOR_PORT_ENTER(&l_list_lock);
+        again = (generation != l_generation);
+        ACTOR_PORT_EXIT(&l_list_lock);
+    } while (again);
+}
+
+// Described above
+static void time_event_expire(void *arg)
+{
+    (void)arg;
+
+    int64_t const now = esp_timer_get_time();
+    l_wakeups++;
+
+    while (1)
+    {
+        ACTOR_PORT_ENTER(&l_list_lock);
+        time_event_t * const t = l_head;
+        bool const expired = (t != NULL && t->expiry <= now);
+        if (expired)
+        {
+            time_event_unlink(t);
+            if (t->interval > 0)
+            {
+                // Keep the original phase, skipping periods that were missed
+                t->expiry += (int64_t)t->interval;
+                if (t->expiry <= now)
+                {
+                    uint64_t const missed = (uint64_t)(now - t->expiry) / t->interval + 1;
+                    t->expiry += (int64_t)(missed * t->interval);
+                }
+                time_event_insert(t);
+            }
+            l_generation++;
+        }
+        ACTOR_PORT_EXIT(&l_list_lock);
+
+        if (!expired)
+        {
+            break;
+        }
+
+        // Timer expired - fire event
+        actor_trace_record(ACTOR_TRACE_TIMER, t->actor->actor_id, t->super.sig);
+        actor_post(t->actor, &t->super);
+    }
+
+    time_event_reprogram();
+}
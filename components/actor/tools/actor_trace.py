@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2024 MSR Consulting, LLC
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+"""Convert an actor trace stream (see actor_trace.h) to Chrome trace JSON.
+
+The output loads in chrome://tracing and https://ui.perfetto.dev.  Each actor
+is shown as a thread; dispatches are slices, posts, drops and timer
+expirations are instant events.
+
+    actor_trace.py trace.bin -o trace.json [--signals names.json]
+
+The optional signal map is a JSON object of signal number to name.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRACE_MAGIC = 0x43525441
+TRACE_VERSION = 1
+NO_ACTOR = 0xFF
+
+FRAME = struct.Struct('<IBBHII')
+RECORD = struct.Struct('<IHBB')
+
+POST, DISPATCH_BEGIN, DISPATCH_END, TIMER, DROP = range(5)
+
+
+def read_frames(data):
+    """Yield (core, lost, cpu_hz, records) for every frame in the stream."""
+    offset = 0
+    while offset + FRAME.size <= len(data):
+        magic, version, core, count, lost, cpu_hz = FRAME.unpack_from(data, offset)
+        if magic != TRACE_MAGIC:
+            # Resynchronise on the next frame header, e.g. after UART noise
+            offset += 1
+            continue
+        if version != TRACE_VERSION:
+            raise ValueError(f'unsupported trace version {version}')
+        offset += FRAME.size
+        end = offset + count * RECORD.size
+        if end > len(data):
+            break
+        records = [RECORD.unpack_from(data, offset + i * RECORD.size) for i in range(count)]
+        offset = end
+        yield core, lost, cpu_hz, records
+
+
+def convert(data, signals):
+    events = []
+    clock = {}
+    actors = set()
+
+    def sig_name(sig):
+        return signals.get(str(sig), f'sig {sig}')
+
+    for core, lost, cpu_hz, records in read_frames(data):
+        if lost:
+            events.append({'name': f'{lost} records lost', 'ph': 'i', 's': 'p', 'pid': core,
+                           'tid': NO_ACTOR, 'ts': clock.get(core, 0) / cpu_hz * 1e6})
+        for delta, sig, actor, kind in records:
+            clock[core] = clock.get(core, 0) + delta
+            ts = clock[core] / cpu_hz * 1e6
+            actors.add((core, actor))
+            event = {'pid': core, 'tid': actor, 'ts': ts, 'name': sig_name(sig)}
+            if kind == DISPATCH_BEGIN:
+                event['ph'] = 'B'
+            elif kind == DISPATCH_END:
+                event['ph'] = 'E'
+            elif kind == POST:
+                event.update(ph='i', s='t', name='post ' + sig_name(sig))
+            elif kind == TIMER:
+                event.update(ph='i', s='t', name='timer ' + sig_name(sig))
+            elif kind == DROP:
+                event.update(ph='i', s='t', name='drop ' + sig_name(sig))
+            else:
+                continue
+            events.append(event)
+
+    for core, actor in sorted(actors):
+        name = f'actor {actor}' if actor != NO_ACTOR else 'framework'
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': core, 'tid': actor,
+                       'args': {'name': name}})
+    for core in sorted(clock):
+        events.append({'name': 'process_name', 'ph': 'M', 'pid': core, 'tid': 0,
+                       'args': {'name': f'core {core}'}})
+
+    return {'traceEvents': events, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', help='binary trace stream')
+    parser.add_argument('-o', '--output', help='JSON output file (default: stdout)')
+    parser.add_argument('--signals', help='JSON object mapping signal numbers to names')
+    args = parser.parse_args()
+
+    with open(args.input, 'rb') as f:
+        data = f.read()
+
+    signals = {}
+    if args.signals:
+        with open(args.signals) as f:
+            signals = json.load(f)
+
+    trace = convert(data, signals)
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()